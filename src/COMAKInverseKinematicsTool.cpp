@@ -67,6 +67,8 @@ void COMAKInverseKinematicsTool::constructProperties()
     constructProperty_secondary_coupled_coordinate_stop_value(0.0);
     constructProperty_secondary_constraint_sim_integrator_accuracy(1e-6);
     constructProperty_secondary_constraint_sim_internal_step_limit(-1);
+    constructProperty_secondary_constraint_sim_num_segments(1);
+    constructProperty_secondary_constraint_sim_num_threads(-1);
     constructProperty_constraint_function_num_interpolation_points(20);
     constructProperty_secondary_constraint_function_file(
         "secondary_coordinate_constraint_functions.xml");
@@ -79,6 +81,9 @@ void COMAKInverseKinematicsTool::constructProperties()
     constructProperty_output_motion_file("");
     constructProperty_ik_constraint_weight(Infinity);
     constructProperty_ik_accuracy(1e-5);
+    constructProperty_ik_num_chunks(1);
+    constructProperty_ik_chunk_overlap_frames(10);
+    constructProperty_ik_num_threads(-1);
     Array<double> range{SimTK::Infinity, 2};
     range[0] = -SimTK::Infinity; 
     constructProperty_time_range(range);
@@ -218,12 +223,65 @@ void COMAKInverseKinematicsTool::run()
 }
 
 
+/**
+Runs one segment of the secondary constraint simulation on a separate model
+copy so the segments can be simulated in parallel.
+*/
+class SecondaryConstraintSegmentTask : public SimTK::ParallelExecutor::Task {
+public:
+    SecondaryConstraintSegmentTask(const COMAKInverseKinematicsTool& tool,
+        std::vector<Model>& models, const SimTK::Vector& segment_values,
+        double segment_time,
+        std::vector<CompactStatesTrajectory>& settle_states,
+        std::vector<CompactStatesTrajectory>& sweep_states,
+        std::vector<TimeSeriesTable>& q_tables,
+        std::vector<std::string>& errors) :
+        _tool(tool), _models(models), _segment_values(segment_values),
+        _segment_time(segment_time), _settle_states(settle_states),
+        _sweep_states(sweep_states), _q_tables(q_tables), _errors(errors) {}
+
+    void execute(int index) override {
+        try {
+            _tool.simulateSecondaryConstraintSegment(_models[index],
+                _segment_values(index), _segment_values(index + 1),
+                _segment_time, _settle_states[index], _sweep_states[index],
+                _q_tables[index], false);
+        }
+        catch (const std::exception& x) {
+            _errors[index] = x.what();
+        }
+    }
+
+private:
+    const COMAKInverseKinematicsTool& _tool;
+    std::vector<Model>& _models;
+    const SimTK::Vector& _segment_values;
+    double _segment_time;
+    std::vector<CompactStatesTrajectory>& _settle_states;
+    std::vector<CompactStatesTrajectory>& _sweep_states;
+    std::vector<TimeSeriesTable>& _q_tables;
+    std::vector<std::string>& _errors;
+};
+
 void COMAKInverseKinematicsTool::performIKSecondaryConstraintSimulation() {
     std::cout << "Performing IK Secondary Constraint Simulation..." << std::endl;
     
+    int n_segments = get_secondary_constraint_sim_num_segments();
+
+    OPENSIM_THROW_IF(n_segments < 1, Exception,
+        "secondary_constraint_sim_num_segments must be greater than 0.")
+
+    if (get_use_visualizer() && n_segments > 1) {
+        std::cout << "WARNING: use_visualizer is ignored, the secondary "
+            "constraint simulation is split into " << n_segments << 
+            " segments that are simulated in parallel. Set "
+            "secondary_constraint_sim_num_segments to 1 to visualize it." 
+            << std::endl;
+    }
+
     //Initialize Model
     Model model = _model;
-    model.setUseVisualizer(get_use_visualizer());
+    model.setUseVisualizer(get_use_visualizer() && n_segments == 1);
     model.initSystem();
 
     for (Muscle& msl : model.updComponentList<Muscle>()) {
@@ -255,9 +313,6 @@ void COMAKInverseKinematicsTool::performIKSecondaryConstraintSimulation() {
         }
     }
 
-    Coordinate& coupled_coord = 
-        model.updComponent<Coordinate>(get_secondary_coupled_coordinate());
-    
     double start_value;
     double stop_value;
 
@@ -277,12 +332,189 @@ void COMAKInverseKinematicsTool::performIKSecondaryConstraintSimulation() {
     //Initialize Simulation 
     //---------------------
 
-    if (get_use_visualizer()) {
+    if (get_use_visualizer() && n_segments == 1) {
         SimTK::Visualizer& viz = model.updVisualizer().updSimbodyVisualizer();
         viz.setBackgroundColor(SimTK::White);
         viz.setShowSimTime(true);
     }
-        
+
+    std::vector<CompactStatesTrajectory> settle_states(n_segments);
+    std::vector<CompactStatesTrajectory> sweep_states(n_segments);
+    std::vector<TimeSeriesTable> q_tables(n_segments);
+    std::vector<Model> segment_models;
+
+    if (n_segments == 1) {
+        simulateSecondaryConstraintSegment(model, start_value, stop_value,
+            get_secondary_constraint_sim_sweep_time(), settle_states[0],
+            sweep_states[0], q_tables[0], get_verbose() > 0);
+    }
+    else {
+        //Split the sweep into segments that each start from a settled pose
+        SimTK::Vector segment_values(n_segments + 1);
+        for (int k = 0; k <= n_segments; ++k) {
+            segment_values(k) = 
+                start_value + k * (stop_value - start_value) / n_segments;
+        }
+
+        double segment_time = 
+            get_secondary_constraint_sim_sweep_time() / n_segments;
+
+        for (int k = 0; k < n_segments; ++k) {
+            segment_models.push_back(model);
+        }
+
+        int n_threads = get_secondary_constraint_sim_num_threads();
+        if (n_threads < 1) {
+            n_threads = SimTK::ParallelExecutor::getNumProcessors();
+        }
+        n_threads = std::min(n_threads, n_segments);
+
+        std::cout << "Simulating " << n_segments << " segments using " << 
+            n_threads << " threads." << std::endl;
+
+        std::vector<std::string> errors(n_segments);
+
+        SecondaryConstraintSegmentTask task(*this, segment_models,
+            segment_values, segment_time, settle_states, sweep_states,
+            q_tables, errors);
+
+        SimTK::ParallelExecutor executor(n_threads);
+        executor.execute(task, n_segments);
+
+        for (int k = 0; k < n_segments; ++k) {
+            OPENSIM_THROW_IF(!errors[k].empty(), Exception,
+                "Secondary constraint simulation segment " + 
+                std::to_string(k) + " failed: " + errors[k])
+        }
+    }
+
+    //Stitch the sweep results of all segments together
+    std::vector<double> ind_values;
+    std::vector<std::vector<double>> secondary_values(_n_secondary_coord);
+
+    for (int k = 0; k < n_segments; ++k) {
+        SimTK::Vector ind_data = q_tables[k].getDependentColumn(
+            get_secondary_coupled_coordinate() + "/value");
+
+        //The last sweep point of a segment is at the same coupled coordinate
+        //value as the settled first point of the next segment
+        int n_rows = ind_data.size();
+        if (k < n_segments - 1) {
+            n_rows--;
+        }
+
+        for (int i = 0; i < n_rows; ++i) {
+            ind_values.push_back(ind_data(i));
+        }
+
+        for (int j = 0; j < _n_secondary_coord; ++j) {
+            SimTK::Vector col_data = q_tables[k].getDependentColumn(
+                _secondary_coord_path[j] + "/value");
+
+            for (int i = 0; i < n_rows; ++i) {
+                secondary_values[j].push_back(col_data(i));
+            }
+        }
+    }
+
+    //Spline knots must be in ascending order
+    if (ind_values.front() > ind_values.back()) {
+        std::reverse(ind_values.begin(), ind_values.end());
+
+        for (int j = 0; j < _n_secondary_coord; ++j) {
+            std::reverse(secondary_values[j].begin(), secondary_values[j].end());
+        }
+    }
+
+    //Compute Coupled Constraint Functions
+    double ind_max = *std::max_element(ind_values.begin(), ind_values.end());
+    double ind_min = *std::min_element(ind_values.begin(), ind_values.end());
+
+    int npts = get_constraint_function_num_interpolation_points();
+    double step = (ind_max - ind_min) / npts;
+
+    SimTK::Vector ind_pt_data(npts);
+
+    for (int i = 0; i < npts; ++i) {
+        ind_pt_data(i) = ind_min + i * step;
+    }
+
+    _secondary_constraint_functions.clearAndDestroy();
+
+    for (int j = 0; j < _n_secondary_coord; ++j) {
+        std::string path = _secondary_coord_path[j];
+
+        SimmSpline data_fit = SimmSpline(static_cast<int>(ind_values.size()),
+            &ind_values[0], &secondary_values[j][0]);
+
+        SimmSpline* spline = new SimmSpline();
+        spline->setName(path);
+
+        for (int i = 0; i < npts; ++i) {
+            spline->addPoint(ind_pt_data(i), data_fit.calcValue(SimTK::Vector(1, ind_pt_data(i))));
+        }
+
+        _secondary_constraint_functions.adoptAndAppend(spline);
+    }
+
+    //Print Secondardy Constraint Functions to file
+    _secondary_constraint_functions.print(get_secondary_constraint_function_file());
+
+    //Write Outputs
+    if (get_print_secondary_constraint_sim_results()) {
+        std::cout << "Printing secondary constraint simulation results: " <<
+            get_results_directory() << std::endl;
+
+        std::string name = "secondary_constraint_sim_states";
+
+        STOFileAdapter sto_file_adapt;
+
+        for (int k = 0; k < n_segments; ++k) {
+            const Model& seg_model = 
+                (n_segments == 1) ? model : segment_models[k];
+
+            std::string suffix = (n_segments == 1) ? 
+                "" : "_segment" + std::to_string(k);
+
+            TimeSeriesTable settle_table = 
+                settle_states[k].exportToTable(seg_model);
+            settle_table.addTableMetaData("header", name);
+            settle_table.addTableMetaData("nRows", 
+                std::to_string(settle_table.getNumRows()));
+            settle_table.addTableMetaData("nColumns", 
+                std::to_string(settle_table.getNumColumns() + 1));
+
+            TimeSeriesTable sweep_table = 
+                sweep_states[k].exportToTable(seg_model);
+            sweep_table.addTableMetaData("header", name);
+            sweep_table.addTableMetaData("nRows", 
+                std::to_string(sweep_table.getNumRows()));
+            sweep_table.addTableMetaData("nColumns", 
+                std::to_string(sweep_table.getNumColumns() + 1));
+
+            std::string settle_file =
+                get_results_directory() + "/" + get_results_prefix() +
+                "_secondary_constraint_settle_states" + suffix + ".sto";
+
+            std::string sweep_file =
+                get_results_directory() + "/" + get_results_prefix() +
+                "_secondary_constraint_sweep_states" + suffix + ".sto";
+
+            sto_file_adapt.write(settle_table, settle_file);
+            sto_file_adapt.write(sweep_table, sweep_file);
+        }
+    }
+}
+
+void COMAKInverseKinematicsTool::simulateSecondaryConstraintSegment(
+    Model& model, double start_value, double stop_value, double sweep_time,
+    CompactStatesTrajectory& settle_states,
+    CompactStatesTrajectory& sweep_states,
+    TimeSeriesTable& q_table, bool verbose) const
+{
+    Coordinate& coupled_coord = 
+        model.updComponent<Coordinate>(get_secondary_coupled_coordinate());
+
     //Perform Settling Simulation
     //---------------------------
 
@@ -312,12 +544,10 @@ void COMAKInverseKinematicsTool::performIKSecondaryConstraintSimulation() {
     SimTK::TimeStepper timestepper(model.getSystem(), integrator);
 
     timestepper.initialize(state);
-    
-    StatesTrajectory settle_states;
 
     double dt = 0.01;
  
-    if (get_verbose() > 0) {
+    if (verbose) {
         std::cout << "Starting Settling Simulation."<< std::endl;
     }
 
@@ -330,7 +560,7 @@ void COMAKInverseKinematicsTool::performIKSecondaryConstraintSimulation() {
         state = timestepper.getState();
         settle_states.append(state);
         
-        if (get_verbose() > 0) {
+        if (verbose) {
             std::cout << std::endl;
             std::cout << "Time: " << state.getTime() << std::endl;
             std::cout << "\t\t VALUE \t\tDELTA" << std::endl;
@@ -348,7 +578,7 @@ void COMAKInverseKinematicsTool::performIKSecondaryConstraintSimulation() {
             }
             prev_sec_coord_value(k) = value;
 
-            if (get_verbose() > 0) {
+            if (verbose) {
                 std::cout << coord.getName() << " \t" << value << "\t" << delta <<std::endl;
             }
         }
@@ -366,7 +596,7 @@ void COMAKInverseKinematicsTool::performIKSecondaryConstraintSimulation() {
         settled_secondary_speeds.set(c, coord.getSpeedValue(state));
     }
 
-    if (get_verbose() > 0) {
+    if (verbose) {
         std::cout << "Finished Settling Simulation in " << state.getTime() << " s." << std::endl;
         std::cout << "Starting Sweep Simulation."<< std::endl;
     }
@@ -377,7 +607,7 @@ void COMAKInverseKinematicsTool::performIKSecondaryConstraintSimulation() {
     //setup quadratic sweep function
     double Vx = 0;
     double Vy = start_value;
-    double Px = Vx + get_secondary_constraint_sim_sweep_time();
+    double Px = Vx + sweep_time;
     double Py = stop_value;
     double a = (Py - Vy) / SimTK::square(Px - Vx);
 
@@ -417,11 +647,10 @@ void COMAKInverseKinematicsTool::performIKSecondaryConstraintSimulation() {
     int nSteps = round((sweep_stop - sweep_start) / dt);
 
     //Setup storage for computing constraint functions
-    TimeSeriesTable q_table;
     SimTK::RowVector q_row(model.getNumCoordinates());
     std::vector<std::string> q_names;
 
-    for (Coordinate& coord : _model.updComponentList<Coordinate>()) {
+    for (const Coordinate& coord : model.getComponentList<Coordinate>()) {
         q_names.push_back(coord.getAbsolutePathString() + "/value");
     }
 
@@ -437,8 +666,6 @@ void COMAKInverseKinematicsTool::performIKSecondaryConstraintSimulation() {
     SimTK::TimeStepper sweep_timestepper(model.getSystem(), sweep_integrator);
 
     sweep_timestepper.initialize(state);
-    
-    StatesTrajectory sweep_states;
 
     for (int i = 0; i <= nSteps; ++i) {
 
@@ -454,96 +681,10 @@ void COMAKInverseKinematicsTool::performIKSecondaryConstraintSimulation() {
         }
         q_table.appendRow(state.getTime(), q_row);
 
-        if (get_verbose() > 0) {
+        if (verbose) {
             std::cout << state.getTime() << std::endl;
         }
     }
-
-    //Compute Coupled Constraint Functions
-    std::vector<double> time = q_table.getIndependentColumn();
-
-    SimTK::Vector ind_data = q_table.getDependentColumn(get_secondary_coupled_coordinate() + "/value");
-
-    SimTK::Matrix data(time.size(), _n_secondary_coord);
-
-for (int j = 0; j < _n_secondary_coord; ++j) {
-    std::string path = _secondary_coord_path[j];
-    SimTK::Vector col_data = q_table.getDependentColumn(path + "/value");
-
-    for (int i = 0; i < nSteps; ++i) {
-        data(i, j) = col_data(i);
-
-    }
-}
-
-double ind_max = SimTK::max(ind_data);
-double ind_min = SimTK::min(ind_data);
-
-int npts = get_constraint_function_num_interpolation_points();
-double step = (ind_max - ind_min) / npts;
-
-SimTK::Vector ind_pt_data(npts);
-
-for (int i = 0; i < npts; ++i) {
-    ind_pt_data(i) = ind_min + i * step;
-}
-
-_secondary_constraint_functions.clearAndDestroy();
-
-for (int j = 0; j < _n_secondary_coord; ++j) {
-    std::string path = _secondary_coord_path[j];
-
-    SimTK::Vector secondary_data = data(j);
-
-    //GCVSpline* spline = new GCVSpline(5, secondary_data.nrow(), &ind_data[0], &secondary_data[0], path, -1);
-    SimmSpline data_fit = SimmSpline(secondary_data.size(), &ind_data[0], &secondary_data[0]);
-
-    SimmSpline* spline = new SimmSpline();
-    spline->setName(path);
-
-    for (int i = 0; i < npts; ++i) {
-        spline->addPoint(ind_pt_data(i), data_fit.calcValue(SimTK::Vector(1, ind_pt_data(i))));
-    }
-
-    _secondary_constraint_functions.adoptAndAppend(spline);
-}
-
-//Print Secondardy Constraint Functions to file
-_secondary_constraint_functions.print(get_secondary_constraint_function_file());
-
-//Write Outputs
-if (get_print_secondary_constraint_sim_results()) {
-    std::cout << "Printing secondary constraint simulation results: " <<
-        get_results_directory() << std::endl;
-
-    std::string name = "secondary_constraint_sim_states";
-
-    TimeSeriesTable settle_table = settle_states.exportToTable(model);
-    settle_table.addTableMetaData("header", name);
-    settle_table.addTableMetaData("nRows", 
-        std::to_string(settle_table.getNumRows()));
-    settle_table.addTableMetaData("nColumns", 
-        std::to_string(settle_table.getNumColumns() + 1));
-
-    TimeSeriesTable sweep_table = sweep_states.exportToTable(model);
-    sweep_table.addTableMetaData("header", name);
-    sweep_table.addTableMetaData("nRows", 
-        std::to_string(sweep_table.getNumRows()));
-    sweep_table.addTableMetaData("nColumns", 
-        std::to_string(sweep_table.getNumColumns() + 1));
-
-    std::string settle_file =
-        get_results_directory() + "/" + get_results_prefix() +
-        "_secondary_constraint_settle_states.sto";
-
-    std::string sweep_file =
-        get_results_directory() + "/" + get_results_prefix() +
-        "_secondary_constraint_sweep_states.sto";
-
-    STOFileAdapter sto_file_adapt;
-    sto_file_adapt.write(settle_table, settle_file);
-    sto_file_adapt.write(sweep_table, sweep_file);
-}
 }
 
 void COMAKInverseKinematicsTool::performIK()
@@ -622,6 +763,100 @@ void COMAKInverseKinematicsTool::performIK()
     runInverseKinematics();
 }
 
+/**
+Solves inverse kinematics for one chunk of the marker trial with its own model
+copy and solver. The solver is assembled overlap frames before the start of
+the chunk and tracked up to the chunk to warm start the solution.
+*/
+class InverseKinematicsChunkTask : public SimTK::ParallelExecutor::Task {
+public:
+    InverseKinematicsChunkTask(const COMAKInverseKinematicsTool& tool,
+        std::vector<Model>& models,
+        const MarkersReference& markers_reference,
+        const SimTK::Array_<CoordinateReference>& coordinate_references,
+        const std::vector<double>& times, const std::vector<int>& chunk_start,
+        int start_ix, std::vector<SimTK::Vector>& q,
+        std::vector<SimTK::Array_<double>>& squared_marker_errors,
+        std::vector<SimTK::Array_<SimTK::Vec3>>& marker_locations,
+        std::vector<std::string>& marker_names,
+        std::vector<std::string>& errors) :
+        _tool(tool), _models(models), _markers_reference(markers_reference),
+        _coordinate_references(coordinate_references), _times(times),
+        _chunk_start(chunk_start), _start_ix(start_ix), _q(q),
+        _squared_marker_errors(squared_marker_errors),
+        _marker_locations(marker_locations), _marker_names(marker_names),
+        _errors(errors) {}
+
+    void execute(int index) override {
+        try {
+            int first = _chunk_start[index];
+            int last = _chunk_start[index + 1] - 1;
+            int warm_start = std::max(
+                first - _tool.get_ik_chunk_overlap_frames(), _start_ix);
+
+            Model& model = _models[index];
+            SimTK::State s = model.getWorkingState();
+
+            SimTK::Array_<CoordinateReference> coordinate_references =
+                _coordinate_references;
+
+            InverseKinematicsSolver ikSolver(model, _markers_reference,
+                coordinate_references, _tool.get_ik_constraint_weight());
+            ikSolver.setAccuracy(_tool.get_ik_accuracy());
+            s.updTime() = _times[warm_start];
+            ikSolver.assemble(s);
+
+            //The main solver is not assembled, so the markers in use are
+            //reported by the first chunk
+            if (index == 0) {
+                for (int m = 0; m < ikSolver.getNumMarkersInUse(); ++m) {
+                    _marker_names.push_back(ikSolver.getMarkerNameForIndex(m));
+                }
+            }
+
+            for (int i = warm_start; i <= last; ++i) {
+                s.updTime() = _times[i];
+                ikSolver.track(s);
+
+                if (i < first) continue;
+
+                int f = i - _start_ix;
+                _q[f] = s.getQ();
+
+                int nm = ikSolver.getNumMarkersInUse();
+
+                if (_tool.get_report_errors()) {
+                    _squared_marker_errors[f].resize(nm);
+                    ikSolver.computeCurrentSquaredMarkerErrors(
+                        _squared_marker_errors[f]);
+                }
+                if (_tool.get_report_marker_locations()) {
+                    _marker_locations[f].resize(nm);
+                    ikSolver.computeCurrentMarkerLocations(
+                        _marker_locations[f]);
+                }
+            }
+        }
+        catch (const std::exception& x) {
+            _errors[index] = x.what();
+        }
+    }
+
+private:
+    const COMAKInverseKinematicsTool& _tool;
+    std::vector<Model>& _models;
+    const MarkersReference& _markers_reference;
+    const SimTK::Array_<CoordinateReference>& _coordinate_references;
+    const std::vector<double>& _times;
+    const std::vector<int>& _chunk_start;
+    int _start_ix;
+    std::vector<SimTK::Vector>& _q;
+    std::vector<SimTK::Array_<double>>& _squared_marker_errors;
+    std::vector<SimTK::Array_<SimTK::Vec3>>& _marker_locations;
+    std::vector<std::string>& _marker_names;
+    std::vector<std::string>& _errors;
+};
+
 void COMAKInverseKinematicsTool::runInverseKinematics() {
 
      Kinematics* kinematicsReporter = nullptr;
@@ -631,6 +866,18 @@ void COMAKInverseKinematicsTool::runInverseKinematics() {
         _model.finalizeFromProperties();
         _model.printBasicInfo();
 
+        int n_chunks = get_ik_num_chunks();
+        OPENSIM_THROW_IF(n_chunks < 1, Exception,
+            "ik_num_chunks must be greater than 0.")
+
+        //Copy the model for each chunk before the reporter is added
+        std::vector<Model> chunk_models;
+        if (n_chunks > 1) {
+            for (int c = 0; c < n_chunks; ++c) {
+                chunk_models.push_back(_model);
+            }
+        }
+
         // Define reporter for output
         kinematicsReporter = new Kinematics();
         kinematicsReporter->setRecordAccelerations(false);
@@ -675,7 +922,68 @@ void COMAKInverseKinematicsTool::runInverseKinematics() {
             coordinateReferences, get_ik_constraint_weight());
         ikSolver.setAccuracy(get_ik_accuracy());
         s.updTime() = times[start_ix];
-        ikSolver.assemble(s);
+
+        Stopwatch watch;
+
+        //Solve the chunks in parallel, the results are reported in order
+        //in the frame loop below. The first frame is taken from the chunks,
+        //so the main solver is only assembled without chunks.
+        n_chunks = std::min(n_chunks, Nframes);
+
+        std::vector<SimTK::Vector> chunk_q;
+        std::vector<SimTK::Array_<double>> chunk_squared_marker_errors;
+        std::vector<SimTK::Array_<Vec3>> chunk_marker_locations;
+        std::vector<std::string> marker_names;
+
+        if (n_chunks > 1) {
+            std::vector<int> chunk_start(n_chunks + 1);
+            for (int c = 0; c <= n_chunks; ++c) {
+                chunk_start[c] = start_ix + (c * Nframes) / n_chunks;
+            }
+
+            for (int c = 0; c < n_chunks; ++c) {
+                chunk_models[c].initSystem();
+            }
+
+            chunk_q.resize(Nframes);
+            chunk_squared_marker_errors.resize(Nframes);
+            chunk_marker_locations.resize(Nframes);
+
+            int n_threads = get_ik_num_threads();
+            if (n_threads < 1) {
+                n_threads = SimTK::ParallelExecutor::getNumProcessors();
+            }
+            n_threads = std::min(n_threads, n_chunks);
+
+            std::cout << "Solving " << Nframes << " frames in " << n_chunks <<
+                " chunks using " << n_threads << " threads." << std::endl;
+
+            std::vector<std::string> errors(n_chunks);
+
+            InverseKinematicsChunkTask task(*this, chunk_models,
+                markersReference, coordinateReferences, times, chunk_start,
+                start_ix, chunk_q, chunk_squared_marker_errors,
+                chunk_marker_locations, marker_names, errors);
+
+            SimTK::ParallelExecutor executor(n_threads);
+            executor.execute(task, n_chunks);
+
+            for (int c = 0; c < n_chunks; ++c) {
+                OPENSIM_THROW_IF(!errors[c].empty(), Exception,
+                    "Inverse kinematics chunk " + std::to_string(c) +
+                    " failed: " + errors[c])
+            }
+
+            s.updQ() = chunk_q[0];
+            _model.realizeVelocity(s);
+        }
+        else {
+            ikSolver.assemble(s);
+
+            for (int m = 0; m < ikSolver.getNumMarkersInUse(); ++m) {
+                marker_names.push_back(ikSolver.getMarkerNameForIndex(m));
+            }
+        }
         kinematicsReporter->begin(s);
 
         AnalysisSet& analysisSet = _model.updAnalysisSet();
@@ -683,7 +991,7 @@ void COMAKInverseKinematicsTool::runInverseKinematics() {
         // Get the actual number of markers the Solver is using, which
         // can be fewer than the number of references if there isn't a
         // corresponding model marker for each reference.
-        int nm = ikSolver.getNumMarkersInUse();
+        int nm = (int)marker_names.size();
         SimTK::Array_<double> squaredMarkerErrors(nm, 0.0);
         SimTK::Array_<Vec3> markerLocations(nm, Vec3(0));
         
@@ -692,11 +1000,16 @@ void COMAKInverseKinematicsTool::runInverseKinematics() {
         Storage *modelMarkerErrors = get_report_errors() ? 
             new Storage(Nframes, "ModelMarkerErrors") : nullptr;
 
-        Stopwatch watch;
-
         for (int i = start_ix; i <= final_ix; ++i) {
             s.updTime() = times[i];
-            ikSolver.track(s);
+
+            if (n_chunks > 1) {
+                s.updQ() = chunk_q[i - start_ix];
+                _model.realizeVelocity(s);
+            }
+            else {
+                ikSolver.track(s);
+            }
             // show progress line every 1000 frames so users see progress
             if (std::remainder(i - start_ix, 1000) == 0 && i != start_ix)
                 std::cout << "Solved " << i - start_ix << " frames..." << std::endl;
@@ -706,7 +1019,14 @@ void COMAKInverseKinematicsTool::runInverseKinematics() {
                 double maxSquaredMarkerError = 0.0;
                 int worst = -1;
 
-                ikSolver.computeCurrentSquaredMarkerErrors(squaredMarkerErrors);
+                if (n_chunks > 1) {
+                    squaredMarkerErrors = 
+                        chunk_squared_marker_errors[i - start_ix];
+                }
+                else {
+                    ikSolver.computeCurrentSquaredMarkerErrors(
+                        squaredMarkerErrors);
+                }
                 for(int j=0; j<nm; ++j){
                     totalSquaredMarkerError += squaredMarkerErrors[j];
                     if(squaredMarkerErrors[j] > maxSquaredMarkerError){
@@ -725,11 +1045,17 @@ void COMAKInverseKinematicsTool::runInverseKinematics() {
                     << "total squared error = " << totalSquaredMarkerError
                     << ", marker error: RMS=" << rms << ", max="
                     << sqrt(maxSquaredMarkerError) << " (" 
-                    << ikSolver.getMarkerNameForIndex(worst) << ")" << std::endl;
+                    << (worst >= 0 ? marker_names[worst] : "") << ")"
+                    << std::endl;
             }
 
             if(get_report_marker_locations()){
-                ikSolver.computeCurrentMarkerLocations(markerLocations);
+                if (n_chunks > 1) {
+                    markerLocations = chunk_marker_locations[i - start_ix];
+                }
+                else {
+                    ikSolver.computeCurrentMarkerLocations(markerLocations);
+                }
                 Array<double> locations(0.0, 3*nm);
                 for(int j=0; j<nm; ++j){
                     for(int k=0; k<3; ++k)
@@ -779,7 +1105,7 @@ void COMAKInverseKinematicsTool::runInverseKinematics() {
 
             for(int j=0; j<nm; ++j){
                 for(int k=0; k<3; ++k)
-                    labels.set(3*j+k+1, ikSolver.getMarkerNameForIndex(j)+XYZ[k]);
+                    labels.set(3*j+k+1, marker_names[j]+XYZ[k]);
             }
             modelMarkerLocations->setColumnLabels(labels);
             modelMarkerLocations->setName("Model Marker Locations from IK");
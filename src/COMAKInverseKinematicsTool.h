@@ -20,6 +20,7 @@
 #include <OpenSim/Simulation/Model/Model.h>
 #include <OpenSim/Common/FunctionSet.h>
 #include <OpenSim/Tools/IKTaskSet.h>
+#include "CompactStatesTrajectory.h"
 #include "osimPluginDLL.h"
 
 namespace OpenSim { 
@@ -104,6 +105,17 @@ public:
         "Limit on the number of internal steps that can be taken by BDF "
         "integrator. If -1, then there is no limit. The Default value is -1")
 
+    OpenSim_DECLARE_PROPERTY(secondary_constraint_sim_num_segments, int,
+        "Number of segments the secondary_coupled_coordinate range is split "
+        "into. Each segment is settled at its start value and swept over "
+        "secondary_constraint_sim_sweep_time / num_segments in parallel, "
+        "and the segment results are stitched together to fit the "
+        "constraint functions. The default value is 1.")
+
+    OpenSim_DECLARE_PROPERTY(secondary_constraint_sim_num_threads, int,
+        "Maximum number of threads used to simulate the segments. If -1, "
+        "the number of processors is used. The default value is -1.")
+
      OpenSim_DECLARE_PROPERTY(
          secondary_constraint_function_file, std::string, 
         "Name for .xml results file where secondary constraint functions "
@@ -173,6 +185,20 @@ public:
         "Default is 1e-5. It determines the number of significant digits to "
         "which the solution can be trusted.");
 
+    OpenSim_DECLARE_PROPERTY(ik_num_chunks, int,
+        "Number of chunks the frames are partitioned into. Each chunk is "
+        "solved in parallel with its own model copy and solver, and the "
+        "results are merged in order. The default value is 1.");
+
+    OpenSim_DECLARE_PROPERTY(ik_chunk_overlap_frames, int,
+        "Number of frames before the start of each chunk that are tracked "
+        "(and discarded) to warm start the chunk solution. "
+        "The default value is 10.");
+
+    OpenSim_DECLARE_PROPERTY(ik_num_threads, int,
+        "Maximum number of threads used to solve the chunks. If -1, the "
+        "number of processors is used. The default value is -1.");
+
     OpenSim_DECLARE_UNNAMED_PROPERTY(IKTaskSet, 
         "Markers and coordinates to be considered (tasks) and their weightings. "
         "The sum of weighted-squared task errors composes the cost function."); 
@@ -208,6 +234,11 @@ public:
     void initialize();
     void run();
     void performIKSecondaryConstraintSimulation();
+    void simulateSecondaryConstraintSegment(Model& model, double start_value,
+        double stop_value, double sweep_time,
+        CompactStatesTrajectory& settle_states,
+        CompactStatesTrajectory& sweep_states,
+        TimeSeriesTable& q_table, bool verbose) const;
     void performIK();
     void runInverseKinematics();
     void populateReferences(MarkersReference& markersReference,
@@ -30,7 +30,7 @@ using namespace OpenSim;
 //==============================================================================
 
 ComakTarget::
-ComakTarget(SimTK::State s,Model* aModel, const SimTK::Vector& observed_udot,
+ComakTarget(const SimTK::State& s,Model* aModel, const SimTK::Vector& observed_udot,
     const SimTK::Vector& init_parameters, 
     const Array<std::string>& parameter_names,
     Array<std::string> primary_coords, Array<std::string> secondary_coords,
@@ -56,11 +56,18 @@ ComakTarget(SimTK::State s,Model* aModel, const SimTK::Vector& observed_udot,
         = secondary_damping_actuator_path;
     _useMusclePhysiology = useMusclePhysiology;
     _state = s;
+    _working_state_is_allocated = false;
     _observed_udot = observed_udot;
     _init_parameters = init_parameters;
     _parameter_names = parameter_names;
     _activationExponent = 2.0;
     _model = aModel;
+
+    _use_unit_udot_update = false;
+    _unit_udot_was_updated = false;
+    _fixed_contact_correspondence = false;
+    _unit_udot_update_max_step = 0.0;
+    _unit_udot_update_tolerance = 0.0;
 }
 
 void ComakTarget::initialize(){
@@ -160,7 +167,105 @@ void ComakTarget::precomputeConstraintMatrix() {
     }
 
     //constraint matrix
-    computeUnitUdot(_state, _init_parameters);
+    _unit_udot_was_updated = false;
+
+    if (_use_unit_udot_update) {
+        _unit_udot_was_updated = updateUnitUdot();
+    }
+
+    if (!_unit_udot_was_updated) {
+        computeUnitUdot(_state, _init_parameters);
+    }
+}
+
+ComakUnitUdot ComakTarget::getUnitUdot() const {
+    ComakUnitUdot unit_udot;
+    unit_udot.parameters = _init_parameters;
+    unit_udot.constraint_initial_udot = _constraint_initial_udot;
+    unit_udot.msl_unit_udot = _msl_unit_udot;
+    unit_udot.non_muscle_actuator_unit_udot = _non_muscle_actuator_unit_udot;
+    unit_udot.secondary_coord_unit_udot = _secondary_coord_unit_udot;
+    unit_udot.secondary_damping_unit_udot = _secondary_damping_unit_udot;
+    unit_udot.secondary_coord_unit_energy = _secondary_coord_unit_energy;
+    return unit_udot;
+}
+
+bool ComakTarget::updateUnitUdot()
+/**
+* Broyden rank-one update of _secondary_coord_unit_udot using the change in
+* _constraint_initial_udot observed since the previous COMAK iteration. 
+* The actuator, damping and contact energy sensitivities are reused as is.
+* Returns false if the update is not trustworthy and a full computeUnitUdot()
+* is required.
+*/
+{
+    const ComakUnitUdot& prev = _prev_unit_udot;
+
+    if (prev.parameters.size() != _nParameters ||
+        prev.constraint_initial_udot.size() != _nConstraints ||
+        prev.secondary_coord_unit_udot.nrow() != _nConstraints ||
+        prev.secondary_coord_unit_udot.ncol() != _nSecondaryCoord) {
+        return false;
+    }
+
+    //Secondary coordinate step
+    SimTK::Vector dq(_nSecondaryCoord);
+    for (int j = 0; j < _nSecondaryCoord; ++j) {
+        dq(j) = _init_parameters(_nActuators + j) - 
+            prev.parameters(_nActuators + j);
+
+        if (fabs(dq(j)) > _unit_udot_update_max_step) {
+            return false;
+        }
+    }
+
+    //Acceleration change due to the secondary coordinate step, the part 
+    //explained by the change in actuator forces is removed 
+    SimTK::Vector dudot = 
+        _constraint_initial_udot - prev.constraint_initial_udot;
+
+    for (int i = 0; i < _nConstraints; ++i) {
+        int p = 0;
+        for (int j = 0; j < _nMuscles; ++j) {
+            double dforce = (_init_parameters[p] - prev.parameters[p]) * 
+                _optimalForce[p];
+            dudot(i) -= dforce * prev.msl_unit_udot(i, j);
+            p++;
+        }
+        for (int j = 0; j < _nNonMuscleActuators; ++j) {
+            double dforce = (_init_parameters[p] - prev.parameters[p]) * 
+                _optimalForce[p];
+            dudot(i) -= dforce * prev.non_muscle_actuator_unit_udot(i, j);
+            p++;
+        }
+    }
+
+    //Check how well the previous matrix predicted the observed change
+    SimTK::Vector residual = dudot - prev.secondary_coord_unit_udot * dq;
+
+    double dudot_norm = dudot.norm();
+    if (dudot_norm > SimTK::SignificantReal &&
+        residual.norm() / dudot_norm > _unit_udot_update_tolerance) {
+        return false;
+    }
+
+    _msl_unit_udot = prev.msl_unit_udot;
+    _non_muscle_actuator_unit_udot = prev.non_muscle_actuator_unit_udot;
+    _secondary_damping_unit_udot = prev.secondary_damping_unit_udot;
+    _secondary_coord_unit_energy = prev.secondary_coord_unit_energy;
+    _secondary_coord_unit_udot = prev.secondary_coord_unit_udot;
+
+    //Rank-one update: J += (dudot - J*dq) * dq^T / (dq^T * dq)
+    double dq_sqr = ~dq * dq;
+    if (dq_sqr > SimTK::SignificantReal * SimTK::SignificantReal) {
+        for (int i = 0; i < _nConstraints; ++i) {
+            for (int j = 0; j < _nSecondaryCoord; ++j) {
+                _secondary_coord_unit_udot(i, j) += 
+                    residual(i) * dq(j) / dq_sqr;
+            }
+        }
+    }
+    return true;
 }
 
 //==============================================================================
@@ -359,8 +464,56 @@ int ComakTarget::constraintJacobian(const SimTK::Vector &parameters, bool new_pa
 // ACCELERATION
 //=============================================================================
 //
-void ComakTarget::computeSimulatedAcceleration(SimTK::State s, const SimTK::Vector &parameters, SimTK::Vector &sim_udot) 
+SimTK::State& ComakTarget::updWorkingState(const SimTK::State& input_state)
+/**
+* The acceleration helpers modify the coordinates, actuator overrides and
+* contact modeling options of the state they are given. Rather than copying
+* the full State (including all cache entries) on every call, a single
+* working copy is allocated once and its time, continuous state variables
+* and the discrete variables the helpers change are reset for each call.
+*/
+{
+    if (!_working_state_is_allocated) {
+        _working_state = input_state;
+        _working_state_is_allocated = true;
+        return _working_state;
+    }
+
+    //Discrete variables are only set if they differ, so the stages they
+    //invalidate are not recomputed needlessly
+    for (const ScalarActuator& actuator :
+        _model->getComponentList<ScalarActuator>()) {
+
+        bool overridden = actuator.isActuationOverridden(input_state);
+        if (actuator.isActuationOverridden(_working_state) != overridden) {
+            actuator.overrideActuation(_working_state, overridden);
+        }
+
+        double value = actuator.getOverrideActuation(input_state);
+        if (actuator.getOverrideActuation(_working_state) != value) {
+            actuator.setOverrideActuation(_working_state, value);
+        }
+    }
+
+    for (const Smith2018ArticularContactForce& cnt_frc :
+        _model->getComponentList<Smith2018ArticularContactForce>()) {
+
+        bool fixed = cnt_frc.getFixedContactCorrespondence(input_state);
+        if (cnt_frc.getFixedContactCorrespondence(_working_state) != fixed) {
+            cnt_frc.setFixedContactCorrespondence(_working_state, fixed);
+        }
+    }
+
+    _working_state.setTime(input_state.getTime());
+    _working_state.updY() = input_state.getY();
+
+    return _working_state;
+}
+
+void ComakTarget::computeSimulatedAcceleration(const SimTK::State& input_state, const SimTK::Vector &parameters, SimTK::Vector &sim_udot) 
 {
+    SimTK::State& s = updWorkingState(input_state);
+
     //Apply Muscle Forces
     int j = 0;
     for (int i = 0; i < _nMuscles; ++i) {
@@ -402,12 +555,14 @@ void ComakTarget::computeSimulatedAcceleration(SimTK::State s, const SimTK::Vect
     }
 }
 
-void ComakTarget::computeUnitUdot(SimTK::State s, const SimTK::Vector& parameters) 
+void ComakTarget::computeUnitUdot(const SimTK::State& input_state, const SimTK::Vector& parameters) 
 /**
 *
 * act_unit_udot: rows - coordinates, columns - actuators
 */
 {
+    SimTK::State& s = updWorkingState(input_state);
+
     _msl_unit_udot.resize(_nConstraints, _nMuscles);
     _non_muscle_actuator_unit_udot.resize(_nConstraints, _nNonMuscleActuators);
     _secondary_coord_unit_udot.resize(_nConstraints, _nSecondaryCoord);
@@ -459,6 +614,16 @@ void ComakTarget::computeUnitUdot(SimTK::State s, const SimTK::Vector& parameter
         current_cnt_energy += cnt_frc.getOutputValue<double>(s,"potential_energy");
     }
 
+    //Hold the contacting triangles found at the current pose fixed for all
+    //unit udot perturbations, the option is set and reset only once because
+    //each change invalidates the state
+    if (_fixed_contact_correspondence) {
+        for (const Smith2018ArticularContactForce& cnt_frc : 
+            _model->getComponentList<Smith2018ArticularContactForce>()) {
+            cnt_frc.setFixedContactCorrespondence(s, true);
+        }
+    }
+
     //Compute Muscle Unit Udot
     j = 0;
     for (int i = 0; i < _nMuscles; ++i) {
@@ -536,7 +701,6 @@ void ComakTarget::computeUnitUdot(SimTK::State s, const SimTK::Vector& parameter
         value = parameters(_nActuators + j);
         _model->updComponent<Coordinate>(_secondary_coords[j]).setValue(s, value, true);
     }
-    _model->realizeAcceleration(s);
 
     //Compute COMAK damping unit udot
     SimTK::Vector org_reserve_frc(_nSecondaryCoord,0.0);
@@ -571,6 +735,12 @@ void ComakTarget::computeUnitUdot(SimTK::State s, const SimTK::Vector& parameter
         actuator.setOverrideActuation(s, 0.0);		
     }
 
+    if (_fixed_contact_correspondence) {
+        for (const Smith2018ArticularContactForce& cnt_frc :
+            _model->getComponentList<Smith2018ArticularContactForce>()) {
+            cnt_frc.setFixedContactCorrespondence(s, false);
+        }
+    }
     _model->realizeAcceleration(s);
 }
 
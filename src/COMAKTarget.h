@@ -28,6 +28,21 @@
 //=============================================================================
 namespace OpenSim { 
 
+/**
+Unit udot matrices and the linearization point they were computed at. Used to
+carry the constraint sensitivities from one COMAK iteration to the next so 
+they can be updated rather than recomputed.
+ */
+struct ComakUnitUdot {
+    SimTK::Vector parameters;
+    SimTK::Vector constraint_initial_udot;
+    SimTK::Matrix msl_unit_udot;
+    SimTK::Matrix non_muscle_actuator_unit_udot;
+    SimTK::Matrix secondary_coord_unit_udot;
+    SimTK::Matrix secondary_damping_unit_udot;
+    SimTK::Vector secondary_coord_unit_energy;
+};
+
 /**
 
  */
@@ -39,7 +54,7 @@ class ComakTarget : public SimTK::OptimizerSystem
 // METHODS
 //=============================================================================
 public:
-    ComakTarget(SimTK::State s, Model* aModel, const SimTK::Vector& observed_udot, 
+    ComakTarget(const SimTK::State& s, Model* aModel, const SimTK::Vector& observed_udot, 
         const SimTK::Vector& init_parameters,
         const Array<std::string>& parameter_names,
         Array<std::string> primary_coords, Array<std::string> secondary_coords,
@@ -121,13 +136,42 @@ public:
         _prev_secondary_values = prev_secondary_values;
     }
 
+    /** Use a Broyden rank-one update of the secondary coordinate unit udot
+    matrix from prev_unit_udot instead of recomputing all unit udots. The 
+    update is rejected (and a full recompute performed) if any secondary 
+    coordinate moved more than max_step or if the relative error of the 
+    acceleration change predicted by prev_unit_udot exceeds tolerance.*/
+    void setPreviousUnitUdot(const ComakUnitUdot& prev_unit_udot,
+        double max_step, double tolerance) {
+        _prev_unit_udot = prev_unit_udot;
+        _use_unit_udot_update = true;
+        _unit_udot_update_max_step = max_step;
+        _unit_udot_update_tolerance = tolerance;
+    }
+
+    /** Freeze the contact correspondence of all 
+    Smith2018ArticularContactForces while the unit udots are computed. This
+    approximates the secondary coordinate unit udots, triangles that come
+    into contact due to a perturbation are ignored.*/
+    void setUseFixedContactCorrespondence(bool fixed) {
+        _fixed_contact_correspondence = fixed;
+    }
+
+    ComakUnitUdot getUnitUdot() const;
+
+    bool getUnitUdotWasUpdated() const {
+        return _unit_udot_was_updated;
+    }
+
     //Helper
-    void computeSimulatedAcceleration(SimTK::State s, const SimTK::Vector &parameters, SimTK::Vector& sim_udot);
-    void computeUnitUdot(SimTK::State s, const SimTK::Vector& parameters);
+    void computeSimulatedAcceleration(const SimTK::State& s, const SimTK::Vector &parameters, SimTK::Vector& sim_udot);
+    void computeUnitUdot(const SimTK::State& s, const SimTK::Vector& parameters);
+    bool updateUnitUdot();
     void precomputeConstraintMatrix();
     void setParameterBounds(double scale);
     void printPerformance(SimTK::Vector parameters);
 private:
+    SimTK::State& updWorkingState(const SimTK::State& s);
 
     //=============================================================================
     // DATA
@@ -137,6 +181,8 @@ public:
 private:
     Model *_model;
     SimTK::State _state;
+    SimTK::State _working_state;
+    bool _working_state_is_allocated;
     SimTK::Vector _optimalForce;
     SimTK::Vector _init_parameters;
     bool _useMusclePhysiology;
@@ -193,6 +239,13 @@ private:
     SimTK::Vector _initial_udot;
     SimTK::Vector _constraint_initial_udot;
     SimTK::Vector _constraint_desired_udot;
+
+    ComakUnitUdot _prev_unit_udot;
+    bool _use_unit_udot_update;
+    bool _unit_udot_was_updated;
+    double _unit_udot_update_max_step;
+    double _unit_udot_update_tolerance;
+    bool _fixed_contact_correspondence;
 protected:
 };
 
@@ -28,6 +28,10 @@
 #include "HelperFunctions.h"
 #include "Smith2018ArticularContactForce.h"
 #include <OpenSim/Common/Stopwatch.h>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cmath>
 
 using namespace OpenSim;
 using namespace SimTK;
@@ -74,15 +78,28 @@ void COMAKTool::constructProperties()
     constructProperty_print_settle_sim_results(false);
     constructProperty_settle_sim_results_directory("");
     constructProperty_settle_sim_results_prefix("");
+    constructProperty_use_settle_cache(false);
+    constructProperty_settle_cache_directory("");
 
     constructProperty_max_iterations(50);
     constructProperty_udot_tolerance(1.0);
     constructProperty_udot_worse_case_tolerance(50.0);
     constructProperty_unit_udot_epsilon(1e-8);
+    constructProperty_use_unit_udot_update(false);
+    constructProperty_unit_udot_update_max_step(0.005);
+    constructProperty_unit_udot_update_tolerance(0.25);
+    constructProperty_unit_udot_fixed_contact_correspondence(false);
+    constructProperty_coarse_frame_step(-1);
+    constructProperty_coarse_udot_tolerance(5.0);
+    constructProperty_coarse_max_iterations(10);
+    constructProperty_coarse_pass_only(false);
     
     constructProperty_contact_energy_weight(0.0);
     constructProperty_COMAKCostFunctionParameterSet(COMAKCostFunctionParameterSet());
 
+    constructProperty_write_h5_results_file(false);
+    constructProperty_resume(false);
+    constructProperty_num_output_threads(0);
     constructProperty_use_visualizer(false);    
     constructProperty_verbose(0);
 
@@ -447,10 +464,30 @@ void COMAKTool::performCOMAK()
     //Read Kinematics and Compute Desired Accelerations
     extractKinematicsFromFile();
 
+    //Setup Results Storage
+    initializeResultsStorage();
+
+    OPENSIM_THROW_IF(get_resume() && !get_write_h5_results_file(), Exception,
+        "resume requires write_h5_results_file to be true, the checkpoint "
+        "is stored in the .h5 results file.")
+
+    int resume_frame = -1;
+    if (get_write_h5_results_file()) {
+        resume_frame = initializeH5Results();
+    }
+
+    _output_pipeline = std::make_shared<OutputPipeline>(
+        get_num_output_threads());
+
     //Initialize Secondary Kinematics
     SimTK::Vector init_secondary_values(_n_secondary_coord);
 
-    if (get_settle_secondary_coordinates_at_start()) {
+    if (resume_frame > -1) {
+        for (int i = 0; i < _n_secondary_coord; ++i) {
+            init_secondary_values(i) = _optim_parameters[_n_actuators + i];
+        }
+    }
+    else if (get_settle_secondary_coordinates_at_start()) {
         init_secondary_values = equilibriateSecondaryCoordinates();
     }
     else {
@@ -496,8 +533,6 @@ void COMAKTool::performCOMAK()
     }
     state = _model.initSystem();
 
-    //Setup Results Storage
-    initializeResultsStorage();
     AnalysisSet& analysisSet = _model.updAnalysisSet();
 
     //Prepare for Optimization
@@ -508,9 +543,10 @@ void COMAKTool::performCOMAK()
     }
     
     // initialize optimization parameters
-    for (int i = 0; i < _n_muscles; ++i) {
-        _optim_parameters[i] = 0.02;
-        
+    if (resume_frame == -1) {
+        for (int i = 0; i < _n_muscles; ++i) {
+            _optim_parameters[i] = 0.02;
+        }
     }
     for (int i = 0; i < _n_secondary_coord; ++i) {
         _optim_parameters[i + _n_actuators] = init_secondary_values(i);
@@ -536,22 +572,132 @@ void COMAKTool::performCOMAK()
         viz->setShowSimTime(true);
     }
 
-    _consecutive_bad_frame = 1;
+    if (resume_frame == -1) {
+        _consecutive_bad_frame = 1;
+    }
+    _analysis_set_begun = false;
 
-    //Loop over each time step
-    //------------------------
-    std::cout << "\nPerforming COMAK...\n" << std::endl;
+    if (resume_frame > -1) {
+        replayH5Analyses(state);
+    }
 
-    int frame_num = 0;
+    //Frames to solve, if coarse_frame_step is set the coarse pass frames
+    //(every coarse_frame_step frame and the last frame) are solved first
+    std::vector<int> frames;
     for (int i = 0; i < _n_frames; ++i) {
         if (_time[i] < get_start_time()) { continue; }
         if (_time[i] > get_stop_time()) { break; };
+        frames.push_back(i);
+    }
+
+    std::vector<int> frame_sequence;
+    int n_coarse_frames = 0;
+
+    if (get_coarse_frame_step() > 1 && !frames.empty()) {
+        for (int f = 0; f < (int)frames.size(); f += get_coarse_frame_step()) {
+            frame_sequence.push_back(frames[f]);
+        }
+        if (frame_sequence.back() != frames.back()) {
+            frame_sequence.push_back(frames.back());
+        }
+        n_coarse_frames = (int)frame_sequence.size();
+    }
+
+    if (n_coarse_frames == 0 || !get_coarse_pass_only()) {
+        frame_sequence.insert(frame_sequence.end(), frames.begin(), frames.end());
+    }
+
+    //Initial values are restored at the start of the full-rate pass
+    SimTK::Vector init_optim_parameters = _optim_parameters;
+    int init_consecutive_bad_frame = _consecutive_bad_frame;
+    std::vector<int> init_bad_frames = _bad_frames;
+    std::vector<double> init_bad_times = _bad_times;
+    std::vector<double> init_bad_udot_errors = _bad_udot_errors;
+    std::vector<std::string> init_bad_udot_coord = _bad_udot_coord;
+    double full_rate_dt = _dt;
+
+    _coarse_frames.clear();
+    _coarse_parameters.clear();
+
+    //Checkpoints are only written in the full-rate pass, so on resume the
+    //coarse pass was completed and its solution is restored
+    bool skip_coarse_pass = false;
+    if (resume_frame > -1 && n_coarse_frames > 0 && 
+        !get_coarse_pass_only()) {
+        readH5CoarseSolution();
+        skip_coarse_pass = true;
+    }
+
+    //Loop over each time step
+    //------------------------
+    if (n_coarse_frames > 0) {
+        std::cout << "\nPerforming coarse COMAK pass...\n" << std::endl;
+    }
+    else {
+        std::cout << "\nPerforming COMAK...\n" << std::endl;
+    }
+
+    int frame_num = 0;
+    for (int f = 0; f < (int)frame_sequence.size(); ++f) {
+        int i = frame_sequence[f];
+
+        bool coarse_pass = f < n_coarse_frames;
+        bool record_results = !coarse_pass || get_coarse_pass_only();
+        int n_pass_frames = coarse_pass ? n_coarse_frames : _n_out_frames;
+
+        int max_iterations = coarse_pass ? 
+            get_coarse_max_iterations() : get_max_iterations();
+        double udot_tolerance = coarse_pass ? 
+            get_coarse_udot_tolerance() : get_udot_tolerance();
+
+        //Start of full-rate pass
+        if (f == n_coarse_frames && n_coarse_frames > 0) {
+            std::cout << "\nPerforming full-rate COMAK pass...\n" << std::endl;
+
+            _optim_parameters = init_optim_parameters;
+            _prev_parameters = init_optim_parameters;
+            for (int m = 0; m < _n_secondary_coord; ++m) {
+                _prev_secondary_value(m) = 
+                    init_optim_parameters(_n_actuators + m);
+            }
+            _consecutive_bad_frame = init_consecutive_bad_frame;
+            _bad_frames = init_bad_frames;
+            _bad_times = init_bad_times;
+            _bad_udot_errors = init_bad_udot_errors;
+            _bad_udot_coord = init_bad_udot_coord;
+
+            frame_num = 0;
+        }
+
+        if (coarse_pass && f > 0) {
+            _dt = _time[i] - _time[frame_sequence[f - 1]];
+        }
+        else {
+            _dt = full_rate_dt;
+        }
+
+        //Skip frames completed before the checkpoint
+        if ((coarse_pass && skip_coarse_pass) ||
+            (record_results && i <= resume_frame)) {
+            frame_num++;
+            continue;
+        }
 
         //Set Time
         state.setTime(_time[i]);
 
-        std::cout << "Frame: " << ++frame_num << "/" << _n_out_frames << "\t" 
+        std::cout << "Frame: " << ++frame_num << "/" << n_pass_frames << "\t" 
                   << "Time: " << _time[i] << std::endl;
+
+        //Initial guess interpolated from the coarse pass solution
+        if (!coarse_pass && !_coarse_frames.empty()) {
+            _optim_parameters = interpolateCoarseParameters(i);
+
+            for (int j = 0; j < _n_secondary_coord; ++j) {
+                Coordinate& coord = _model.updComponent<Coordinate>(_secondary_coord_path[j]);
+                coord.setValue(state, _optim_parameters[_n_actuators + j], false);
+            }
+        }
         //std::cout << "================================================================================" << std::endl;
 
         //Set Primary Qs and Us to experimental values
@@ -572,13 +718,14 @@ void COMAKTool::performCOMAK()
 
         //Iterate for COMAK Solution
         double max_udot_error = SimTK::Infinity;
-        SimTK::Vector iter_max_udot_error(get_max_iterations(), 0.0);
-        std::vector<std::string> iter_max_udot_coord(get_max_iterations(), "");
-        SimTK::Matrix iter_parameters(get_max_iterations(), _n_parameters, 0.0);
+        SimTK::Vector iter_max_udot_error(max_iterations, 0.0);
+        std::vector<std::string> iter_max_udot_coord(max_iterations, "");
+        SimTK::Matrix iter_parameters(max_iterations, _n_parameters, 0.0);
 
+        ComakUnitUdot prev_unit_udot;
         int n_iter = 0;
 
-        for (int iter = 0; iter < get_max_iterations(); ++iter) {
+        for (int iter = 0; iter < max_iterations; ++iter) {
             n_iter++;
 
             if (get_verbose() > 0) {
@@ -618,7 +765,7 @@ void COMAKTool::performCOMAK()
             }
 
             target.setCostFunctionWeight(msl_weight);
-            target.setUdotTolerance(get_udot_tolerance());
+            target.setUdotTolerance(udot_tolerance);
             target.setUnitUdotEpsilon(get_unit_udot_epsilon());
             target.setDT(_dt);
             target.setOptimalForces(_optimal_force);
@@ -627,8 +774,26 @@ void COMAKTool::performCOMAK()
             target.setSecondaryCoordinateDamping(_secondary_coord_damping);
             target.setMaxChange(_secondary_coord_max_change);
             target.setContactEnergyWeight(get_contact_energy_weight());
+            target.setUseFixedContactCorrespondence(
+                get_unit_udot_fixed_contact_correspondence());
+
+            if (get_use_unit_udot_update() && iter > 0) {
+                target.setPreviousUnitUdot(prev_unit_udot,
+                    get_unit_udot_update_max_step(),
+                    get_unit_udot_update_tolerance());
+            }
             target.initialize();
 
+            if (get_use_unit_udot_update()) {
+                prev_unit_udot = target.getUnitUdot();
+
+                if (get_verbose() > 1) {
+                    std::cout << "Unit udot: " << 
+                        (target.getUnitUdotWasUpdated() ? 
+                            "Broyden update" : "full recompute") << std::endl;
+                }
+            }
+
             SimTK::OptimizerAlgorithm algorithm = SimTK::InteriorPoint;
             SimTK::Optimizer optimizer(target, algorithm);
 
@@ -739,14 +904,14 @@ void COMAKTool::performCOMAK()
 
             
             //Check for convergence
-            if (max_udot_error < get_udot_tolerance()) {
+            if (max_udot_error < udot_tolerance) {
                 _consecutive_bad_frame = 1; //converged so reset
                 break;
             }
             
         }// END COMAK ITERATION
                 
-        if (max_udot_error > get_udot_tolerance()) {
+        if (max_udot_error > udot_tolerance) {
             std::cout << std::endl;
             std::cout << "COMAK failed to converge." << std::endl;
 
@@ -756,7 +921,7 @@ void COMAKTool::performCOMAK()
             double min_val = get_udot_worse_case_tolerance();
             int min_iter = -1;
             std::string bad_coord;
-            for (int m = 0; m < get_max_iterations(); ++m) {
+            for (int m = 0; m < max_iterations; ++m) {
                 if (iter_max_udot_error(m) < min_val) {
                     min_val = iter_max_udot_error(m);
                     min_iter = m;
@@ -810,8 +975,24 @@ void COMAKTool::performCOMAK()
             _prev_secondary_value(m) = coord.getValue(state);
         }
 
+        if (coarse_pass) {
+            _coarse_frames.push_back(i);
+            _coarse_parameters.push_back(_optim_parameters);
+
+            if (f == n_coarse_frames - 1 && !get_coarse_pass_only() &&
+                get_write_h5_results_file()) {
+                writeH5CoarseSolution();
+            }
+        }
+
         //Save the results
-        recordResultsStorage(state,i);
+        if (record_results) {
+            recordResultsStorage(state, i);
+
+            if (get_write_h5_results_file()) {
+                writeH5Checkpoint(i);
+            }
+        }
  
         //Visualize the Results
         if (get_use_visualizer()) {
@@ -848,8 +1029,39 @@ void COMAKTool::performCOMAK()
             std::cout << std::setw(15) << _bad_times[i] << std::setw(15) << _bad_frames[i] << std::setw(15) << _bad_udot_errors[i] << std::endl;
         }
     }
+    _dt = full_rate_dt;
+
     //Print Results
     printResultsFiles();
+
+    _output_pipeline->finish();
+    _output_pipeline.reset();
+
+    if (get_write_h5_results_file()) {
+        _h5_results.close();
+    }
+}
+
+SimTK::Vector COMAKTool::interpolateCoarseParameters(int frame) {
+    int n = (int)_coarse_frames.size();
+
+    if (frame <= _coarse_frames[0]) {
+        return _coarse_parameters[0];
+    }
+    if (frame >= _coarse_frames[n - 1]) {
+        return _coarse_parameters[n - 1];
+    }
+
+    int k = 1;
+    while (_coarse_frames[k] < frame) {
+        k++;
+    }
+
+    double t0 = _time[_coarse_frames[k - 1]];
+    double t1 = _time[_coarse_frames[k]];
+    double w = (_time[frame] - t0) / (t1 - t0);
+
+    return (1.0 - w) * _coarse_parameters[k - 1] + w * _coarse_parameters[k];
 }
 
 void COMAKTool::setStateFromComakParameters(SimTK::State& state, const SimTK::Vector& parameters) {
@@ -920,16 +1132,286 @@ void COMAKTool::initializeResultsStorage() {
     _result_values.setColumnLabels(values_names);
 }
 
+int COMAKTool::initializeH5Results() {
+    std::string h5_file = get_results_directory() + "/" + 
+        get_results_prefix() + "_results.h5";
+
+    _h5_results.open(h5_file, get_resume());
+
+    OPENSIM_THROW_IF(_h5_results.exists("/States") && 
+        _h5_results.isGroup("/States"), Exception, h5_file + " has a "
+        "dataset per column and can not be resumed, it was written by an "
+        "older version of the COMAKTool.")
+
+    //Each frame is appended as one row of a (frames x columns) dataset,
+    //the column labels are stored in its components attribute
+    Array<std::string> state_names = _model.getStateVariableNames();
+    std::vector<std::string> states_labels;
+    for (int m = 0; m < state_names.size(); ++m) {
+        states_labels.push_back(state_names[m]);
+    }
+
+    std::vector<std::string> results_paths{ 
+        "/States", "/Activation", "/Force", "/Kinematics" };
+    std::vector<std::vector<std::string>> results_labels{ states_labels,
+        _result_activations.getColumnLabels(),
+        _result_forces.getColumnLabels(),
+        _result_kinematics.getColumnLabels() };
+
+    for (int p = 0; p < (int)results_paths.size(); ++p) {
+        const std::string& path = results_paths[p];
+        int n_cols = (int)results_labels[p].size();
+
+        _h5_results.createExtendibleDataSet(path, n_cols);
+
+        OPENSIM_THROW_IF(
+            _h5_results.openDataSetView(path).getNumColumns() != n_cols,
+            Exception, h5_file + ": " + path + " does not match the "
+            "columns of the model results.")
+
+        _h5_results.writeStringArrayAttribute(
+            path, "components", results_labels[p]);
+    }
+    _h5_results.createGroup("/Checkpoint");
+
+    int frame = -1;
+    int num_rows = 0;
+
+    if (get_resume()) {
+        if (_h5_results.exists("/Checkpoint/frame")) {
+            frame = (int)_h5_results.
+                readDataSetSimTKVector("/Checkpoint/frame")(0);
+            num_rows = (int)_h5_results.
+                readDataSetSimTKVector("/Checkpoint/num_rows")(0);
+            double time = _h5_results.
+                readDataSetSimTKVector("/Checkpoint/time")(0);
+
+            OPENSIM_THROW_IF(frame >= _n_frames || 
+                std::fabs(_time[frame] - time) > SimTK::SignificantReal,
+                Exception, "The checkpoint in " + h5_file + " does not "
+                "match the time in the coordinates_file.")
+
+            SimTK::Vector parameters = _h5_results.
+                readDataSetSimTKVector("/Checkpoint/optim_parameters");
+
+            OPENSIM_THROW_IF(parameters.size() != _n_parameters, Exception,
+                "The checkpoint in " + h5_file + " does not match the "
+                "COMAK parameters of the model.")
+
+            _optim_parameters = parameters;
+            _consecutive_bad_frame = (int)_h5_results.readDataSetSimTKVector(
+                "/Checkpoint/consecutive_bad_frame")(0);
+
+            if (_h5_results.exists("/Checkpoint/bad_frames")) {
+                SimTK::Vector bad_frames = _h5_results.
+                    readDataSetSimTKVector("/Checkpoint/bad_frames");
+                SimTK::Vector bad_times = _h5_results.
+                    readDataSetSimTKVector("/Checkpoint/bad_times");
+                SimTK::Vector bad_udot_errors = _h5_results.
+                    readDataSetSimTKVector("/Checkpoint/bad_udot_errors");
+                std::vector<std::string> bad_udot_coord = _h5_results.
+                    readStringArrayAttribute("/Checkpoint/bad_frames",
+                        "bad_udot_coord");
+
+                for (int m = 0; m < bad_frames.size(); ++m) {
+                    _bad_frames.push_back((int)bad_frames(m));
+                    _bad_times.push_back(bad_times(m));
+                    _bad_udot_errors.push_back(bad_udot_errors(m));
+                    _bad_udot_coord.push_back(m < (int)bad_udot_coord.size()
+                        ? bad_udot_coord[m] : "");
+                }
+            }
+            std::cout << "Resuming COMAK from checkpoint at time: " 
+                << time << std::endl;
+        }
+        else {
+            std::cout << "No checkpoint found in " << h5_file 
+                << ", starting COMAK from the first frame." << std::endl;
+        }
+    }
+
+    //Discard results written after the last checkpoint
+    if (_h5_results.getDataSetSize("/time") > num_rows) {
+        _h5_results.resizeDataSet("/time", num_rows);
+    }
+
+    for (const std::string& path : results_paths) {
+        if (_h5_results.openDataSetView(path).getNumRows() > num_rows) {
+            _h5_results.resizeDataSet(path, num_rows);
+        }
+    }
+    return frame;
+}
+
+void COMAKTool::writeH5Checkpoint(int frame) {
+    //Copy the checkpoint, the next frame is solved while it is written
+    double time = _time[frame];
+    SimTK::Vector optim_parameters = _optim_parameters;
+    double consecutive_bad_frame = _consecutive_bad_frame;
+
+    int n_bad = (int)_bad_frames.size();
+    SimTK::Vector bad_frames(n_bad);
+    SimTK::Vector bad_times(n_bad);
+    SimTK::Vector bad_udot_errors(n_bad);
+
+    for (int m = 0; m < n_bad; ++m) {
+        bad_frames(m) = _bad_frames[m];
+        bad_times(m) = _bad_times[m];
+        bad_udot_errors(m) = _bad_udot_errors[m];
+    }
+    std::vector<std::string> bad_udot_coord = _bad_udot_coord;
+
+    //The results of the frame are appended before the checkpoint, so
+    //num_rows includes them
+    _output_pipeline->submit([this, frame, time, optim_parameters,
+        consecutive_bad_frame, n_bad, bad_frames, bad_times,
+        bad_udot_errors, bad_udot_coord]() {
+        _h5_results.writeDataSetSimTKVector(
+            SimTK::Vector(1, (double)frame), "/Checkpoint/frame");
+        _h5_results.writeDataSetSimTKVector(
+            SimTK::Vector(1, time), "/Checkpoint/time");
+        _h5_results.writeDataSetSimTKVector(
+            SimTK::Vector(1, (double)_h5_results.getDataSetSize("/time")),
+            "/Checkpoint/num_rows");
+        _h5_results.writeDataSetSimTKVector(
+            optim_parameters, "/Checkpoint/optim_parameters");
+        _h5_results.writeDataSetSimTKVector(
+            SimTK::Vector(1, consecutive_bad_frame),
+            "/Checkpoint/consecutive_bad_frame");
+
+        if (n_bad > 0) {
+            _h5_results.writeDataSetSimTKVector(
+                bad_frames, "/Checkpoint/bad_frames");
+            _h5_results.writeDataSetSimTKVector(
+                bad_times, "/Checkpoint/bad_times");
+            _h5_results.writeDataSetSimTKVector(
+                bad_udot_errors, "/Checkpoint/bad_udot_errors");
+            _h5_results.writeStringArrayAttribute("/Checkpoint/bad_frames",
+                "bad_udot_coord", bad_udot_coord);
+        }
+        _h5_results.flush();
+    }, OutputPipeline::hdf5_sink);
+}
+
+void COMAKTool::writeH5CoarseSolution() {
+    int n = (int)_coarse_frames.size();
+
+    SimTK::Vector frames(n);
+    SimTK::Matrix parameters(n, _n_parameters);
+
+    for (int k = 0; k < n; ++k) {
+        frames(k) = _coarse_frames[k];
+        parameters[k] = ~_coarse_parameters[k];
+    }
+
+    _output_pipeline->submit([this, frames, parameters]() {
+        _h5_results.writeDataSetSimTKVector(
+            frames, "/Checkpoint/coarse_frames");
+        _h5_results.remove("/Checkpoint/coarse_parameters");
+        _h5_results.writeDataSetSimTKMatrix(
+            parameters, "/Checkpoint/coarse_parameters");
+        _h5_results.flush();
+    }, OutputPipeline::hdf5_sink);
+}
+
+void COMAKTool::readH5CoarseSolution() {
+    OPENSIM_THROW_IF(!_h5_results.exists("/Checkpoint/coarse_frames"),
+        Exception, "The checkpoint has no coarse pass solution, it was "
+        "written with a different coarse_frame_step.")
+
+    SimTK::Vector frames = 
+        _h5_results.readDataSetSimTKVector("/Checkpoint/coarse_frames");
+    SimTK::Matrix parameters = _h5_results.openDataSetView(
+        "/Checkpoint/coarse_parameters").readRows(0, frames.size());
+
+    OPENSIM_THROW_IF(parameters.ncol() != _n_parameters, Exception,
+        "The coarse pass solution in the checkpoint does not match the "
+        "COMAK parameters of the model.")
+
+    for (int k = 0; k < frames.size(); ++k) {
+        _coarse_frames.push_back((int)frames(k));
+        _coarse_parameters.push_back(~parameters[k]);
+    }
+}
+
+TimeSeriesTable COMAKTool::readH5ResultsTable(
+    const std::vector<std::string>& labels,
+    const std::string& dataset_path)
+{
+    SimTK::Vector time = _h5_results.readDataSetSimTKVector("/time");
+
+    std::vector<double> time_vec;
+    for (int r = 0; r < time.size(); ++r) {
+        time_vec.push_back(time(r));
+    }
+
+    SimTK::Matrix data = 
+        _h5_results.openDataSetView(dataset_path).readRows(0, time.size());
+
+    return TimeSeriesTable(time_vec, data, labels);
+}
+
+void COMAKTool::replayH5Analyses(const SimTK::State& state)
+{
+    if (_model.getAnalysisSet().getSize() == 0) return;
+
+    SimTK::Vector time = _h5_results.readDataSetSimTKVector("/time");
+    H5DataSetView states_view = _h5_results.openDataSetView("/States");
+    H5DataSetView forces_view = _h5_results.openDataSetView("/Force");
+
+    std::cout << "Replaying the " << time.size() << " frames before the "
+        "checkpoint through the AnalysisSet." << std::endl;
+
+    std::vector<std::string> actuator_paths;
+    for (int m = 0; m < _n_muscles; ++m) {
+        actuator_paths.push_back(_muscle_path[m]);
+    }
+    for (int m = 0; m < _n_non_muscle_actuators; ++m) {
+        actuator_paths.push_back(_non_muscle_actuator_path[m]);
+    }
+
+    SimTK::State s = state;
+    int frame = 0;
+
+    for (int r = 0; r < time.size(); ++r) {
+        //The analyses are stepped with the frame number, as in
+        //recordResultsStorage()
+        while (frame < _n_frames - 1 && 
+            _time[frame] < time(r) - SimTK::SignificantReal) {
+            frame++;
+        }
+
+        s.setTime(time(r));
+        _model.setStateVariableValues(s, states_view.readRow(r));
+
+        SimTK::Vector forces = forces_view.readRow(r);
+        for (int m = 0; m < (int)actuator_paths.size(); ++m) {
+            const ScalarActuator& actuator = 
+                _model.getComponent<ScalarActuator>(actuator_paths[m]);
+            actuator.overrideActuation(s, true);
+            actuator.setOverrideActuation(s, forces(m));
+        }
+        _model.realizeAcceleration(s);
+
+        if (!_analysis_set_begun) {
+            _model.updAnalysisSet().begin(s);
+            _analysis_set_begun = true;
+        }
+        else {
+            _model.updAnalysisSet().step(s, frame);
+        }
+    }
+}
+
 void COMAKTool::recordResultsStorage(const SimTK::State& state, int frame) {
-    if (frame == 0) {
+    if (!_analysis_set_begun) {
         _model.updAnalysisSet().begin(state);
+        _analysis_set_begun = true;
     }
     else {
         _model.updAnalysisSet().step(state, frame);
     }
 
-    _result_states.append(state);
-
     SimTK::RowVector activations(_n_actuators);
     SimTK::RowVector forces(_n_actuators);
 
@@ -938,9 +1420,6 @@ void COMAKTool::recordResultsStorage(const SimTK::State& state, int frame) {
         forces(m) = _optim_parameters(m)*_optimal_force(m);
     }
 
-    _result_activations.appendRow(_time[frame], activations);
-    _result_forces.appendRow(_time[frame], forces);
-
     SimTK::RowVector kinematics(_model.getNumCoordinates() * 3);
     SimTK::RowVector values(_model.getNumCoordinates());
 
@@ -955,6 +1434,27 @@ void COMAKTool::recordResultsStorage(const SimTK::State& state, int frame) {
         values(v) = coord.getValue(state);
         v++;
     }
+
+    //Stream to .h5 file instead of holding the results in memory
+    if (get_write_h5_results_file()) {
+        double time = _time[frame];
+        SimTK::RowVector states = ~_model.getStateVariableValues(state);
+
+        //One row of each (frames x columns) dataset
+        _output_pipeline->submit([this, time, states, activations, forces,
+            kinematics]() {
+            _h5_results.appendDataSetValue(time, "/time");
+            _h5_results.appendDataSetVectorRow(~states, "/States");
+            _h5_results.appendDataSetVectorRow(~activations, "/Activation");
+            _h5_results.appendDataSetVectorRow(~forces, "/Force");
+            _h5_results.appendDataSetVectorRow(~kinematics, "/Kinematics");
+        }, OutputPipeline::hdf5_sink);
+        return;
+    }
+
+    _result_states.append(state);
+    _result_activations.appendRow(_time[frame], activations);
+    _result_forces.appendRow(_time[frame], forces);
     _result_kinematics.appendRow(_time[frame], kinematics);
     _result_values.appendRow(_time[frame], values);
 
@@ -968,24 +1468,68 @@ void COMAKTool::printResultsFiles() {
             "Possible reason: This tool cannot make new folder with subfolder.");
     }
 
-    STOFileAdapter sto;
-    TimeSeriesTable states_table = _result_states.exportToTable(_model);
+    //Read back the results streamed to the .h5 file
+    TimeSeriesTable states_table;
+
+    if (get_write_h5_results_file()) {
+        _output_pipeline->wait();
+
+        Array<std::string> state_names = _model.getStateVariableNames();
+        std::vector<std::string> states_labels;
+        for (int m = 0; m < state_names.size(); ++m) {
+            states_labels.push_back(state_names[m]);
+        }
+        states_table = readH5ResultsTable(states_labels, "/States");
+
+        _result_activations = readH5ResultsTable(
+            _result_activations.getColumnLabels(), "/Activation");
+        _result_forces = readH5ResultsTable(
+            _result_forces.getColumnLabels(), "/Force");
+        _result_kinematics = readH5ResultsTable(
+            _result_kinematics.getColumnLabels(), "/Kinematics");
+
+        //The values are every third (value, speed, acc) kinematics column
+        const auto& kinematics = _result_kinematics.getMatrix();
+        SimTK::Matrix values(kinematics.nrow(), kinematics.ncol() / 3);
+        for (int m = 0; m < values.ncol(); ++m) {
+            values(m) = kinematics(3 * m);
+        }
+        _result_values = TimeSeriesTable(
+            _result_kinematics.getIndependentColumn(), values,
+            _result_values.getColumnLabels());
+    }
+    else {
+        states_table = _result_states.exportToTable(_model);
+    }
+
+    //Each .sto file is written by a separate job that owns a copy of its
+    //table, so the job stays valid if this function throws before the wait
+    std::string basefile = get_results_directory() + "/" + get_results_prefix();
+
+    auto submitSTOFile = [this](const TimeSeriesTable& table,
+        const std::string& file) {
+        auto job_table = std::make_shared<TimeSeriesTable>(table);
+        _output_pipeline->submit([job_table, file]() {
+            STOFileAdapter sto;
+            sto.write(*job_table, file); });
+    };
+
     states_table.addTableMetaData("header", std::string("COMAK Model States"));
     states_table.addTableMetaData("nRows", std::to_string(states_table.getNumRows()));
     states_table.addTableMetaData("nColumns", std::to_string(states_table.getNumColumns() + 1));
-    sto.write(states_table, get_results_directory() + "/" + get_results_prefix() + "_states.sto");
+    submitSTOFile(states_table, basefile + "_states.sto");
 
     _result_activations.addTableMetaData("header", std::string("COMAK Actuator Activations"));
     _result_activations.addTableMetaData("nRows", std::to_string(_result_activations.getNumRows()));
     _result_activations.addTableMetaData("nColumns", std::to_string( _result_activations.getNumColumns() + 1));
 
-    sto.write(_result_activations, get_results_directory() + "/" + get_results_prefix() + "_activation.sto");
+    submitSTOFile(_result_activations, basefile + "_activation.sto");
 
     _result_forces.addTableMetaData("header", std::string("COMAK Actuator Forces"));
     _result_forces.addTableMetaData("nRows", std::to_string(_result_forces.getNumRows()));
     _result_forces.addTableMetaData("nColumns", std::to_string(_result_forces.getNumColumns() + 1));
 
-    sto.write(_result_forces, get_results_directory() + "/" + get_results_prefix() + "_force.sto");
+    submitSTOFile(_result_forces, basefile + "_force.sto");
 
     _result_kinematics.addTableMetaData("inDegrees", std::string("no"));
     _model.getSimbodyEngine().convertRadiansToDegrees(_result_kinematics);
@@ -993,7 +1537,7 @@ void COMAKTool::printResultsFiles() {
     _result_kinematics.addTableMetaData("nRows", std::to_string(_result_kinematics.getNumRows()));
     _result_kinematics.addTableMetaData("nColumns", std::to_string(_result_kinematics.getNumColumns() + 1));
 
-    sto.write(_result_kinematics, get_results_directory() + "/" + get_results_prefix() + "_kinematics.sto");
+    submitSTOFile(_result_kinematics, basefile + "_kinematics.sto");
 
     _result_values.addTableMetaData("inDegrees", std::string("no"));
     _model.getSimbodyEngine().convertRadiansToDegrees(_result_values);
@@ -1001,11 +1545,39 @@ void COMAKTool::printResultsFiles() {
     _result_values.addTableMetaData("nRows", std::to_string(_result_values.getNumRows()));
     _result_values.addTableMetaData("nColumns", std::to_string(_result_values.getNumColumns() + 1));
 
-    sto.write(_result_values, get_results_directory() + "/" + get_results_prefix() + "_values.sto");
+    submitSTOFile(_result_values, basefile + "_values.sto");
+
+    _output_pipeline->wait();
 }
 
 SimTK::Vector COMAKTool::equilibriateSecondaryCoordinates() 
 {
+    //Reuse cached settled state from a previous run with the same inputs
+    std::string cache_file;
+    if (get_use_settle_cache()) {
+        cache_file = computeSettleCacheFileName();
+
+        SimTK::Vector secondary_q;
+        if (readSettleCache(cache_file, secondary_q)) {
+            std::cout << std::endl;
+            std::cout << "Using cached settled secondary coordinate values: "
+                << cache_file << std::endl;
+
+            for (int i = 0; i < _n_secondary_coord; ++i) {
+                std::cout << _secondary_coord_name[i] << ": " <<
+                    secondary_q(i) << std::endl;
+            }
+
+            if (get_print_settle_sim_results()) {
+                std::cout << "print_settle_sim_results is ignored, the "
+                    "settling simulation was not run. Set use_settle_cache "
+                    "to false to print the settle simulation results." 
+                    << std::endl;
+            }
+            return secondary_q;
+        }
+    }
+
     Model settle_model = _model;
     SimTK::State state = settle_model.initSystem();
 
@@ -1072,7 +1644,7 @@ SimTK::Vector COMAKTool::equilibriateSecondaryCoordinates()
         msl.setOverrideActuation(state, value);
     }
 
-    StatesTrajectory result_states;
+    CompactStatesTrajectory result_states;
 
     // Store Secondary Coordinate Values (to check if simulation is settled)
     SimTK::Vector prev_sec_coord_value(_n_secondary_coord);
@@ -1164,6 +1736,25 @@ SimTK::Vector COMAKTool::equilibriateSecondaryCoordinates()
         }
     }
 
+    //Cache the settled state
+    if (get_use_settle_cache()) {
+        CompactStatesTrajectory settled_states;
+        settled_states.append(state);
+
+        TimeSeriesTable settled_table = 
+            settled_states.exportToTable(settle_model);
+        settled_table.addTableMetaData(
+            "header", std::string("COMAK Settled State"));
+        settled_table.addTableMetaData(
+            "nRows", std::to_string(settled_table.getNumRows()));
+        settled_table.addTableMetaData(
+            "nColumns", std::to_string(settled_table.getNumColumns() + 1));
+        settled_table.addTableMetaData("inDegrees", std::string("no"));
+
+        STOFileAdapter sto;
+        sto.write(settled_table, cache_file);
+    }
+
     //Collect Settled Secondary Q values;
     SimTK::Vector secondary_q(_n_secondary_coord);
     for (int i = 0; i < _n_secondary_coord; ++i) {
@@ -1178,6 +1769,142 @@ SimTK::Vector COMAKTool::equilibriateSecondaryCoordinates()
     return secondary_q;
 }
 
+std::string COMAKTool::computeSettleCacheFileName()
+{
+    //Collect all inputs that determine the settled state. The external
+    //loads files are hashed by contents, but the model dump includes path
+    //properties (e.g. mesh_file), so a model that refers to moved or
+    //renamed files gets a different key.
+    std::stringstream key;
+    key << std::setprecision(17);
+
+    //The model as it is simulated, including the replaced force set,
+    //the COMAK damping actuators and all actuator properties
+    key << _model.dump() << "\n";
+
+    //Contact mesh geometry and material properties
+    for (const Smith2018ContactMesh& mesh : 
+        _model.getComponentList<Smith2018ContactMesh>()) {
+        key << mesh.getAbsolutePathString() << "\n";
+        
+        const SimTK::Vector_<SimTK::Vec3>& vertices = 
+            mesh.getVertexLocations();
+        for (int i = 0; i < vertices.size(); ++i) {
+            key << vertices(i) << "\n";
+        }
+
+        const SimTK::Matrix_<SimTK::Vec3>& face_vertices = 
+            mesh.getFaceVertexLocations();
+        for (int i = 0; i < mesh.getNumFaces(); ++i) {
+            for (int j = 0; j < face_vertices.ncol(); ++j) {
+                key << face_vertices(i, j) << " ";
+            }
+            key << mesh.getTriangleThickness(i) << " " <<
+                mesh.getTriangleElasticModulus(i) << " " <<
+                mesh.getTrianglePoissonsRatio(i) << "\n";
+        }
+    }
+
+    //External loads and their data file
+    const std::string external_loads_file = get_external_loads_file();
+    if (external_loads_file != "" && external_loads_file != "Unassigned") {
+        std::string file = 
+            SimTK::Pathname::getAbsolutePathname(external_loads_file);
+        key << readFileContents(file) << "\n";
+
+        ExternalLoads external_loads(file, true);
+        std::string data_file = external_loads.getDataFileName();
+        if (!data_file.empty() && data_file != "Unassigned") {
+            std::string saveWorkingDirectory = IO::getCwd();
+            IO::chDir(IO::getParentDirectory(file));
+            data_file = SimTK::Pathname::getAbsolutePathname(data_file);
+            IO::chDir(saveWorkingDirectory);
+
+            key << readFileContents(data_file) << "\n";
+        }
+    }
+
+    key << get_COMAKSecondaryCoordinateSet().dump() << "\n";
+
+    key << get_settle_threshold() << "\n" << get_settle_accuracy() << "\n"
+        << get_settle_internal_step_limit() << "\n";
+
+    for (int j = 0; j < _q_matrix.ncol(); ++j) {
+        key << _q_matrix(_start_frame, j) << " " 
+            << _u_matrix(_start_frame, j) << "\n";
+    }
+
+    OPENSIM_THROW_IF(key.fail(), Exception,
+        "Failed to compute the settle cache key.")
+
+    //64-bit FNV-1a hash
+    std::string key_str = key.str();
+    unsigned long long hash = 14695981039346656037ULL;
+
+    for (char c : key_str) {
+        hash ^= (unsigned char)c;
+        hash *= 1099511628211ULL;
+    }
+
+    std::stringstream hash_str;
+    hash_str << std::hex << std::setw(16) << std::setfill('0') << hash;
+
+    std::string cache_dir = get_settle_cache_directory();
+    if (cache_dir.empty()) {
+        cache_dir = get_results_directory();
+    }
+
+    int makeDir_out = IO::makeDir(cache_dir);
+    if (errno == ENOENT && makeDir_out == -1) {
+        OPENSIM_THROW(Exception, "Could not create " + cache_dir +
+            "Possible reason: This tool cannot make new folder with subfolder.");
+    }
+
+    return cache_dir + "/settle_cache_" + hash_str.str() + ".sto";
+}
+
+std::string COMAKTool::readFileContents(const std::string& file)
+{
+    std::ifstream in(file, std::ios::binary);
+
+    OPENSIM_THROW_IF(!in.is_open(), Exception,
+        "Failed to open " + file + ".")
+
+    std::string contents{ std::istreambuf_iterator<char>(in),
+        std::istreambuf_iterator<char>() };
+
+    OPENSIM_THROW_IF(in.bad(), Exception,
+        "Failed to read " + file + ".")
+
+    return contents;
+}
+
+bool COMAKTool::readSettleCache(
+    const std::string& file, SimTK::Vector& secondary_q)
+{
+    std::ifstream file_check(file);
+    if (!file_check.good()) {
+        return false;
+    }
+    file_check.close();
+
+    TimeSeriesTable settled_table(file);
+    if (settled_table.getNumRows() == 0) {
+        return false;
+    }
+
+    secondary_q.resize(_n_secondary_coord);
+    for (int i = 0; i < _n_secondary_coord; ++i) {
+        std::string label = _secondary_coord_path[i] + "/value";
+
+        if (!settled_table.hasColumn(label)) {
+            return false;
+        }
+        secondary_q(i) = settled_table.getDependentColumn(label)[0];
+    }
+    return true;
+}
+
 void COMAKTool::extractKinematicsFromFile() {
 
     Storage store(get_coordinates_file());
@@ -22,7 +22,9 @@
 #include <OpenSim/Simulation/Model/ExternalLoads.h>
 #include <OpenSim/Simulation/Model/ForceSet.h>
 #include <OpenSim/Simulation/Model/AnalysisSet.h>
-#include <OpenSim/Simulation/StatesTrajectory.h>
+#include "CompactStatesTrajectory.h"
+#include "H5FileAdapter.h"
+#include "OutputPipeline.h"
 
 namespace OpenSim { 
 class COMAKSecondaryCoordinate;
@@ -166,6 +168,18 @@ public:
     OpenSim_DECLARE_PROPERTY(settle_sim_results_prefix, std::string, 
         "Prefix to settle simulation results file names.")
 
+    OpenSim_DECLARE_PROPERTY(use_settle_cache, bool,
+        "Reuse the settled secondary coordinate values from a previous "
+        "settling simulation with identical model (including the force set, "
+        "contact meshes and actuator properties), external loads, "
+        "COMAKSecondaryCoordinates, settle settings and initial pose. The "
+        "settled state is cached in settle_cache_directory in a file named "
+        "by a hash of these inputs. The default value is false.")
+
+    OpenSim_DECLARE_PROPERTY(settle_cache_directory, std::string,
+        "Path to the directory where settled states are cached. If empty, "
+        "the results_directory is used.")
+
     OpenSim_DECLARE_PROPERTY(max_iterations, int, 
         "Maximum number of COMAK iterations per time step allowed for the "
         "the simulated model accelerations to converge to the input observed "
@@ -190,6 +204,53 @@ public:
         "COMAK optimization to changes in the secondary coordinate values. "
         "The default value is 1e-8.")
 
+    OpenSim_DECLARE_PROPERTY(use_unit_udot_update, bool,
+        "Update the secondary coordinate unit udots between COMAK iterations "
+        "with a Broyden rank-one update from the observed change in "
+        "accelerations instead of recomputing all unit udots with finite "
+        "differences. All unit udots are recomputed at the first iteration "
+        "of each time step and whenever the update is rejected. The update "
+        "is an approximation of the unit udots, so the results differ from "
+        "those with finite differences. The default value is false.")
+
+    OpenSim_DECLARE_PROPERTY(unit_udot_update_max_step, double,
+        "Maximum change in any COMAKSecondaryCoordinate between COMAK "
+        "iterations for which the Broyden update is used, larger steps "
+        "trigger a full recompute of the unit udots. "
+        "The default value is 0.005.")
+
+    OpenSim_DECLARE_PROPERTY(unit_udot_update_tolerance, double,
+        "Maximum relative error between the observed change in accelerations "
+        "and the change predicted by the previous unit udots for which the "
+        "Broyden update is used, larger errors trigger a full recompute of "
+        "the unit udots. The default value is 0.25.")
+
+    OpenSim_DECLARE_PROPERTY(unit_udot_fixed_contact_correspondence, bool,
+        "Hold the contacting triangles of each "
+        "Smith2018ArticularContactForce fixed while the unit udots are "
+        "computed, skipping the collision detection for each "
+        "COMAKSecondaryCoordinate perturbation. This is an approximation, "
+        "triangles that come into contact due to a perturbation are "
+        "ignored. The default value is false.")
+
+    OpenSim_DECLARE_PROPERTY(coarse_frame_step, int,
+        "Perform a coarse COMAK pass on every coarse_frame_step frame (and "
+        "the last frame) before the full-rate pass. The secondary coordinate "
+        "values and actuator activations of the coarse pass are linearly "
+        "interpolated to provide the initial guess at each frame of the "
+        "full-rate pass. Set to -1 to only perform the full-rate pass. "
+        "The default value is -1.")
+
+    OpenSim_DECLARE_PROPERTY(coarse_udot_tolerance, double,
+        "udot_tolerance used in the coarse pass. The default value is 5.0.")
+
+    OpenSim_DECLARE_PROPERTY(coarse_max_iterations, int,
+        "max_iterations used in the coarse pass. The default value is 10.")
+
+    OpenSim_DECLARE_PROPERTY(coarse_pass_only, bool,
+        "Only perform the coarse pass and report its results, useful as a "
+        "fast preview of the full simulation. The default value is false.")
+
     OpenSim_DECLARE_UNNAMED_PROPERTY(COMAKCostFunctionParameterSet,
         "List of COMAKCostFunctionWeight objects.")
 
@@ -197,6 +258,32 @@ public:
         "The weighting on Smith2018ArticularContactForce potential energy "
         "term in COMAK cost function. The default value is 0.")
 
+    OpenSim_DECLARE_PROPERTY(write_h5_results_file, bool,
+        "Stream the results of each frame to results_prefix_results.h5 in "
+        "the results_directory as soon as the frame is solved, along with a "
+        "checkpoint of the COMAK solution that is used to resume the "
+        "simulation. Each frame is appended as a row of the (frames x "
+        "columns) datasets /States, /Activation, /Force and /Kinematics. "
+        "The .sto results files are generated from the .h5 file "
+        "at the end of the simulation, so the results are not held in "
+        "memory. The default value is false.")
+
+    OpenSim_DECLARE_PROPERTY(resume, bool,
+        "Continue a previous COMAK simulation from the last completed frame "
+        "in the checkpoint of the .h5 results file. Requires "
+        "write_h5_results_file to be true. The frames solved before the "
+        "checkpoint are replayed through the AnalysisSet. If no checkpoint "
+        "is found, the simulation is started from the beginning. The "
+        "default value is false.")
+
+    OpenSim_DECLARE_PROPERTY(num_output_threads, int,
+        "Number of threads that write the results in the background. With "
+        "write_h5_results_file, the results and checkpoint of each frame "
+        "are appended to the .h5 file while the next frame is solved. The "
+        ".sto files are written in parallel. If 0, the results are written "
+        "on the main thread. If -1, the number of processors is used. "
+        "The default value is 0.")
+
     OpenSim_DECLARE_PROPERTY(verbose, int, 
         "Level of debug information reported (0: low, 1: medium, 2: high)")
 
@@ -227,13 +314,25 @@ private:
     void applyExternalLoads();
     void printCOMAKascii();
     SimTK::Vector equilibriateSecondaryCoordinates();
+    std::string computeSettleCacheFileName();
+    static std::string readFileContents(const std::string& file);
+    bool readSettleCache(const std::string& file, SimTK::Vector& secondary_q);
     void performCOMAK();
     void setStateFromComakParameters(SimTK::State& state, const SimTK::Vector& parameters);
+    SimTK::Vector interpolateCoarseParameters(int frame);
     SimTK::Vector computeMuscleVolumes();
     void printOptimizationResultsToConsole(const SimTK::Vector& parameters);
     void initializeResultsStorage();
     void recordResultsStorage(const SimTK::State& state, int frame);
     void printResultsFiles();
+    int initializeH5Results();
+    void writeH5Checkpoint(int frame);
+    void writeH5CoarseSolution();
+    void readH5CoarseSolution();
+    TimeSeriesTable readH5ResultsTable(
+        const std::vector<std::string>& labels,
+        const std::string& dataset_path);
+    void replayH5Analyses(const SimTK::State& state);
 
 public:
     void run();
@@ -301,11 +400,21 @@ public:
     FunctionSet _cost_muscle_weights;
     std::string _directoryOfSetupFile;
 
-    StatesTrajectory _result_states;
+    CompactStatesTrajectory _result_states;
     TimeSeriesTable _result_activations;
     TimeSeriesTable _result_forces;
     TimeSeriesTable _result_kinematics;
     TimeSeriesTable _result_values;
+
+    H5FileAdapter _h5_results;
+    bool _analysis_set_begun;
+
+    std::vector<int> _coarse_frames;
+    std::vector<SimTK::Vector> _coarse_parameters;
+
+    //Declared last so the writer threads are stopped before the results
+    //they write are destroyed
+    std::shared_ptr<OutputPipeline> _output_pipeline;
 //=============================================================================
 };  // END of class COMAK_TOOL
 
@@ -0,0 +1,123 @@
+/* -------------------------------------------------------------------------- *
+ *                       CompactStatesTrajectory.cpp                          *
+ * -------------------------------------------------------------------------- *
+ * Author(s): Colin Smith                                                     *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may    *
+ * not use this file except in compliance with the License. You may obtain a  *
+ * copy of the License at http://www.apache.org/licenses/LICENSE-2.0.         *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ * -------------------------------------------------------------------------- */
+
+#include "CompactStatesTrajectory.h"
+
+using namespace OpenSim;
+
+//=============================================================================
+// CONSTRUCTORS
+//=============================================================================
+
+CompactStatesTrajectory::CompactStatesTrajectory()
+{
+    _ny = 0;
+}
+
+//=============================================================================
+// METHODS
+//=============================================================================
+
+void CompactStatesTrajectory::append(const SimTK::State& state)
+{
+    if (_time.empty()) {
+        _template_state = state;
+        _ny = state.getNY();
+    }
+
+    OPENSIM_THROW_IF(state.getNY() != _ny, Exception,
+        "CompactStatesTrajectory: the appended state (time = " +
+        std::to_string(state.getTime()) + ") has " +
+        std::to_string(state.getNY()) + " continuous state variables, "
+        "expected " + std::to_string(_ny) + ".")
+
+    const SimTK::Vector& y = state.getY();
+
+    _time.push_back(state.getTime());
+    for (int i = 0; i < _ny; ++i) {
+        _y.push_back(y(i));
+    }
+}
+
+void CompactStatesTrajectory::clear()
+{
+    _time.clear();
+    _y.clear();
+    _ny = 0;
+    _template_state = SimTK::State();
+}
+
+SimTK::State CompactStatesTrajectory::getState(int index) const
+{
+    SimTK::State state = _template_state;
+    updState(index, state);
+    return state;
+}
+
+void CompactStatesTrajectory::updState(
+    int index, SimTK::State& state) const
+{
+    OPENSIM_THROW_IF(index < 0 || index >= getSize(), IndexOutOfRange,
+        (size_t)index, 0, (size_t)getSize() - 1)
+
+    state.setTime(_time[index]);
+    state.updY() = SimTK::Vector(_ny, &_y[(size_t)index * _ny]);
+}
+
+TimeSeriesTable CompactStatesTrajectory::exportToTable(const Model& model,
+    const std::vector<std::string>& stateVars) const
+{
+    OPENSIM_THROW_IF(!model.hasSystem(), ModelHasNoSystem, model.getName())
+
+    std::vector<std::string> labels = stateVars;
+    if (labels.empty()) {
+        Array<std::string> names = model.getStateVariableNames();
+        for (int i = 0; i < names.size(); ++i) {
+            labels.push_back(names[i]);
+        }
+    }
+
+    TimeSeriesTable table;
+    table.setColumnLabels(labels);
+
+    if (_time.empty()) return table;
+
+    OPENSIM_THROW_IF(model.getWorkingState().getNY() != _ny, Exception,
+        "CompactStatesTrajectory: model " + model.getName() + " has " +
+        std::to_string(model.getWorkingState().getNY()) +
+        " continuous state variables, the trajectory has " +
+        std::to_string(_ny) + ".")
+
+    //Reuse a single State to reconstruct each row
+    SimTK::State state = _template_state;
+    SimTK::RowVector row((int)labels.size());
+
+    for (int i = 0; i < getSize(); ++i) {
+        updState(i, state);
+
+        if (stateVars.empty()) {
+            row = ~model.getStateVariableValues(state);
+        }
+        else {
+            for (int j = 0; j < (int)labels.size(); ++j) {
+                row(j) = model.getStateVariableValue(state, labels[j]);
+            }
+        }
+        table.appendRow(_time[i], row);
+    }
+
+    return table;
+}
@@ -0,0 +1,91 @@
+#ifndef OPENSIM_COMPACT_STATES_TRAJECTORY_H_
+#define OPENSIM_COMPACT_STATES_TRAJECTORY_H_
+/* -------------------------------------------------------------------------- *
+ *                        CompactStatesTrajectory.h                           *
+ * -------------------------------------------------------------------------- *
+ * Author(s): Colin Smith                                                     *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may    *
+ * not use this file except in compliance with the License. You may obtain a  *
+ * copy of the License at http://www.apache.org/licenses/LICENSE-2.0.         *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ * -------------------------------------------------------------------------- */
+
+#include <OpenSim/Simulation/Model/Model.h>
+#include <OpenSim/Common/TimeSeriesTable.h>
+#include "osimPluginDLL.h"
+
+namespace OpenSim {
+
+//=============================================================================
+//                         CompactStatesTrajectory
+//=============================================================================
+/**
+A drop in replacement for StatesTrajectory when the states are only recorded
+to be exported. StatesTrajectory keeps a full SimTK::State copy for each
+appended state, including every cache entry (e.g. the per triangle
+proximity, pressure and energy vectors of each
+Smith2018ArticularContactForce), which can use gigabytes of memory for long
+simulations with fine meshes.
+
+This class only stores the time and the continuous state variables (q, u, z)
+of each appended state in a packed buffer. The first appended state is kept
+as a template that provides the discrete variables and modeling options,
+and a full State is only reconstructed on demand (getState(),
+exportToTable()).
+
+@author Colin Smith
+*/
+
+class OSIMPLUGIN_API CompactStatesTrajectory {
+
+public:
+//=============================================================================
+// METHODS
+//=============================================================================
+    CompactStatesTrajectory();
+
+    /** Record the time and continuous state variables of state. All
+    appended states must come from the same System. */
+    void append(const SimTK::State& state);
+
+    void clear();
+
+    int getSize() const { return (int)_time.size(); }
+
+    double getTime(int index) const { return _time[index]; }
+
+    /** Reconstruct the State at index. The discrete variables are those of
+    the first appended state. */
+    SimTK::State getState(int index) const;
+
+    /** Overwrite the time and continuous state variables of state (which
+    must come from the same System) with those recorded at index. This
+    avoids allocating a new State when looping over the trajectory. */
+    void updState(int index, SimTK::State& state) const;
+
+    /** Same as StatesTrajectory::exportToTable(), the columns are the state
+    variables of model. */
+    TimeSeriesTable exportToTable(const Model& model,
+        const std::vector<std::string>& stateVars = {}) const;
+
+//=============================================================================
+// DATA
+//=============================================================================
+private:
+    SimTK::State _template_state;
+    int _ny;
+    std::vector<double> _time;
+    std::vector<double> _y;
+
+//=============================================================================
+};  // END of class CompactStatesTrajectory
+
+} // end of namespace OpenSim
+
+#endif // OPENSIM_COMPACT_STATES_TRAJECTORY_H_
@@ -0,0 +1,614 @@
+/* -------------------------------------------------------------------------- *
+ *                         ContactStatisticsTool.cpp                          *
+ * -------------------------------------------------------------------------- *
+ * Author(s): Colin Smith                                                     *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may    *
+ * not use this file except in compliance with the License. You may obtain a  *
+ * copy of the License at http://www.apache.org/licenses/LICENSE-2.0.         *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,         *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ * -------------------------------------------------------------------------- */
+
+#include "ContactStatisticsTool.h"
+#include "Smith2018ArticularContactForce.h"
+#include <OpenSim/Common/IO.h>
+#include <OpenSim/Common/STOFileAdapter.h>
+#include <SimTKcommon/internal/ParallelExecutor.h>
+#include <algorithm>
+#include <cmath>
+
+using namespace OpenSim;
+
+namespace {
+    const std::string contact_group = "/Smith2018ArticularContactForce";
+
+    //Same statistics as the regional outputs of Smith2018ArticularContactForce
+    const std::vector<std::string> stat_names{ "contact_area",
+        "mean_proximity", "max_proximity", "mean_pressure", "max_pressure" };
+
+    const std::vector<std::string> stat_names_vec3{ "center_of_proximity",
+        "center_of_pressure", "contact_force", "contact_moment" };
+}
+
+//=============================================================================
+// ContactStatisticsRegion
+//=============================================================================
+
+ContactStatisticsRegion::ContactStatisticsRegion()
+{
+    constructProperties();
+}
+
+void ContactStatisticsRegion::constructProperties()
+{
+    constructProperty_contact_force("all");
+    constructProperty_mesh("all");
+    constructProperty_min_center(SimTK::Vec3(-SimTK::Infinity));
+    constructProperty_max_center(SimTK::Vec3(SimTK::Infinity));
+    constructProperty_triangles();
+}
+
+std::vector<int> ContactStatisticsRegion::findTriangles(
+    const SimTK::Vector_<SimTK::Vec3>& triangle_centers) const
+{
+    std::vector<int> triangles;
+    int n_tri = triangle_centers.size();
+
+    if (getProperty_triangles().size() > 0) {
+        for (int i = 0; i < getProperty_triangles().size(); ++i) {
+            int tri = get_triangles(i);
+
+            OPENSIM_THROW_IF(tri < 0 || tri >= n_tri, Exception,
+                "ContactStatisticsRegion " + getName() + ": triangle " +
+                std::to_string(tri) + " is out of range, the mesh has " +
+                std::to_string(n_tri) + " triangles.")
+
+            triangles.push_back(tri);
+        }
+        return triangles;
+    }
+
+    const SimTK::Vec3& min_center = get_min_center();
+    const SimTK::Vec3& max_center = get_max_center();
+
+    for (int i = 0; i < n_tri; ++i) {
+        bool inside = true;
+        for (int j = 0; j < 3; ++j) {
+            if (triangle_centers(i)(j) < min_center(j) ||
+                triangle_centers(i)(j) > max_center(j)) {
+                inside = false;
+            }
+        }
+        if (inside) triangles.push_back(i);
+    }
+    return triangles;
+}
+
+ContactStatisticsRegionSet::ContactStatisticsRegionSet()
+{
+    constructProperties();
+}
+
+void ContactStatisticsRegionSet::constructProperties()
+{
+
+}
+
+//=============================================================================
+// ContactStatisticsTool
+//=============================================================================
+
+ContactStatisticsTool::ContactStatisticsTool() : Object()
+{
+    setNull();
+    constructProperties();
+    _directoryOfSetupFile = "";
+}
+
+ContactStatisticsTool::ContactStatisticsTool(std::string settings_file) :
+    Object(settings_file)
+{
+    constructProperties();
+    updateFromXMLDocument();
+
+    _directoryOfSetupFile = IO::getParentDirectory(settings_file);
+    IO::chDir(_directoryOfSetupFile);
+}
+
+void ContactStatisticsTool::setNull()
+{
+    setAuthors("Colin Smith");
+}
+
+void ContactStatisticsTool::constructProperties()
+{
+    Array<std::string> defaultListAll;
+    defaultListAll.append("all");
+
+    Array<std::string> defaultMeshes;
+    defaultMeshes.append("casting");
+    defaultMeshes.append("target");
+
+    constructProperty_h5_file("");
+    constructProperty_results_directory(".");
+    constructProperty_results_file_basename("");
+    constructProperty_contacts(defaultListAll);
+    constructProperty_meshes(defaultMeshes);
+    constructProperty_report_total(true);
+    constructProperty_report_default_regions(false);
+    constructProperty_ContactStatisticsRegionSet(ContactStatisticsRegionSet());
+    constructProperty_frame_block_size(256);
+    constructProperty_num_threads(-1);
+    constructProperty_write_sto_file(true);
+    constructProperty_write_h5_file(false);
+}
+
+void ContactStatisticsTool::run()
+{
+    int makeDir_out = IO::makeDir(get_results_directory());
+    if (errno == ENOENT && makeDir_out == -1) {
+        OPENSIM_THROW(Exception, "Could not create " +
+            get_results_directory() +
+            "Possible reason: This tool cannot make new folder with subfolder.");
+    }
+
+    OPENSIM_THROW_IF(get_frame_block_size() < 1, Exception,
+        "frame_block_size must be at least 1.")
+
+    initialize();
+    computeStatistics();
+
+    //The views hold datasets of the file
+    _meshes.clear();
+    _h5_adapter.close();
+
+    printResults(get_results_file_basename(), get_results_directory());
+}
+
+void ContactStatisticsTool::initialize()
+{
+    _meshes.clear();
+    _labels.clear();
+    _labels_vec3.clear();
+
+    _h5_adapter.openReadOnly(get_h5_file());
+
+    OPENSIM_THROW_IF(!_h5_adapter.exists("/time") ||
+        !_h5_adapter.exists(contact_group), Exception,
+        get_h5_file() + " does not contain /time and " + contact_group + ".")
+
+    SimTK::Vector time = _h5_adapter.readDataSetSimTKVector("/time");
+    _time.clear();
+    for (int i = 0; i < time.size(); ++i) {
+        _time.push_back(time(i));
+    }
+
+    std::vector<std::string> contact_names;
+    if (get_contacts(0) == "all") {
+        contact_names = _h5_adapter.getChildNames(contact_group);
+    }
+    else {
+        for (int i = 0; i < getProperty_contacts().size(); ++i) {
+            contact_names.push_back(get_contacts(i));
+        }
+    }
+
+    for (const std::string& contact_name : contact_names) {
+        std::string group = contact_group + "/" + contact_name;
+
+        //Packed datasets of all contact forces are also in contact_group
+        if (get_contacts(0) == "all" && (!_h5_adapter.isGroup(group) ||
+            !_h5_adapter.exists(group + "/geometry"))) {
+            continue;
+        }
+
+        OPENSIM_THROW_IF(!_h5_adapter.exists(group + "/geometry"), Exception,
+            group + "/geometry was not found in " + get_h5_file() + ". The "
+            "mesh geometry is written by the JointMechanicsTool and "
+            "H5ContactReporter.")
+
+        for (int i = 0; i < getProperty_meshes().size(); ++i) {
+            const std::string& mesh = get_meshes(i);
+
+            OPENSIM_THROW_IF(mesh != "casting" && mesh != "target", Exception,
+                "meshes must be 'casting' or 'target', not '" + mesh + "'.")
+
+            if (!_h5_adapter.exists(group + "/" + mesh + "_triangle_pressure")) {
+                std::cout << "WARNING: " << group << "/" << mesh <<
+                    "_triangle_pressure was not found, skipping the " <<
+                    mesh << " mesh of " << contact_name << "." << std::endl;
+                continue;
+            }
+            addMesh(contact_name, mesh);
+        }
+    }
+
+    OPENSIM_THROW_IF(_meshes.empty(), Exception,
+        "No contact meshes with per triangle pressure and mesh geometry were "
+        "found in " + get_h5_file() + ".")
+
+    _stats.resize((int)_time.size(), (int)_labels.size());
+    _stats_vec3.resize((int)_time.size(), (int)_labels_vec3.size());
+}
+
+void ContactStatisticsTool::addMesh(
+    const std::string& contact_name, const std::string& mesh)
+{
+    std::string group = contact_group + "/" + contact_name;
+    std::string geometry = group + "/geometry/" + mesh + "_mesh/";
+
+    MeshData data;
+    data.contact_name = contact_name;
+    data.mesh = mesh;
+
+    data.triangle_area =
+        _h5_adapter.readDataSetSimTKVector(geometry + "triangle_area");
+    int n_tri = data.triangle_area.size();
+
+    SimTK::Matrix centers = _h5_adapter.openDataSetView(
+        geometry + "triangle_center").readRows(0, n_tri);
+    SimTK::Matrix normals = _h5_adapter.openDataSetView(
+        geometry + "triangle_normal").readRows(0, n_tri);
+
+    data.triangle_center.resize(n_tri);
+    data.triangle_normal.resize(n_tri);
+    for (int i = 0; i < n_tri; ++i) {
+        data.triangle_center(i) = SimTK::Vec3(
+            centers(i, 0), centers(i, 1), centers(i, 2));
+        data.triangle_normal(i) = SimTK::Vec3(
+            normals(i, 0), normals(i, 1), normals(i, 2));
+    }
+
+    //Per triangle outputs
+    data.pressure = _h5_adapter.openDataSetView(
+        group + "/" + mesh + "_triangle_pressure");
+
+    OPENSIM_THROW_IF(data.pressure.getNumColumns() != n_tri ||
+        data.pressure.getNumRows() != (int)_time.size(), Exception,
+        data.pressure.getPath() + " is not a (frames x triangles) dataset "
+        "of the " + std::to_string(n_tri) + " triangles of the mesh.")
+
+    std::string proximity_path = group + "/" + mesh + "_triangle_proximity";
+    data.has_proximity = _h5_adapter.exists(proximity_path);
+
+    if (data.has_proximity) {
+        data.proximity = _h5_adapter.openDataSetView(proximity_path);
+    }
+    else {
+        std::cout << "WARNING: " << proximity_path << " was not found, "
+            "the proximity statistics of " << contact_name << " are 0."
+            << std::endl;
+    }
+
+    //Regions
+    if (get_report_total()) {
+        std::vector<int> all(n_tri);
+        for (int i = 0; i < n_tri; ++i) all[i] = i;
+
+        data.region_names.push_back("total");
+        data.region_triangles.push_back(all);
+    }
+
+    if (get_report_default_regions()) {
+        //Same regions as Smith2018ContactMesh::initializeMesh()
+        std::vector<std::vector<int>> regions(6);
+        for (int i = 0; i < n_tri; ++i) {
+            for (int j = 0; j < 3; ++j) {
+                if (data.triangle_center(i)(j) < 0.0) {
+                    regions[j * 2].push_back(i);
+                }
+                else {
+                    regions[j * 2 + 1].push_back(i);
+                }
+            }
+        }
+        for (int r = 0; r < 6; ++r) {
+            data.region_names.push_back("region_" + std::to_string(r));
+            data.region_triangles.push_back(regions[r]);
+        }
+    }
+
+    const ContactStatisticsRegionSet& region_set =
+        get_ContactStatisticsRegionSet();
+
+    for (int r = 0; r < region_set.getSize(); ++r) {
+        const ContactStatisticsRegion& region = region_set.get(r);
+
+        if (region.get_contact_force() != "all" &&
+            region.get_contact_force() != contact_name) continue;
+
+        if (region.get_mesh() != "all" && region.get_mesh() != mesh) continue;
+
+        data.region_names.push_back(region.getName());
+        data.region_triangles.push_back(
+            region.findTriangles(data.triangle_center));
+    }
+
+    //Columns
+    data.column = (int)_labels.size();
+    data.column_vec3 = (int)_labels_vec3.size();
+
+    for (const std::string& region_name : data.region_names) {
+        std::string prefix = contact_name + "." + mesh + "." + region_name + ".";
+
+        for (const std::string& name : stat_names) {
+            _labels.push_back(prefix + name);
+        }
+        for (const std::string& name : stat_names_vec3) {
+            _labels_vec3.push_back(prefix + name);
+        }
+    }
+
+    _meshes.push_back(data);
+}
+
+namespace OpenSim {
+
+/**
+Computes the statistics of the frames of a block, each frame is independent
+so they can be computed in any order.
+*/
+class ContactStatisticsFrameTask : public SimTK::ParallelExecutor::Task {
+public:
+    ContactStatisticsFrameTask(ContactStatisticsTool& tool, int block_start,
+        std::vector<std::string>& errors) :
+        _tool(tool), _block_start(block_start), _errors(errors) {}
+
+    void execute(int index) override {
+        try {
+            _tool.computeFrame(_block_start + index, index);
+        }
+        catch (const std::exception& x) {
+            _errors[index] = x.what();
+        }
+    }
+
+private:
+    ContactStatisticsTool& _tool;
+    int _block_start;
+    std::vector<std::string>& _errors;
+};
+
+} // namespace OpenSim
+
+void ContactStatisticsTool::computeStatistics()
+{
+    int n_frames = (int)_time.size();
+    int block_size = get_frame_block_size();
+
+    int n_threads = get_num_threads();
+    if (n_threads < 1) {
+        n_threads = SimTK::ParallelExecutor::getNumProcessors();
+    }
+    n_threads = std::max(1, std::min(n_threads, block_size));
+
+    SimTK::ParallelExecutor executor(n_threads);
+
+    std::cout << "Computing contact statistics of " << n_frames <<
+        " frames using " << n_threads << " threads." << std::endl;
+
+    for (int start = 0; start < n_frames; start += block_size) {
+        int count = std::min(block_size, n_frames - start);
+
+        std::cout << "Time: " << _time[start] << " to " <<
+            _time[start + count - 1] << std::endl;
+
+        //The HDF5 library is not thread safe, the block is read first
+        for (MeshData& mesh : _meshes) {
+            mesh.pressure_block = mesh.pressure.readRows(start, count);
+
+            if (mesh.has_proximity) {
+                mesh.proximity_block = mesh.proximity.readRows(start, count);
+            }
+            else {
+                mesh.proximity_block.resize(count,
+                    mesh.pressure.getNumColumns());
+                mesh.proximity_block.setToZero();
+            }
+        }
+
+        std::vector<std::string> errors(count);
+        ContactStatisticsFrameTask task(*this, start, errors);
+
+        if (n_threads > 1) {
+            executor.execute(task, count);
+        }
+        else {
+            for (int i = 0; i < count; ++i) task.execute(i);
+        }
+
+        for (int i = 0; i < count; ++i) {
+            OPENSIM_THROW_IF(!errors[i].empty(), Exception,
+                "Computing the contact statistics at time " +
+                std::to_string(_time[start + i]) + " failed: " + errors[i])
+        }
+    }
+}
+
+void ContactStatisticsTool::computeFrame(int frame_num, int block_row)
+{
+    int n_stats = (int)stat_names.size();
+    int n_stats_vec3 = (int)stat_names_vec3.size();
+
+    for (const MeshData& mesh : _meshes) {
+        for (int r = 0; r < (int)mesh.region_names.size(); ++r) {
+            computeRegionStatistics(mesh, mesh.region_triangles[r],
+                block_row, frame_num, mesh.column + r * n_stats,
+                mesh.column_vec3 + r * n_stats_vec3);
+        }
+    }
+}
+
+void ContactStatisticsTool::computeRegionStatistics(const MeshData& mesh,
+    const std::vector<int>& triangles, int block_row, int frame_num,
+    int column, int column_vec3)
+{
+    int n_contacting = 0;
+    double contact_area = 0.0;
+    double sum_proximity = 0.0;
+    double sum_pressure = 0.0;
+    double max_proximity = 0.0;
+    double max_pressure = 0.0;
+    double den_proximity = 0.0;
+    double den_pressure = 0.0;
+
+    SimTK::Vec3 num_proximity(0.0);
+    SimTK::Vec3 num_pressure(0.0);
+    SimTK::Vec3 contact_force(0.0);
+    SimTK::Vec3 contact_moment(0.0);
+
+    for (int tri : triangles) {
+        double pressure = mesh.pressure_block(block_row, tri);
+        double proximity = mesh.proximity_block(block_row, tri);
+        double area = mesh.triangle_area(tri);
+        const SimTK::Vec3& center = mesh.triangle_center(tri);
+
+        if (pressure > 0.0) {
+            n_contacting++;
+            contact_area += area;
+        }
+
+        sum_proximity += proximity;
+        sum_pressure += pressure;
+        max_proximity = std::max(max_proximity, std::abs(proximity));
+        max_pressure = std::max(max_pressure, std::abs(pressure));
+
+        den_proximity += proximity * area;
+        num_proximity += proximity * area * center;
+        den_pressure += pressure * area;
+        num_pressure += pressure * area * center;
+
+        //Same as Smith2018ArticularContactForce::computeContactForceVector()
+        SimTK::Vec3 force = -mesh.triangle_normal(tri) * pressure * area;
+        contact_force += force;
+        contact_moment += SimTK::cross(force, center);
+    }
+
+    //Regions that are not in contact are reported as 0 instead of NaN
+    double mean_proximity = 0.0;
+    double mean_pressure = 0.0;
+    if (n_contacting > 0) {
+        mean_proximity = sum_proximity / n_contacting;
+        mean_pressure = sum_pressure / n_contacting;
+    }
+
+    SimTK::Vec3 center_of_proximity(0.0);
+    SimTK::Vec3 center_of_pressure(0.0);
+    if (den_proximity != 0.0) {
+        center_of_proximity = num_proximity / den_proximity;
+    }
+    if (den_pressure != 0.0) {
+        center_of_pressure = num_pressure / den_pressure;
+    }
+
+    _stats(frame_num, column) = contact_area;
+    _stats(frame_num, column + 1) = mean_proximity;
+    _stats(frame_num, column + 2) = max_proximity;
+    _stats(frame_num, column + 3) = mean_pressure;
+    _stats(frame_num, column + 4) = max_pressure;
+
+    _stats_vec3(frame_num, column_vec3) = center_of_proximity;
+    _stats_vec3(frame_num, column_vec3 + 1) = center_of_pressure;
+    _stats_vec3(frame_num, column_vec3 + 2) = contact_force;
+    _stats_vec3(frame_num, column_vec3 + 3) = contact_moment;
+}
+
+void ContactStatisticsTool::printResults(
+    const std::string& aBaseName, const std::string& aDir)
+{
+    std::string basefile = aDir + "/" + aBaseName + "_contact_statistics";
+    int n_frames = (int)_time.size();
+
+    if (get_write_sto_file()) {
+        int n_cols = (int)_labels.size();
+        int n_cols_vec3 = (int)_labels_vec3.size();
+
+        SimTK::Matrix data(n_frames, n_cols + 3 * n_cols_vec3);
+        std::vector<std::string> labels = _labels;
+
+        for (int i = 0; i < n_frames; ++i) {
+            for (int j = 0; j < n_cols; ++j) {
+                data(i, j) = _stats(i, j);
+            }
+            for (int j = 0; j < n_cols_vec3; ++j) {
+                for (int k = 0; k < 3; ++k) {
+                    data(i, n_cols + 3 * j + k) = _stats_vec3(i, j)(k);
+                }
+            }
+        }
+        for (const std::string& label : _labels_vec3) {
+            labels.push_back(label + "_x");
+            labels.push_back(label + "_y");
+            labels.push_back(label + "_z");
+        }
+
+        TimeSeriesTable table(_time, data, labels);
+        table.addTableMetaData("header", std::string("Contact Statistics"));
+        table.addTableMetaData("nRows", std::to_string(table.getNumRows()));
+        table.addTableMetaData("nColumns",
+            std::to_string(table.getNumColumns() + 1));
+
+        STOFileAdapter sto;
+        sto.write(table, basefile + ".sto");
+    }
+
+    if (get_write_h5_file()) {
+        H5FileAdapter h5_adapter;
+        h5_adapter.open(basefile + ".h5");
+
+        Array<double> time;
+        for (double t : _time) time.append(t);
+        h5_adapter.writeTimeDataSet(time);
+
+        //<contact>.<mesh>.<region>.<stat> -> /<contact>/<mesh>/<region>/<stat>
+        for (int j = 0; j < (int)_labels.size(); ++j) {
+            std::string path = "/" + _labels[j];
+            std::replace(path.begin(), path.end(), '.', '/');
+
+            h5_adapter.createParentGroups(path);
+            h5_adapter.writeDataSetSimTKVector(_stats(j), path);
+        }
+        for (int j = 0; j < (int)_labels_vec3.size(); ++j) {
+            std::string path = "/" + _labels_vec3[j];
+            std::replace(path.begin(), path.end(), '.', '/');
+
+            h5_adapter.createParentGroups(path);
+            h5_adapter.writeDataSetSimTKVectorVec3(_stats_vec3(j), path);
+        }
+        h5_adapter.close();
+    }
+}
+
+void ContactStatisticsTool::writeH5MeshGeometry(H5FileAdapter& h5_adapter,
+    const std::string& group_path, const Smith2018ArticularContactForce& frc)
+{
+    for (std::string mesh_name : { "casting_mesh", "target_mesh" }) {
+        const Smith2018ContactMesh& mesh =
+            frc.getConnectee<Smith2018ContactMesh>(mesh_name);
+
+        std::string path = group_path + "/geometry/" + mesh_name;
+        h5_adapter.createParentGroups(path);
+        h5_adapter.createGroup(path);
+        h5_adapter.writeStringAttribute(path, "mesh", mesh.getName());
+
+        //Expressed in the mesh frame
+        const SimTK::Vector_<SimTK::UnitVec3>& unit_normals =
+            mesh.getTriangleNormals();
+        SimTK::Vector_<SimTK::Vec3> normals(unit_normals.size());
+        for (int i = 0; i < unit_normals.size(); ++i) {
+            normals(i) = unit_normals(i).asVec3();
+        }
+
+        h5_adapter.writeDataSetSimTKVector(
+            mesh.getTriangleAreas(), path + "/triangle_area");
+        h5_adapter.writeDataSetSimTKVectorVec3(
+            mesh.getTriangleCenters(), path + "/triangle_center");
+        h5_adapter.writeDataSetSimTKVectorVec3(
+            normals, path + "/triangle_normal");
+    }
+}
@@ -0,0 +1,240 @@
+#ifndef OPENSIM_CONTACT_STATISTICS_TOOL_H_
+#define OPENSIM_CONTACT_STATISTICS_TOOL_H_
+/* -------------------------------------------------------------------------- *
+ *                          ContactStatisticsTool.h                           *
+ * -------------------------------------------------------------------------- *
+ * Author(s): Colin Smith                                                     *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may    *
+ * not use this file except in compliance with the License. You may obtain a  *
+ * copy of the License at http://www.apache.org/licenses/LICENSE-2.0.         *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,         *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ * -------------------------------------------------------------------------- */
+
+#include <OpenSim/Common/Object.h>
+#include <OpenSim/Common/Set.h>
+#include "H5FileAdapter.h"
+#include "osimPluginDLL.h"
+
+namespace OpenSim {
+
+class Smith2018ArticularContactForce;
+
+//=============================================================================
+//                          ContactStatisticsRegion
+//=============================================================================
+/**
+A region of the triangles of a contact mesh that the ContactStatisticsTool
+reports statistics for. The region is the triangles listed in triangles, or
+if triangles is empty, the triangles whose center (in the mesh frame) is
+inside the box between min_center and max_center.
+*/
+class OSIMPLUGIN_API ContactStatisticsRegion : public Object {
+    OpenSim_DECLARE_CONCRETE_OBJECT(ContactStatisticsRegion, Object)
+
+public:
+    OpenSim_DECLARE_PROPERTY(contact_force, std::string,
+        "Name of the Smith2018ArticularContactForce the region belongs to, "
+        "or 'all'. The default value is 'all'.")
+
+    OpenSim_DECLARE_PROPERTY(mesh, std::string,
+        "Contact mesh the region belongs to: 'casting', 'target' or 'all'. "
+        "The default value is 'all'.")
+
+    OpenSim_DECLARE_PROPERTY(min_center, SimTK::Vec3,
+        "Lower corner of the box that contains the triangle centers of the "
+        "region, expressed in the mesh frame. The default value is "
+        "-Inf -Inf -Inf.")
+
+    OpenSim_DECLARE_PROPERTY(max_center, SimTK::Vec3,
+        "Upper corner of the box that contains the triangle centers of the "
+        "region, expressed in the mesh frame. The default value is "
+        "Inf Inf Inf.")
+
+    OpenSim_DECLARE_LIST_PROPERTY(triangles, int,
+        "Indices of triangles in the region. If not empty, the box "
+        "(min_center and max_center) is ignored.")
+
+    ContactStatisticsRegion();
+    void constructProperties();
+
+    /** Indices of the triangles of a mesh in the region. */
+    std::vector<int> findTriangles(
+        const SimTK::Vector_<SimTK::Vec3>& triangle_centers) const;
+}; //END of class ContactStatisticsRegion
+
+class OSIMPLUGIN_API ContactStatisticsRegionSet :
+    public Set<ContactStatisticsRegion> {
+    OpenSim_DECLARE_CONCRETE_OBJECT(ContactStatisticsRegionSet,
+        Set<ContactStatisticsRegion>)
+
+public:
+    ContactStatisticsRegionSet();
+    void constructProperties();
+}; //END of class ContactStatisticsRegionSet
+
+//=============================================================================
+//                          ContactStatisticsTool
+//=============================================================================
+/**
+The ContactStatisticsTool computes contact statistics (contact area, mean
+and max proximity and pressure, center of proximity, center of pressure,
+contact force and moment) from the per triangle pressure and proximity in
+an .h5 file written by the JointMechanicsTool or H5ContactReporter. The
+model is not loaded or realized, so the total, the six regions of
+Smith2018ContactMesh and any number of user defined regions
+(ContactStatisticsRegions) can be recomputed after a simulation without
+running the JointMechanicsTool again. The statistics are the same as the
+outputs of Smith2018ArticularContactForce and are expressed in the mesh
+frame.
+
+The .h5 file must contain the mesh geometry of each contact force, which is
+written by writeH5MeshGeometry():
+
+/Smith2018ArticularContactForce/<name>/geometry/casting_mesh/triangle_area
+/Smith2018ArticularContactForce/<name>/geometry/casting_mesh/triangle_center
+/Smith2018ArticularContactForce/<name>/geometry/casting_mesh/triangle_normal
+/Smith2018ArticularContactForce/<name>/geometry/target_mesh/...
+
+The per triangle outputs (e.g. casting_triangle_pressure) can be dense or
+sparse. The frames are read in blocks of frame_block_size frames and the
+statistics of the frames of each block are computed in parallel.
+
+Results are written to <results_file_basename>_contact_statistics.sto
+and/or .h5, with a column (or dataset) for each contact force, mesh, region
+and statistic (e.g. <name>.casting.total.contact_area).
+
+@author Colin Smith
+*/
+class OSIMPLUGIN_API ContactStatisticsTool : public Object {
+    OpenSim_DECLARE_CONCRETE_OBJECT(ContactStatisticsTool, Object)
+
+    friend class ContactStatisticsFrameTask;
+
+//=============================================================================
+// PROPERTIES
+//=============================================================================
+public:
+    OpenSim_DECLARE_PROPERTY(h5_file, std::string,
+        "Path to the .h5 file with the per triangle contact outputs and "
+        "the mesh geometry.")
+
+    OpenSim_DECLARE_PROPERTY(results_directory, std::string,
+        "Path to folder where the results files will be written.")
+
+    OpenSim_DECLARE_PROPERTY(results_file_basename, std::string,
+        "Prefix to each results file name.")
+
+    OpenSim_DECLARE_LIST_PROPERTY(contacts, std::string,
+        "Names of the Smith2018ArticularContactForces in the .h5 file to "
+        "analyze. Options: 'all' or a list of names. "
+        "The default value is 'all'.")
+
+    OpenSim_DECLARE_LIST_PROPERTY(meshes, std::string,
+        "Contact meshes to analyze: 'casting' and/or 'target'. Meshes "
+        "without per triangle pressure in the .h5 file are skipped. "
+        "The default value is 'casting target'.")
+
+    OpenSim_DECLARE_PROPERTY(report_total, bool,
+        "Report the statistics of all triangles of each mesh. "
+        "The default value is true.")
+
+    OpenSim_DECLARE_PROPERTY(report_default_regions, bool,
+        "Report the six regions of Smith2018ContactMesh (region_0 to "
+        "region_5: the triangles with a negative and positive x, y and z "
+        "center). The default value is false.")
+
+    OpenSim_DECLARE_UNNAMED_PROPERTY(ContactStatisticsRegionSet,
+        "User defined regions to report.")
+
+    OpenSim_DECLARE_PROPERTY(frame_block_size, int,
+        "Number of frames that are read from the .h5 file at a time. "
+        "The default value is 256.")
+
+    OpenSim_DECLARE_PROPERTY(num_threads, int,
+        "Number of threads used to compute the statistics of the frames. "
+        "If -1, the number of processors is used. The default value is -1.")
+
+    OpenSim_DECLARE_PROPERTY(write_sto_file, bool,
+        "Write the statistics to a .sto file. The default value is true.")
+
+    OpenSim_DECLARE_PROPERTY(write_h5_file, bool,
+        "Write the statistics to an .h5 file. The default value is false.")
+
+//=============================================================================
+// METHODS
+//=============================================================================
+public:
+    ContactStatisticsTool();
+    ContactStatisticsTool(std::string settings_file);
+
+    void run();
+
+    /** Write the triangle areas, centers and normals of the casting and
+    target meshes of frc to group_path/geometry. */
+    static void writeH5MeshGeometry(H5FileAdapter& h5_adapter,
+        const std::string& group_path,
+        const Smith2018ArticularContactForce& frc);
+
+private:
+    void setNull();
+    void constructProperties();
+
+    struct MeshData {
+        std::string contact_name;
+        std::string mesh;
+        SimTK::Vector triangle_area;
+        SimTK::Vector_<SimTK::Vec3> triangle_center;
+        SimTK::Vector_<SimTK::Vec3> triangle_normal;
+        H5DataSetView pressure;
+        H5DataSetView proximity;
+        bool has_proximity;
+        std::vector<std::string> region_names;
+        std::vector<std::vector<int>> region_triangles;
+
+        //First column of the mesh in _stats and _stats_vec3
+        int column;
+        int column_vec3;
+
+        //Rows of the frame block that was read last
+        SimTK::Matrix pressure_block;
+        SimTK::Matrix proximity_block;
+    };
+
+    void initialize();
+    void addMesh(const std::string& contact_name, const std::string& mesh);
+    /** Compute the statistics of frame_num from row block_row of the
+    frame block that was read last. */
+    void computeFrame(int frame_num, int block_row);
+    void computeRegionStatistics(const MeshData& mesh,
+        const std::vector<int>& triangles, int block_row, int frame_num,
+        int column, int column_vec3);
+    void computeStatistics();
+    void printResults(const std::string& aBaseName, const std::string& aDir);
+
+//=============================================================================
+// DATA
+//=============================================================================
+    std::string _directoryOfSetupFile;
+
+    H5FileAdapter _h5_adapter;
+    std::vector<double> _time;
+    std::vector<MeshData> _meshes;
+
+    //frames x (mesh, region, statistic)
+    SimTK::Matrix _stats;
+    SimTK::Matrix_<SimTK::Vec3> _stats_vec3;
+    std::vector<std::string> _labels;
+    std::vector<std::string> _labels_vec3;
+
+//=============================================================================
+};  // END of class ContactStatisticsTool
+
+} // end of namespace OpenSim
+
+#endif // OPENSIM_CONTACT_STATISTICS_TOOL_H_
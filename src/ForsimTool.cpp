@@ -28,6 +28,11 @@
 #include <OpenSim/Common/IO.h>
 #include "Smith2018ArticularContactForce.h"
 #include "Blankevoort1991Ligament.h"
+#include "PrescribedActuatorForce.h"
+#include "CompactStatesTrajectory.h"
+#include "H5ContactReporter.h"
+#include <sstream>
+#include <iomanip>
 using namespace OpenSim;
 
 ForsimTool::ForsimTool() : Object()
@@ -74,6 +79,22 @@ void ForsimTool::constructProperties()
     constructProperty_prescribed_coordinates_file("");
     constructProperty_use_visualizer(false);
     constructProperty_verbose(0);
+    constructProperty_quasi_static(false);
+    constructProperty_quasi_static_tolerance(1e-3);
+    constructProperty_quasi_static_max_iterations(25);
+    constructProperty_quasi_static_max_step(0.01);
+    constructProperty_quasi_static_perturbation(1e-6);
+    constructProperty_settle_stop_threshold(-1);
+    constructProperty_settle_stop_coordinates();
+    constructProperty_contact_force_stop_threshold(-1);
+    constructProperty_stop_at_coordinate_range_limits(false);
+    constructProperty_checkpoint_times();
+    constructProperty_initial_state_file("");
+    constructProperty_branch_setup_files();
+    constructProperty_branch_num_threads(-1);
+    constructProperty_ensemble_file("");
+    constructProperty_ensemble_num_threads(-1);
+    constructProperty_num_output_threads(0);
     constructProperty_AnalysisSet(AnalysisSet());
 }
 
@@ -83,7 +104,51 @@ void ForsimTool::setModel(Model& aModel)
     set_model_file(_model.getDocumentFileName());
 }
 
+namespace OpenSim {
+
+/**
+Runs the forward simulation of one ensemble variant or branch on its own
+initialized tool.
+*/
+class ForsimSimulationTask : public SimTK::ParallelExecutor::Task {
+public:
+    ForsimSimulationTask(std::vector<ForsimTool>& variants,
+        std::vector<std::string>& errors) :
+        _variants(variants), _errors(errors) {}
+
+    void execute(int index) override {
+        try {
+            _variants[index].simulate();
+        }
+        catch (const std::exception& x) {
+            _errors[index] = x.what();
+        }
+    }
+
+private:
+    std::vector<ForsimTool>& _variants;
+    std::vector<std::string>& _errors;
+};
+
+} // namespace OpenSim
+
 void ForsimTool::run()
+{
+    initialize();
+
+    if (get_ensemble_file() != "") {
+        runEnsemble();
+    }
+    else {
+        simulate();
+    }
+
+    if (getProperty_branch_setup_files().size() > 0) {
+        runBranches();
+    }
+}
+
+void ForsimTool::initialize()
 {
     //Make results directory
     int makeDir_out = IO::makeDir(get_results_directory());
@@ -95,15 +160,6 @@ void ForsimTool::run()
 
     SimTK::State state = _model.initSystem();
 
-    //Add Analysis set
-    AnalysisSet aSet = get_AnalysisSet();
-    int size = aSet.getSize();
-
-    for (int i = 0; i < size; i++) {
-        Analysis *analysis = aSet.get(i).clone();
-        _model.addAnalysis(analysis);
-    }
-
     initializeActuators(state);
 
     initializeCoordinates();
@@ -114,7 +170,362 @@ void ForsimTool::run()
         _model.setUseVisualizer(true);
     }
 
-    state = _model.initSystem();
+    initializeStartStopTimes();
+
+    //Start from a checkpoint
+    if (get_initial_state_file() != "") {
+        _initial_state_table = TimeSeriesTable(get_initial_state_file());
+
+        OPENSIM_THROW_IF(_initial_state_table.getNumRows() != 1, Exception,
+            "initial_state_file: " + get_initial_state_file() + 
+            " must contain a single state.")
+
+        set_start_time(_initial_state_table.getIndependentColumn()[0]);
+
+        std::cout << "Starting from checkpoint: " << 
+            get_initial_state_file() << " at time: " << 
+            get_start_time() << std::endl;
+    }
+}
+
+void ForsimTool::runBranches()
+{
+    int n_branches = getProperty_branch_setup_files().size();
+
+    std::vector<ForsimTool> branches;
+    branches.reserve(n_branches);
+
+    std::string saveWorkingDirectory = IO::getCwd();
+
+    //Branch setup files are loaded and initialized serially as loading 
+    //changes the working directory
+    for (int b = 0; b < n_branches; ++b) {
+        IO::chDir(saveWorkingDirectory);
+        try {
+            branches.emplace_back(get_branch_setup_files(b));
+            ForsimTool& branch = branches.back();
+
+            //Only the simulation of a branch is run
+            OPENSIM_THROW_IF(branch.get_ensemble_file() != "" ||
+                branch.getProperty_branch_setup_files().size() > 0, Exception,
+                "Branch: " + get_branch_setup_files(b) + " sets ensemble_file "
+                "or branch_setup_files, branches can not be nested or run as "
+                "an ensemble.")
+
+            if (branch.get_initial_state_file() == "") {
+                OPENSIM_THROW_IF(get_ensemble_file() != "", Exception,
+                    "Branch: " + get_branch_setup_files(b) + " has no "
+                    "initial_state_file. Each ensemble variant writes its own "
+                    "checkpoints (" + get_results_file_basename() + 
+                    "_variant#_checkpoint_#.sto), set the initial_state_file "
+                    "of the branch to one of them.")
+
+                OPENSIM_THROW_IF(_last_checkpoint_file == "", Exception,
+                    "Branch: " + get_branch_setup_files(b) + " has no "
+                    "initial_state_file and no checkpoint_times were written.")
+
+                branch.set_initial_state_file(_last_checkpoint_file);
+            }
+            branch.set_use_visualizer(false);
+            branch.set_results_directory(
+                makeAbsolutePath(branch.get_results_directory()));
+            branch.appendBasenameToH5Files();
+
+            branch.initialize();
+        }
+        catch (...) {
+            IO::chDir(saveWorkingDirectory);
+            throw;
+        }
+    }
+    IO::chDir(saveWorkingDirectory);
+
+    int n_threads = get_branch_num_threads();
+    if (n_threads < 1) {
+        n_threads = SimTK::ParallelExecutor::getNumProcessors();
+    }
+    n_threads = std::min(n_threads, n_branches);
+
+    std::cout << std::endl;
+    std::cout << "Running " << n_branches << " branches using " <<
+        n_threads << " threads." << std::endl;
+
+    std::vector<std::string> errors(n_branches);
+
+    ForsimSimulationTask task(branches, errors);
+    SimTK::ParallelExecutor executor(n_threads);
+    executor.execute(task, n_branches);
+
+    for (int b = 0; b < n_branches; ++b) {
+        OPENSIM_THROW_IF(!errors[b].empty(), Exception,
+            "Branch " + get_branch_setup_files(b) + " failed: " + errors[b])
+    }
+}
+
+std::string ForsimTool::makeAbsolutePath(const std::string& path) const
+{
+    bool is_absolute = (!path.empty() && (path[0] == '/' || path[0] == '\\'))
+        || (path.size() > 1 && path[1] == ':');
+
+    if (is_absolute) {
+        return path;
+    }
+    return IO::getCwd() + "/" + path;
+}
+
+void ForsimTool::appendBasenameToH5Files()
+{
+    //Ensemble variants and branches run in parallel and must not write
+    //the same h5_file
+    for (int i = 0; i < upd_AnalysisSet().getSize(); ++i) {
+        H5ContactReporter* reporter =
+            dynamic_cast<H5ContactReporter*>(&upd_AnalysisSet().get(i));
+
+        if (reporter == nullptr || reporter->get_h5_file().empty()) {
+            continue;
+        }
+
+        std::string file = reporter->get_h5_file();
+        std::string::size_type ext = file.find_last_of('.');
+        std::string::size_type dir = file.find_last_of("/\\");
+
+        if (ext == std::string::npos ||
+            (dir != std::string::npos && ext < dir)) {
+            ext = file.size();
+        }
+        reporter->set_h5_file(file.substr(0, ext) + "_" +
+            get_results_file_basename() + file.substr(ext));
+    }
+}
+
+void ForsimTool::writeCheckpoint(const SimTK::State& state,
+    const SimTK::Integrator& integrator, int index)
+{
+    Array<std::string> names = _model.getStateVariableNames();
+    SimTK::Vector values = _model.getStateVariableValues(state);
+
+    std::vector<std::string> labels;
+    std::vector<double> row_values;
+    for (int i = 0; i < names.getSize(); ++i) {
+        labels.push_back(names[i]);
+        row_values.push_back(values(i));
+    }
+
+    //Override actuation is a discrete variable, NaN if not overridden
+    for (const ScalarActuator& actuator : 
+        _model.getComponentList<ScalarActuator>()) {
+        labels.push_back(actuator.getAbsolutePathString() + 
+            "/override_actuation");
+        row_values.push_back(actuator.isActuationOverridden(state) ?
+            actuator.getOverrideActuation(state) : SimTK::NaN);
+    }
+
+    SimTK::RowVector row((int)row_values.size());
+    for (int i = 0; i < (int)row_values.size(); ++i) {
+        row(i) = row_values[i];
+    }
+
+    TimeSeriesTable checkpoint_table;
+    checkpoint_table.setColumnLabels(labels);
+    checkpoint_table.appendRow(state.getTime(), row);
+
+    checkpoint_table.addTableMetaData("header", std::string("Checkpoint"));
+    checkpoint_table.addTableMetaData("nRows", std::string("1"));
+    checkpoint_table.addTableMetaData("nColumns", 
+        std::to_string(checkpoint_table.getNumColumns() + 1));
+    checkpoint_table.addTableMetaData("inDegrees", std::string("no"));
+
+    //Full precision, std::to_string rounds small step sizes to 0
+    std::stringstream accuracy;
+    accuracy << std::setprecision(17) << get_integrator_accuracy();
+    checkpoint_table.addTableMetaData("integrator_accuracy", accuracy.str());
+
+    std::stringstream step_size;
+    step_size << std::setprecision(17) << (get_quasi_static() ?
+        0.0 : integrator.getPredictedNextStepSize());
+    checkpoint_table.addTableMetaData("integrator_step_size", step_size.str());
+
+    std::string file = get_results_directory() + "/" + 
+        get_results_file_basename() + "_checkpoint_" + 
+        std::to_string(index) + ".sto";
+
+    _output_pipeline->submit([checkpoint_table, file]() {
+        STOFileAdapter sto;
+        sto.write(checkpoint_table, file);
+
+        std::cout << "Wrote checkpoint: " << file << std::endl;
+    });
+
+    _last_checkpoint_file = makeAbsolutePath(file);
+}
+
+void ForsimTool::restoreCheckpoint(SimTK::State& state,
+    SimTK::Integrator& integrator)
+{
+    Array<std::string> names = _model.getStateVariableNames();
+    SimTK::Vector values = _model.getStateVariableValues(state);
+
+    std::vector<std::string> labels = _initial_state_table.getColumnLabels();
+    const auto& row = _initial_state_table.getRowAtIndex(0);
+
+    const std::string override_suffix = "/override_actuation";
+
+    for (int j = 0; j < labels.size(); ++j) {
+        //Override actuation of a ScalarActuator
+        std::string::size_type pos = labels[j].rfind(override_suffix);
+        if (pos != std::string::npos && 
+            pos + override_suffix.size() == labels[j].size()) {
+
+            std::string path = labels[j].substr(0, pos);
+            
+            OPENSIM_THROW_IF(!_model.hasComponent<ScalarActuator>(path),
+                Exception, "initial_state_file: " + 
+                get_initial_state_file() + ", actuator " + path + 
+                " not found in model.")
+
+            const ScalarActuator& actuator = 
+                _model.getComponent<ScalarActuator>(path);
+
+            if (SimTK::isNaN(row(j))) {
+                actuator.overrideActuation(state, false);
+            }
+            else {
+                actuator.overrideActuation(state, true);
+                actuator.setOverrideActuation(state, row(j));
+            }
+            continue;
+        }
+
+        int ind = names.findIndex(labels[j]);
+
+        OPENSIM_THROW_IF(ind == -1, Exception, "initial_state_file: " +
+            get_initial_state_file() + ", state variable " + labels[j] +
+            " not found in model.")
+
+        values(ind) = row(j);
+    }
+    _model.setStateVariableValues(state, values);
+    state.setTime(_initial_state_table.getIndependentColumn()[0]);
+
+    //Restart with the step size the integrator had reached
+    if (_initial_state_table.hasTableMetaDataKey("integrator_step_size")) {
+        double step_size = std::stod(_initial_state_table.
+            getTableMetaData<std::string>("integrator_step_size"));
+
+        if (step_size > 0) {
+            integrator.setInitialStepSize(step_size);
+        }
+    }
+}
+
+void ForsimTool::runEnsemble()
+{
+    TimeSeriesTable ensemble_table(get_ensemble_file());
+
+    std::vector<std::string> labels = ensemble_table.getColumnLabels();
+    int n_variants = ensemble_table.getNumRows();
+
+    OPENSIM_THROW_IF(n_variants == 0, Exception,
+        "ensemble_file: " + get_ensemble_file() + " contains no variants.")
+
+    //Each variant is a copy of the initialized tool, the copies of each
+    //Smith2018ContactMesh share its geometry rather than duplicating it
+    std::vector<ForsimTool> variants;
+    variants.reserve(n_variants);
+
+    for (int v = 0; v < n_variants; ++v) {
+        variants.push_back(*this);
+        ForsimTool& variant = variants.back();
+
+        variant.set_ensemble_file("");
+        variant.set_use_visualizer(false);
+        variant._model.setUseVisualizer(false);
+        variant.set_results_file_basename(
+            get_results_file_basename() + "_variant" + std::to_string(v));
+        variant.appendBasenameToH5Files();
+
+        const auto& row = ensemble_table.getRowAtIndex(v);
+        for (int j = 0; j < labels.size(); ++j) {
+            applyPropertyOverride(variant._model, labels[j], row(j));
+        }
+    }
+
+    int n_threads = get_ensemble_num_threads();
+    if (n_threads < 1) {
+        n_threads = SimTK::ParallelExecutor::getNumProcessors();
+    }
+    n_threads = std::min(n_threads, n_variants);
+
+    std::cout << std::endl;
+    std::cout << "Running " << n_variants << " ensemble variants using " <<
+        n_threads << " threads." << std::endl;
+
+    std::vector<std::string> errors(n_variants);
+
+    ForsimSimulationTask task(variants, errors);
+    SimTK::ParallelExecutor executor(n_threads);
+    executor.execute(task, n_variants);
+
+    for (int v = 0; v < n_variants; ++v) {
+        OPENSIM_THROW_IF(!errors[v].empty(), Exception,
+            "Ensemble variant " + std::to_string(v) + " failed: " + errors[v])
+    }
+}
+
+void ForsimTool::applyPropertyOverride(Model& model, 
+    const std::string& label, double value)
+{
+    std::string::size_type pos = label.find_last_of("/");
+
+    OPENSIM_THROW_IF(pos == std::string::npos || pos == 0, Exception,
+        "ensemble_file column: " + label + " must be formatted as "
+        "'/path/to/component/property_name'.")
+
+    std::string component_path = label.substr(0, pos);
+    std::string property_name = label.substr(pos + 1);
+
+    Component* component;
+    try {
+        component = &model.updComponent<Component>(component_path);
+    }
+    catch (ComponentNotFoundOnSpecifiedPath) {
+        OPENSIM_THROW(Exception, "ensemble_file column: " + label +
+            ", component " + component_path + " not found in model.")
+    }
+
+    OPENSIM_THROW_IF(!component->hasProperty(property_name), Exception,
+        "ensemble_file column: " + label + ", " + component_path +
+        " has no property " + property_name + ".")
+
+    Property<double>* property = dynamic_cast<Property<double>*>(
+        &component->updPropertyByName(property_name));
+
+    OPENSIM_THROW_IF(property == nullptr, Exception,
+        "ensemble_file column: " + label + " is not a double property.")
+
+    property->setValue(value);
+}
+
+void ForsimTool::simulate()
+{
+    //Add Analysis set
+    AnalysisSet aSet = get_AnalysisSet();
+    int size = aSet.getSize();
+
+    for (int i = 0; i < size; i++) {
+        Analysis *analysis = aSet.get(i).clone();
+
+        //Each run (e.g. an ensemble variant) streams to its own file
+        H5ContactReporter* reporter =
+            dynamic_cast<H5ContactReporter*>(analysis);
+        if (reporter != nullptr) {
+            reporter->setResultsFileBasename(get_results_directory(),
+                get_results_file_basename());
+        }
+        _model.addAnalysis(analysis);
+    }
+
+    SimTK::State state = _model.initSystem();
 
     if (get_verbose() > 2) {
         for (const auto& mesh : _model.updComponentList<Smith2018ContactMesh>()) {
@@ -122,10 +533,11 @@ void ForsimTool::run()
         }
     }
 
-    initializeStartStopTimes();
-
     //Allocate Results Storage
-    StatesTrajectory result_states;
+    CompactStatesTrajectory result_states;
+
+    _output_pipeline = std::make_shared<OutputPipeline>(
+        get_num_output_threads());
     AnalysisSet& analysisSet = _model.updAnalysisSet();
 
     if (get_equilibrate_muscles()) {
@@ -153,6 +565,10 @@ void ForsimTool::run()
     if (get_internal_step_limit()>0) {
         integrator.setInternalStepLimit(get_internal_step_limit());
     }
+
+    if (get_initial_state_file() != "") {
+        restoreCheckpoint(state, integrator);
+    }
     SimTK::TimeStepper timestepper(_model.getSystem(), integrator);
     timestepper.initialize(state);
     
@@ -170,6 +586,9 @@ void ForsimTool::run()
     std::cout << "stop time: " << get_stop_time() << std::endl;
     std::cout << std::endl;
 
+    std::string stop_condition = "";
+    SimTK::Vector prev_settle_values;
+
     for (int i = 0; i <= nSteps; ++i) {
         
         double t = get_start_time() + i * dt;
@@ -177,20 +596,16 @@ void ForsimTool::run()
 
         printDebugInfo(state);
 
-        //Set Prescribed Muscle Forces
-        if(_prescribed_frc_actuator_paths.size() > 0){
-            for (int j = 0; j < _prescribed_frc_actuator_paths.size();++j) {
-                std::string actuator_path = _prescribed_frc_actuator_paths[j];
-                ScalarActuator& actuator = _model.updComponent<ScalarActuator>(actuator_path);
-                double value = _frc_functions.get(actuator_path +"_frc").calcValue(SimTK::Vector(1,t));
-                actuator.setOverrideActuation(state, value);
-            }
-            timestepper.initialize(state);
+        if (get_quasi_static()) {
+            //Continue from the previous equilibrium pose
+            state.setTime(t);
+            solveQuasiStaticEquilibrium(state);
         }
-            
-        timestepper.stepTo(t);
+        else {
+            timestepper.stepTo(t);
 
-        state = timestepper.updIntegrator().updAdvancedState();
+            state = timestepper.updIntegrator().updAdvancedState();
+        }
 
         //Record parameters
         if (i == 0) {
@@ -201,26 +616,251 @@ void ForsimTool::run()
         }
 
         result_states.append(state);
+
+        for (int c = 0; c < getProperty_checkpoint_times().size(); ++c) {
+            if (std::abs(t - get_checkpoint_times(c)) < dt / 2) {
+                writeCheckpoint(state, integrator, c);
+            }
+        }
+
+        stop_condition = checkStopConditions(state, prev_settle_values);
+        if (stop_condition != "") {
+            std::cout << "Stop condition reached at time: " << t << 
+                " (" << stop_condition << ")" << std::endl;
+            break;
+        }
     }
 
     //Print Results
-    TimeSeriesTable states_table = result_states.exportToTable(_model);
-    states_table.addTableMetaData("header", std::string("States"));
-    states_table.addTableMetaData("nRows", std::to_string(states_table.getNumRows()));
-    states_table.addTableMetaData("nColumns", std::to_string(states_table.getNumColumns()+1));
-    states_table.addTableMetaData("inDegrees", std::string("no"));
+    //The table is owned by the writer job, it must outlive this function if
+    //printing the analyses throws
+    auto states_table = std::make_shared<TimeSeriesTable>(
+        result_states.exportToTable(_model));
+    states_table->addTableMetaData("header", std::string("States"));
+    states_table->addTableMetaData("nRows", std::to_string(states_table->getNumRows()));
+    states_table->addTableMetaData("nColumns", std::to_string(states_table->getNumColumns()+1));
+    states_table->addTableMetaData("inDegrees", std::string("no"));
+    if (stop_condition != "") {
+        states_table->addTableMetaData("stop_condition", stop_condition);
+    }
 
-    STOFileAdapter sto;
     std::string basefile = get_results_directory() + "/" + get_results_file_basename();
 
-    sto.write(states_table, basefile + "_states.sto");
+    //The analyses are printed while the states are written
+    _output_pipeline->submit([states_table, basefile]() {
+        STOFileAdapter sto;
+        sto.write(*states_table, basefile + "_states.sto"); });
     
     _model.updAnalysisSet().printResults(get_results_file_basename(), get_results_directory());
 
+    _output_pipeline->finish();
+    _output_pipeline.reset();
+
     std::cout << "\nSimulation complete." << std::endl;
     std::cout << "Printed results to: " + get_results_directory() << std::endl;
 }
 
+std::string ForsimTool::checkStopConditions(const SimTK::State& state,
+    SimTK::Vector& prev_settle_values)
+{
+    std::string condition = "";
+
+    //Settled: max change in the settle coordinates between report steps
+    if (get_settle_stop_threshold() > 0) {
+        bool use_settle_coords = getProperty_settle_stop_coordinates().size() > 0;
+        int n = use_settle_coords ? 
+            getProperty_settle_stop_coordinates().size() :
+            getProperty_unconstrained_coordinates().size();
+
+        SimTK::Vector values(n);
+        for (int i = 0; i < n; ++i) {
+            std::string path = use_settle_coords ? 
+                get_settle_stop_coordinates(i) : 
+                get_unconstrained_coordinates(i);
+            values(i) = _model.getComponent<Coordinate>(path).getValue(state);
+        }
+
+        if (prev_settle_values.size() == n && n > 0) {
+            double max_delta = (values - prev_settle_values).normInf();
+
+            if (get_verbose() > 0) {
+                std::cout << "max settle coordinate delta: " << max_delta 
+                    << std::endl;
+            }
+
+            if (max_delta < get_settle_stop_threshold()) {
+                condition = "settled, max coordinate delta: " + 
+                    std::to_string(max_delta);
+            }
+        }
+        prev_settle_values = values;
+    }
+
+    //Contact force magnitude
+    if (condition == "" && get_contact_force_stop_threshold() > 0) {
+        _model.realizeReport(state);
+
+        for (const Smith2018ArticularContactForce& cnt : 
+            _model.getComponentList<Smith2018ArticularContactForce>()) {
+
+            double force = cnt.getOutputValue<SimTK::Vec3>(
+                state, "casting_total_contact_force").norm();
+
+            if (force > get_contact_force_stop_threshold()) {
+                condition = "contact force: " + cnt.getName() + 
+                    " force magnitude: " + std::to_string(force);
+                break;
+            }
+        }
+    }
+
+    //Coordinate range limits
+    if (condition == "" && get_stop_at_coordinate_range_limits()) {
+        for (int i = 0; i < getProperty_unconstrained_coordinates().size(); ++i) {
+            const Coordinate& coord = _model.getComponent<Coordinate>(
+                get_unconstrained_coordinates(i));
+            double value = coord.getValue(state);
+
+            if (value <= coord.getRangeMin() || value >= coord.getRangeMax()) {
+                condition = "coordinate range limit: " + coord.getName() +
+                    " value: " + std::to_string(value);
+                break;
+            }
+        }
+    }
+
+    return condition;
+}
+
+void ForsimTool::solveQuasiStaticEquilibrium(SimTK::State& state)
+{
+    const SimTK::MultibodySystem& system = _model.getMultibodySystem();
+
+    //Set prescribed coordinates at the current time, all speeds are zero
+    state.updU() = 0;
+    system.realize(state, SimTK::Stage::Time);
+    system.prescribe(state);
+    state.updU() = 0;
+    _model.assemble(state);
+
+    //Activation dynamics are at equilibrium when activation equals the
+    //control, the controls are functions of time only
+    _model.realizeVelocity(state);
+    for (const Muscle& msl : _model.getComponentList<Muscle>()) {
+        if (msl.isActuationOverridden(state)) continue;
+        if (msl.getStateVariableNames().findIndex("activation") == -1) {
+            continue;
+        }
+        msl.setActivation(state, msl.getControl(state));
+    }
+
+    int n = getProperty_unconstrained_coordinates().size();
+
+    std::vector<const Coordinate*> coords;
+    for (int i = 0; i < n; ++i) {
+        coords.push_back(
+            &_model.getComponent<Coordinate>(get_unconstrained_coordinates(i)));
+    }
+
+    double eps = get_quasi_static_perturbation();
+
+    SimTK::Vector udot(n);
+    SimTK::Vector perturbed_udot(n);
+    SimTK::Vector q(n);
+    SimTK::Vector dq(n);
+    SimTK::Matrix jacobian(n, n);
+
+    double udot_error = SimTK::Infinity;
+    int iter = 0;
+
+    for (iter = 0; iter < get_quasi_static_max_iterations(); ++iter) {
+        if (get_equilibrate_muscles()) {
+            _model.equilibrateMuscles(state);
+        }
+
+        //Accelerations of the unconstrained coordinates are zero at 
+        //static equilibrium
+        _model.realizeAcceleration(state);
+        for (int i = 0; i < n; ++i) {
+            q(i) = coords[i]->getValue(state);
+            udot(i) = coords[i]->getAccelerationValue(state);
+        }
+
+        udot_error = udot.normInf();
+
+        if (get_verbose() > 0) {
+            std::cout << "quasi-static iteration: " << iter << 
+                " max udot error: " << udot_error << std::endl;
+        }
+
+        if (udot_error < get_quasi_static_tolerance()) {
+            break;
+        }
+
+        //Finite difference jacobian of udot wrt q
+        for (int j = 0; j < n; ++j) {
+            coords[j]->setValue(state, q(j) + eps, false);
+            _model.assemble(state);
+            _model.realizeAcceleration(state);
+
+            for (int i = 0; i < n; ++i) {
+                perturbed_udot(i) = coords[i]->getAccelerationValue(state);
+            }
+            jacobian(j) = (perturbed_udot - udot) / eps;
+
+            coords[j]->setValue(state, q(j), false);
+        }
+
+        SimTK::Vector neg_udot = -udot;
+        SimTK::FactorLU lu(jacobian);
+        lu.solve(neg_udot, dq);
+
+        //Limit the step size, then backtrack until the error decreases
+        double step = 1.0;
+        double max_dq = dq.normInf();
+        if (max_dq > get_quasi_static_max_step()) {
+            step = get_quasi_static_max_step() / max_dq;
+        }
+
+        for (int k = 0; k < 10; ++k) {
+            for (int i = 0; i < n; ++i) {
+                coords[i]->setValue(state, q(i) + step * dq(i), false);
+            }
+            _model.assemble(state);
+            _model.realizeAcceleration(state);
+
+            for (int i = 0; i < n; ++i) {
+                perturbed_udot(i) = coords[i]->getAccelerationValue(state);
+            }
+
+            if (perturbed_udot.normInf() < udot_error) {
+                break;
+            }
+            step *= 0.5;
+        }
+    }
+
+    //The error of the last iterate has not been evaluated yet
+    if (iter == get_quasi_static_max_iterations()) {
+        if (get_equilibrate_muscles()) {
+            _model.equilibrateMuscles(state);
+        }
+        _model.realizeAcceleration(state);
+        for (int i = 0; i < n; ++i) {
+            udot(i) = coords[i]->getAccelerationValue(state);
+        }
+        udot_error = udot.normInf();
+    }
+
+    if (udot_error >= get_quasi_static_tolerance()) {
+        std::cout << "WARNING: quasi-static equilibrium not found at time: "
+            << state.getTime() << " max udot error: " << udot_error
+            << std::endl;
+    }
+
+    _model.realizeReport(state);
+}
+
 void ForsimTool::initializeStartStopTimes() {
     if (get_start_time() != -1 && get_stop_time() != -1) {
         return;
@@ -361,12 +1001,20 @@ void ForsimTool::initializeActuators(SimTK::State& state) {
 
                 try {
                     ScalarActuator& actuator = _model.updComponent<ScalarActuator>(actuator_path);
-                    actuator.overrideActuation(state, true);
                     _prescribed_frc_actuator_paths.push_back(actuator_path);
                     SimTK::Vector values = _actuator_table.getDependentColumn(labels[i]);
-                    SimmSpline* frc_function = new SimmSpline(nDataPt, &time[0], &values[0], actuator_path + "_frc");
+                    SimmSpline frc_function = SimmSpline(nDataPt, &time[0], &values[0], actuator_path + "_frc");
+
+                    //Apply the force with a component evaluated at every 
+                    //integrator step instead of overriding the actuation
+                    actuator.set_appliesForce(false);
 
-                    _frc_functions.adoptAndAppend(frc_function); 
+                    PrescribedActuatorForce* prescribed_force = 
+                        new PrescribedActuatorForce(
+                            actuator.getName() + "_prescribed_force",
+                            actuator, frc_function);
+
+                    _model.addForce(prescribed_force);
                 }
                 catch (ComponentNotFoundOnSpecifiedPath) {
                     
@@ -615,8 +1263,17 @@ void ForsimTool::printDebugInfo(const SimTK::State& state) {
             << std::setw(w) << "Control" << std::endl;
 
         for (const Muscle& msl : _model.updComponentList<Muscle>()) {
+            //Disabled muscles with a prescribed force have zero actuation
+            double actuation = msl.getActuation(state);
+            if (contains_string(_prescribed_frc_actuator_paths,
+                msl.getAbsolutePathString())) {
+                actuation = _model.getComponent<PrescribedActuatorForce>(
+                    "/forceset/" + msl.getName() + "_prescribed_force").
+                    getActuation(state);
+            }
+
             std::cout << std::setw(w) << msl.getName()
-                << std::setw(w) << msl.getActuation(state)
+                << std::setw(w) << actuation
                 << std::setw(w) << msl.getActivation(state)
                 << std::setw(w) << msl.getControl(state)
                 << std::endl;
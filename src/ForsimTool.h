@@ -28,6 +28,7 @@
 #include <OpenSim/Simulation/Model/AnalysisSet.h>
 #include "OpenSim/Simulation/Model/ExternalLoads.h"
 #include "OpenSim/Common/FunctionSet.h"
+#include "OutputPipeline.h"
 
 namespace OpenSim { 
 //=============================================================================
@@ -63,6 +64,8 @@ class OSIMPLUGIN_API ForsimTool : public Object {
 
 OpenSim_DECLARE_CONCRETE_OBJECT(ForsimTool, Object);
 
+friend class ForsimSimulationTask;
+
 //=============================================================================
 // PROPERTIES
 //=============================================================================
@@ -138,7 +141,10 @@ public:
         "controls, activations and forces to be applied during the "
         "simulation. The column labels must be formatted as 'time' and "
         "'ACTUATORNAME_control', 'ACTUATORNAME_activation', "
-        "'ACTUATORNAME_force'.")
+        "'ACTUATORNAME_force'. Prescribed forces are applied by a "
+        "PrescribedActuatorForce named ACTUATORNAME_prescribed_force, the "
+        "actuator itself is disabled and the prescribed force is reported "
+        "under its name.")
 
     OpenSim_DECLARE_PROPERTY(external_loads_file,std::string,
         "Path to .xml file that defines the ExternalLoads to apply to the "
@@ -158,6 +164,96 @@ public:
     OpenSim_DECLARE_PROPERTY(verbose, int, "Define how detailed the output to "
         "console should be. 0 - silent. The default value is 0.")
 
+    OpenSim_DECLARE_PROPERTY(quasi_static, bool,
+        "Replace the forward dynamic simulation with a sequence of static "
+        "equilibrium solutions. At each report time, the "
+        "unconstrained_coordinates are solved (Newton method, starting from "
+        "the previous solution) so their accelerations are zero with all "
+        "speeds set to zero, under the current prescribed coordinates, loads "
+        "and controls. The default value is false.")
+
+    OpenSim_DECLARE_PROPERTY(quasi_static_tolerance, double,
+        "Maximum acceleration of any unconstrained_coordinate at a "
+        "quasi_static equilibrium. The default value is 1e-3.")
+
+    OpenSim_DECLARE_PROPERTY(quasi_static_max_iterations, int,
+        "Maximum number of Newton iterations at each quasi_static report "
+        "time. The default value is 25.")
+
+    OpenSim_DECLARE_PROPERTY(quasi_static_max_step, double,
+        "Maximum change in any unconstrained_coordinate in a single "
+        "quasi_static Newton iteration. The default value is 0.01.")
+
+    OpenSim_DECLARE_PROPERTY(quasi_static_perturbation, double,
+        "Coordinate perturbation used to compute the finite difference "
+        "Jacobian in quasi_static mode. The default value is 1e-6.")
+
+    OpenSim_DECLARE_PROPERTY(settle_stop_threshold, double,
+        "Stop the simulation once the change in all settle_stop_coordinates "
+        "between report time steps is smaller than settle_stop_threshold. "
+        "Set to -1 to ignore. The default value is -1.")
+
+    OpenSim_DECLARE_LIST_PROPERTY(settle_stop_coordinates, std::string,
+        "Paths to the Coordinates checked by settle_stop_threshold. If "
+        "empty, the unconstrained_coordinates are checked.")
+
+    OpenSim_DECLARE_PROPERTY(contact_force_stop_threshold, double,
+        "Stop the simulation once the magnitude of the "
+        "casting_total_contact_force of any Smith2018ArticularContactForce "
+        "exceeds contact_force_stop_threshold. Set to -1 to ignore. "
+        "The default value is -1.")
+
+    OpenSim_DECLARE_PROPERTY(stop_at_coordinate_range_limits, bool,
+        "Stop the simulation once any unconstrained_coordinate reaches the "
+        "limits of its range. The default value is false.")
+
+    OpenSim_DECLARE_LIST_PROPERTY(checkpoint_times, double,
+        "Times at which a checkpoint of the simulation is written to "
+        "results_file_basename + '_checkpoint_#.sto'. The checkpoint "
+        "contains all state variables, the override actuation of each "
+        "ScalarActuator and the integrator step size. Controls and "
+        "prescribed functions are functions of time, so they are restored "
+        "with the state time. Other discrete variables (e.g. modeling "
+        "options) are not saved, they are set from the setup file when the "
+        "checkpoint is restored.")
+
+    OpenSim_DECLARE_PROPERTY(initial_state_file, std::string,
+        "Path to a checkpoint file to start the simulation from. The "
+        "start_time is set to the time of the checkpoint. "
+        "If empty, the simulation starts from the model default state. "
+        "The default value is ''.")
+
+    OpenSim_DECLARE_LIST_PROPERTY(branch_setup_files, std::string,
+        "Paths to ForsimTool setup files that are simulated after this "
+        "simulation. Branches with an empty initial_state_file start from "
+        "the last checkpoint written by this simulation. With an "
+        "ensemble_file, each variant writes its own checkpoints, so each "
+        "branch must set initial_state_file. A branch can not set "
+        "ensemble_file or branch_setup_files.")
+
+    OpenSim_DECLARE_PROPERTY(branch_num_threads, int,
+        "Maximum number of branches that are simulated in parallel. "
+        "If -1, the number of processors is used. The default value is -1.")
+
+    OpenSim_DECLARE_PROPERTY(ensemble_file, std::string,
+        "Path to storage file (.sto) defining an ensemble of simulations. "
+        "Each row is a variant of the simulation, the column labels must be "
+        "formatted as '/path/to/component/property_name' and the values "
+        "override the double properties in the model for that variant. "
+        "Results for each variant are written with the "
+        "results_file_basename + '_variant#' prefix. If empty, a single "
+        "simulation is performed. The default value is ''.")
+
+    OpenSim_DECLARE_PROPERTY(ensemble_num_threads, int,
+        "Maximum number of ensemble variants that are simulated in parallel. "
+        "If -1, the number of processors is used. The default value is -1.")
+
+    OpenSim_DECLARE_PROPERTY(num_output_threads, int,
+        "Number of threads that write the checkpoint and results files in "
+        "the background, so the simulation continues while a checkpoint is "
+        "written. If 0, the files are written on the main thread. If -1, "
+        "the number of processors is used. The default value is 0.")
+
     OpenSim_DECLARE_UNNAMED_PROPERTY(AnalysisSet,"Analyses to be performed "
         "throughout the forward simulation.")
 
@@ -176,11 +272,26 @@ public:
 private:
     void setNull();
     void constructProperties();
+    void initialize();
+    void simulate();
+    void runEnsemble();
+    void runBranches();
+    std::string makeAbsolutePath(const std::string& path) const;
+    void appendBasenameToH5Files();
+    void writeCheckpoint(const SimTK::State& state,
+        const SimTK::Integrator& integrator, int index);
+    void restoreCheckpoint(SimTK::State& state,
+        SimTK::Integrator& integrator);
+    void applyPropertyOverride(Model& model, const std::string& label,
+        double value);
     void initializeCoordinates();
     void initializeActuators(SimTK::State& state);
     void applyExternalLoads();
     void initializeStartStopTimes();
     void printDebugInfo(const SimTK::State& state);
+    void solveQuasiStaticEquilibrium(SimTK::State& state);
+    std::string checkStopConditions(const SimTK::State& state,
+        SimTK::Vector& prev_settle_values);
     
 //=============================================================================
 // DATA
@@ -195,13 +306,18 @@ private:
     std::vector<std::string> _prescribed_act_actuator_paths;
     std::vector<std::string> _prescribed_control_actuator_paths;
 
-    FunctionSet _frc_functions;
     FunctionSet _act_functions;
 
     TimeSeriesTable _actuator_table;
     TimeSeriesTable _coord_table;
+    TimeSeriesTable _initial_state_table;
+    std::string _last_checkpoint_file;
 
     std::string _directoryOfSetupFile;
+
+    //Declared last so the writer threads are stopped before the results
+    //they write are destroyed
+    std::shared_ptr<OutputPipeline> _output_pipeline;
 //=============================================================================
 };  // END of class ForsimTool
 
@@ -0,0 +1,287 @@
+/* -------------------------------------------------------------------------- *
+ *                          H5ContactReporter.cpp                             *
+ * -------------------------------------------------------------------------- *
+ * Author(s): Colin Smith                                                     *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may    *
+ * not use this file except in compliance with the License. You may obtain a  *
+ * copy of the License at http://www.apache.org/licenses/LICENSE-2.0.         *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ * -------------------------------------------------------------------------- */
+
+#include <OpenSim/Simulation/Model/Model.h>
+#include "H5ContactReporter.h"
+#include "Smith2018ArticularContactForce.h"
+#include "Blankevoort1991Ligament.h"
+#include "ContactStatisticsTool.h"
+#include "OutputPipeline.h"
+#include <cstdio>
+#include <fstream>
+
+using namespace OpenSim;
+
+//=============================================================================
+// CONSTRUCTORS
+//=============================================================================
+
+H5ContactReporter::H5ContactReporter(Model* model) : Analysis(model)
+{
+    setName("H5ContactReporter");
+    constructProperties();
+
+    _file_is_open = false;
+    _n_recorded = 0;
+}
+
+void H5ContactReporter::constructProperties()
+{
+    constructProperty_h5_file("");
+    constructProperty_contact_forces();
+
+    Array<std::string> triangle_outputs;
+    triangle_outputs.append("casting_triangle_proximity");
+    triangle_outputs.append("casting_triangle_pressure");
+    constructProperty_contact_triangle_outputs(triangle_outputs);
+
+    constructProperty_report_ligaments(true);
+    constructProperty_report_coordinates(true);
+    constructProperty_compression_level(4);
+    constructProperty_chunk_size(64);
+    constructProperty_flush_interval(100);
+}
+
+//=============================================================================
+// ANALYSIS
+//=============================================================================
+
+int H5ContactReporter::begin(const SimTK::State& s)
+{
+    if (!proceed()) return 0;
+
+    close();
+
+    //The results directory is only known in printResults() unless the
+    //tool set it, otherwise the file is streamed to the current directory
+    if (_results_file_basename.empty()) {
+        _stream_file = getName() + "_partial.h5";
+    }
+    else {
+        _stream_file = _results_file_basename + "_" + getName() +
+            "_partial.h5";
+        if (!_results_directory.empty()) {
+            _stream_file = _results_directory + "/" + _stream_file;
+        }
+    }
+
+    //The tool may be writing its own .h5 files with an OutputPipeline
+    std::unique_lock<std::mutex> hdf5_lock(OutputPipeline::getHDF5Mutex());
+
+    _h5_adapt.setChunkSize(get_chunk_size());
+    _h5_adapt.setCompressionLevel(get_compression_level());
+    _h5_adapt.open(_stream_file);
+    _file_is_open = true;
+    _n_recorded = 0;
+
+    _contact_paths.clear();
+    if (getProperty_contact_forces().size() == 0) {
+        for (const Smith2018ArticularContactForce& cnt :
+            _model->getComponentList<Smith2018ArticularContactForce>()) {
+            _contact_paths.push_back(cnt.getAbsolutePathString());
+        }
+    }
+    else {
+        for (int i = 0; i < getProperty_contact_forces().size(); ++i) {
+            _contact_paths.push_back(_model->getComponent
+                <Smith2018ArticularContactForce>(get_contact_forces(i)).
+                getAbsolutePathString());
+        }
+    }
+
+    //The target mesh outputs are only computed with flip_meshes
+    _contact_flip_meshes.clear();
+    for (const std::string& path : _contact_paths) {
+        const Smith2018ArticularContactForce& cnt =
+            _model->getComponent<Smith2018ArticularContactForce>(path);
+
+        bool flip = cnt.getModelingOption(s, "flip_meshes") != 0;
+        _contact_flip_meshes.push_back(flip);
+
+        if (flip) continue;
+
+        for (int i = 0; i < getProperty_contact_triangle_outputs().size(); ++i) {
+            if (get_contact_triangle_outputs(i).find("target_") == 0) {
+                std::cout << "WARNING: H5ContactReporter " << getName() <<
+                    ": flip_meshes is not set for " << cnt.getName() <<
+                    ", " << get_contact_triangle_outputs(i) <<
+                    " is not reported." << std::endl;
+            }
+        }
+    }
+
+    //Mesh geometry of the per triangle outputs (see ContactStatisticsTool)
+    for (const std::string& path : _contact_paths) {
+        const Smith2018ArticularContactForce& cnt =
+            _model->getComponent<Smith2018ArticularContactForce>(path);
+
+        ContactStatisticsTool::writeH5MeshGeometry(_h5_adapt,
+            "/Smith2018ArticularContactForce/" + cnt.getName(), cnt);
+    }
+    hdf5_lock.unlock();
+
+    record(s);
+
+    return 0;
+}
+
+int H5ContactReporter::step(const SimTK::State& s, int stepNumber)
+{
+    if (!proceed(stepNumber)) return 0;
+
+    record(s);
+
+    return 0;
+}
+
+int H5ContactReporter::end(const SimTK::State& s)
+{
+    if (!proceed()) return 0;
+
+    if (_file_is_open) {
+        std::lock_guard<std::mutex> hdf5_lock(OutputPipeline::getHDF5Mutex());
+        _h5_adapt.flush();
+    }
+
+    return 0;
+}
+
+int H5ContactReporter::printResults(const std::string& baseName,
+    const std::string& dir, double dT, const std::string& extension)
+{
+    //Results are written as they are recorded
+    if (!_file_is_open) return 0;
+
+    close();
+
+    std::string file = get_h5_file();
+    if (file.empty()) {
+        file = baseName + "_" + getName() + ".h5";
+    }
+
+    bool is_absolute = file[0] == '/' || file[0] == '\\' ||
+        (file.size() > 1 && file[1] == ':');
+    if (!is_absolute && !dir.empty()) {
+        file = dir + "/" + file;
+    }
+
+    //Copy if the file can not be renamed (e.g. to another file system)
+    if (std::rename(_stream_file.c_str(), file.c_str()) != 0) {
+        {
+            std::ifstream src(_stream_file, std::ios::binary);
+            std::ofstream dst(file, std::ios::binary);
+
+            OPENSIM_THROW_IF(!src || !dst, Exception,
+                "H5ContactReporter could not move " + _stream_file +
+                " to " + file + ".")
+
+            dst << src.rdbuf();
+        }
+        std::remove(_stream_file.c_str());
+    }
+
+    return 0;
+}
+
+void H5ContactReporter::setResultsFileBasename(
+    const std::string& results_directory,
+    const std::string& results_file_basename)
+{
+    _results_directory = results_directory;
+    _results_file_basename = results_file_basename;
+}
+
+void H5ContactReporter::close()
+{
+    if (_file_is_open) {
+        std::lock_guard<std::mutex> hdf5_lock(OutputPipeline::getHDF5Mutex());
+        _h5_adapt.close();
+        _file_is_open = false;
+    }
+}
+
+void H5ContactReporter::record(const SimTK::State& s)
+{
+    if (!_file_is_open) return;
+
+    _model->realizeReport(s);
+
+    std::lock_guard<std::mutex> hdf5_lock(OutputPipeline::getHDF5Mutex());
+
+    _h5_adapt.appendDataSetValue(s.getTime(), "/time");
+
+    //Contact
+    for (int c = 0; c < (int)_contact_paths.size(); ++c) {
+        const Smith2018ArticularContactForce& cnt = _model->getComponent
+            <Smith2018ArticularContactForce>(_contact_paths[c]);
+        bool flip = _contact_flip_meshes[c];
+
+        std::string group =
+            "/Smith2018ArticularContactForce/" + cnt.getName() + "/";
+
+        for (int i = 0; i < getProperty_contact_triangle_outputs().size(); ++i) {
+            const std::string& output = get_contact_triangle_outputs(i);
+            if (!flip && output.find("target_") == 0) continue;
+
+            _h5_adapt.appendDataSetVectorRow(
+                cnt.getOutputValue<SimTK::Vector>(s, output), group + output);
+        }
+
+        SimTK::Vec3 casting_force =
+            cnt.getOutputValue<SimTK::Vec3>(s, "casting_total_contact_force");
+        _h5_adapt.appendDataSetVectorRow(SimTK::Vector(casting_force),
+            group + "casting_total_contact_force");
+
+        if (flip) {
+            SimTK::Vec3 target_force = cnt.getOutputValue<SimTK::Vec3>(
+                s, "target_total_contact_force");
+            _h5_adapt.appendDataSetVectorRow(SimTK::Vector(target_force),
+                group + "target_total_contact_force");
+        }
+    }
+
+    //Ligaments
+    if (get_report_ligaments()) {
+        for (const Blankevoort1991Ligament& lig :
+            _model->getComponentList<Blankevoort1991Ligament>()) {
+
+            std::string group =
+                "/Blankevoort1991Ligament/" + lig.getName() + "/";
+
+            _h5_adapt.appendDataSetValue(
+                lig.getOutputValue<double>(s, "total_force"),
+                group + "total_force");
+            _h5_adapt.appendDataSetValue(
+                lig.getOutputValue<double>(s, "strain"), group + "strain");
+        }
+    }
+
+    //Coordinates
+    if (get_report_coordinates()) {
+        for (const Coordinate& coord : _model->getComponentList<Coordinate>()) {
+            std::string group = "/Coordinates/" + coord.getName() + "/";
+
+            _h5_adapt.appendDataSetValue(coord.getValue(s), group + "value");
+            _h5_adapt.appendDataSetValue(
+                coord.getSpeedValue(s), group + "speed");
+        }
+    }
+
+    _n_recorded++;
+    if (get_flush_interval() > 0 && _n_recorded % get_flush_interval() == 0) {
+        _h5_adapt.flush();
+    }
+}
@@ -0,0 +1,148 @@
+#ifndef OPENSIM_H5_CONTACT_REPORTER_H_
+#define OPENSIM_H5_CONTACT_REPORTER_H_
+/* -------------------------------------------------------------------------- *
+ *                           H5ContactReporter.h                              *
+ * -------------------------------------------------------------------------- *
+ * Author(s): Colin Smith                                                     *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may    *
+ * not use this file except in compliance with the License. You may obtain a  *
+ * copy of the License at http://www.apache.org/licenses/LICENSE-2.0.         *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ * -------------------------------------------------------------------------- */
+
+#include <OpenSim/Simulation/Model/Analysis.h>
+#include "H5FileAdapter.h"
+#include "osimPluginDLL.h"
+
+namespace OpenSim {
+
+//=============================================================================
+//                            H5ContactReporter
+//=============================================================================
+/**
+This Analysis streams joint mechanics outputs to an .h5 file as the
+simulation runs, so it can be added to the AnalysisSet of the ForsimTool,
+COMAKTool or any OpenSim tool. Each reported step appends one row to
+chunked, compressed, extendible datasets and nothing is accumulated in
+memory.
+
+The file layout matches the JointMechanicsTool .h5 files:
+
+/time
+/Smith2018ArticularContactForce/<name>/<output> (rows x triangles)
+/Smith2018ArticularContactForce/<name>/casting_total_contact_force (rows x 3)
+/Smith2018ArticularContactForce/<name>/target_total_contact_force (rows x 3)
+/Smith2018ArticularContactForce/<name>/geometry/casting_mesh/... (triangles)
+/Smith2018ArticularContactForce/<name>/geometry/target_mesh/... (triangles)
+/Blankevoort1991Ligament/<name>/total_force
+/Blankevoort1991Ligament/<name>/strain
+/Coordinates/<name>/value
+/Coordinates/<name>/speed
+
+The target mesh outputs (target_triangle_* and target_total_contact_force)
+are only computed if the flip_meshes modeling option of the contact force
+is set in the simulated State, otherwise they are not reported.
+
+While the simulation runs, the results are streamed to <name>_partial.h5
+in the current directory, or to
+<results_directory>/<results_file_basename>_<name>_partial.h5 if the tool
+running the simulation calls setResultsFileBasename(). The file is moved to
+the results directory when printResults() is called.
+
+@author Colin Smith
+*/
+
+class OSIMPLUGIN_API H5ContactReporter : public Analysis {
+OpenSim_DECLARE_CONCRETE_OBJECT(H5ContactReporter, Analysis);
+
+public:
+//=============================================================================
+// PROPERTIES
+//=============================================================================
+    OpenSim_DECLARE_PROPERTY(h5_file, std::string,
+        "Path to the .h5 file the results are written to. A relative path "
+        "is relative to the results directory passed to printResults(). "
+        "If empty, the file is named <results_file_basename>_<name>.h5. "
+        "For ForsimTool ensemble variants and branches, "
+        "_<results_file_basename> is inserted before the extension. "
+        "The default value is ''.")
+
+    OpenSim_DECLARE_LIST_PROPERTY(contact_forces, std::string,
+        "Paths to the Smith2018ArticularContactForces to report. "
+        "If empty, all contact forces in the model are reported.")
+
+    OpenSim_DECLARE_LIST_PROPERTY(contact_triangle_outputs, std::string,
+        "Names of the SimTK::Vector (per triangle) outputs of the "
+        "Smith2018ArticularContactForces to report. The target_triangle_* "
+        "outputs are only reported if flip_meshes is set. The default "
+        "values are casting_triangle_proximity and "
+        "casting_triangle_pressure.")
+
+    OpenSim_DECLARE_PROPERTY(report_ligaments, bool,
+        "Report the total_force and strain of all Blankevoort1991Ligaments. "
+        "The default value is true.")
+
+    OpenSim_DECLARE_PROPERTY(report_coordinates, bool,
+        "Report the value and speed of all Coordinates. "
+        "The default value is true.")
+
+    OpenSim_DECLARE_PROPERTY(compression_level, int,
+        "gzip compression level (0-9) of the datasets, 0 disables "
+        "compression. The default value is 4.")
+
+    OpenSim_DECLARE_PROPERTY(chunk_size, int,
+        "Number of rows in each chunk of the datasets. "
+        "The default value is 64.")
+
+    OpenSim_DECLARE_PROPERTY(flush_interval, int,
+        "Number of reported steps between flushes of the file to disk. "
+        "The default value is 100.")
+
+//=============================================================================
+// METHODS
+//=============================================================================
+    H5ContactReporter(Model* model = nullptr);
+
+    int begin(const SimTK::State& s) override;
+    int step(const SimTK::State& s, int stepNumber) override;
+    int end(const SimTK::State& s) override;
+
+    int printResults(const std::string& baseName,
+        const std::string& dir = "", double dT = -1.0,
+        const std::string& extension = ".sto") override;
+
+    /** Stream the results to
+    <results_directory>/<results_file_basename>_<name>_partial.h5, so runs
+    that are simulated in parallel do not share a file. */
+    void setResultsFileBasename(const std::string& results_directory,
+        const std::string& results_file_basename);
+
+private:
+    void constructProperties();
+    void record(const SimTK::State& s);
+    void close();
+
+//=============================================================================
+// DATA
+//=============================================================================
+    H5FileAdapter _h5_adapt;
+    bool _file_is_open;
+    std::string _stream_file;
+    std::string _results_directory;
+    std::string _results_file_basename;
+    int _n_recorded;
+    std::vector<std::string> _contact_paths;
+    std::vector<bool> _contact_flip_meshes;
+
+//=============================================================================
+};  // END of class H5ContactReporter
+
+} // end of namespace OpenSim
+
+#endif // OPENSIM_H5_CONTACT_REPORTER_H_
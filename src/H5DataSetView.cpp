@@ -0,0 +1,248 @@
+/* -------------------------------------------------------------------------- *
+ *                            H5DataSetView.cpp                               *
+ * -------------------------------------------------------------------------- *
+ * Author(s): Colin Smith                                                     *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may    *
+ * not use this file except in compliance with the License. You may obtain a  *
+ * copy of the License at http://www.apache.org/licenses/LICENSE-2.0.         *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,         *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ * -------------------------------------------------------------------------- */
+
+#include "H5DataSetView.h"
+#include <OpenSim/Common/Exception.h>
+#include <algorithm>
+
+using namespace OpenSim;
+
+//=============================================================================
+// CONSTRUCTORS
+//=============================================================================
+
+H5DataSetView::H5DataSetView()
+{
+    _n_rows = 0;
+    _n_cols = 0;
+    _rank = 0;
+    _sparse = false;
+    _has_scales = false;
+}
+
+H5DataSetView::H5DataSetView(const H5::H5File& file, const std::string& path)
+    : H5DataSetView()
+{
+    _path = path;
+
+    if (file.childObjType(path) == H5O_TYPE_GROUP) {
+        H5::Group group = file.openGroup(path);
+
+        OPENSIM_THROW_IF(!group.attrExists("n_cols") ||
+            !group.nameExists("offsets"), Exception,
+            "H5DataSetView: " + path + " is a group but not a sparse "
+            "(CSR) dataset.")
+
+        _sparse = true;
+        group.openAttribute("n_cols").read(H5::PredType::NATIVE_INT, &_n_cols);
+
+        _offsets = group.openDataSet("offsets");
+        _indices = group.openDataSet("indices");
+        _values = group.openDataSet("values");
+
+        _has_scales = group.nameExists("scales");
+        if (_has_scales) {
+            _scales = group.openDataSet("scales");
+        }
+
+        _n_rows = (int)_offsets.getSpace().getSimpleExtentNpoints() - 1;
+        _n_rows = std::max(_n_rows, 0);
+        return;
+    }
+
+    _dataset = file.openDataSet(path);
+
+    H5::DataSpace space = _dataset.getSpace();
+    _rank = space.getSimpleExtentNdims();
+
+    OPENSIM_THROW_IF(_rank != 1 && _rank != 2, Exception,
+        "H5DataSetView: " + path + " has " + std::to_string(_rank) +
+        " dimensions, only 1D and 2D datasets can be viewed.")
+
+    hsize_t dims[2] = { 0, 1 };
+    space.getSimpleExtentDims(dims);
+
+    _n_rows = (int)dims[0];
+    _n_cols = (int)dims[1];
+}
+
+//=============================================================================
+// METHODS
+//=============================================================================
+
+void H5DataSetView::checkRange(int start, int count) const
+{
+    OPENSIM_THROW_IF(start < 0 || count < 0 || start + count > _n_rows,
+        Exception, "H5DataSetView: rows [" + std::to_string(start) + ", " +
+        std::to_string(start + count) + ") are out of range, " + _path +
+        " has " + std::to_string(_n_rows) + " rows.")
+}
+
+SimTK::Matrix H5DataSetView::readRows(int start, int count) const
+{
+    checkRange(start, count);
+
+    if (_sparse) {
+        return readSparseRows(start, count);
+    }
+
+    std::vector<int> columns(_n_cols);
+    for (int c = 0; c < _n_cols; ++c) columns[c] = c;
+
+    std::vector<double> data;
+    readDenseBlock(start, count, columns, data);
+
+    SimTK::Matrix rows(count, _n_cols);
+    for (int r = 0; r < count; ++r) {
+        for (int c = 0; c < _n_cols; ++c) {
+            rows(r, c) = data[(size_t)r * _n_cols + c];
+        }
+    }
+    return rows;
+}
+
+SimTK::Vector H5DataSetView::readRow(int row) const
+{
+    return ~readRows(row, 1)[0];
+}
+
+SimTK::Matrix H5DataSetView::readColumns(const std::vector<int>& columns,
+    int start, int count) const
+{
+    if (count < 0) count = _n_rows - start;
+    checkRange(start, count);
+
+    for (int col : columns) {
+        OPENSIM_THROW_IF(col < 0 || col >= _n_cols, IndexOutOfRange,
+            (size_t)col, 0, (size_t)std::max(_n_cols - 1, 0))
+    }
+
+    SimTK::Matrix data(count, (int)columns.size());
+
+    //Sparse rows are small, read them whole and pick the columns
+    if (_sparse) {
+        SimTK::Matrix rows = readSparseRows(start, count);
+        for (int j = 0; j < (int)columns.size(); ++j) {
+            data(j) = rows(columns[j]);
+        }
+        return data;
+    }
+
+    //The hyperslab is read in file order, so the columns are sorted
+    std::vector<int> sorted = columns;
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+    std::vector<double> block;
+    readDenseBlock(start, count, sorted, block);
+
+    int n_sorted = (int)sorted.size();
+    for (int j = 0; j < (int)columns.size(); ++j) {
+        int k = (int)(std::lower_bound(sorted.begin(), sorted.end(),
+            columns[j]) - sorted.begin());
+
+        for (int r = 0; r < count; ++r) {
+            data(r, j) = block[(size_t)r * n_sorted + k];
+        }
+    }
+    return data;
+}
+
+void H5DataSetView::readDenseBlock(int start, int count,
+    const std::vector<int>& columns, std::vector<double>& data) const
+{
+    data.assign((size_t)count * columns.size(), 0.0);
+    if (data.empty()) return;
+
+    H5::DataSpace file_space = _dataset.getSpace();
+
+    if (_rank == 1) {
+        hsize_t offset[1] = { (hsize_t)start };
+        hsize_t size[1] = { (hsize_t)count };
+        file_space.selectHyperslab(H5S_SELECT_SET, size, offset);
+    }
+    else {
+        //Union of a hyperslab for each run of consecutive columns
+        bool first = true;
+        size_t i = 0;
+        while (i < columns.size()) {
+            size_t j = i + 1;
+            while (j < columns.size() && columns[j] == columns[j - 1] + 1) {
+                j++;
+            }
+
+            hsize_t offset[2] = { (hsize_t)start, (hsize_t)columns[i] };
+            hsize_t size[2] = { (hsize_t)count, (hsize_t)(j - i) };
+            file_space.selectHyperslab(
+                first ? H5S_SELECT_SET : H5S_SELECT_OR, size, offset);
+
+            first = false;
+            i = j;
+        }
+    }
+
+    hsize_t n_values[1] = { data.size() };
+    H5::DataSpace mem_space(1, n_values);
+
+    _dataset.read(data.data(), H5::PredType::NATIVE_DOUBLE,
+        mem_space, file_space);
+}
+
+SimTK::Matrix H5DataSetView::readSparseRows(int start, int count) const
+{
+    SimTK::Matrix rows(count, _n_cols, 0.0);
+    if (count == 0) return rows;
+
+    std::vector<long long> offsets(count + 1);
+    readRange(_offsets, start, offsets.size(), H5::PredType::NATIVE_LLONG,
+        offsets.data());
+
+    hsize_t nnz = offsets[count] - offsets[0];
+    std::vector<int> indices(nnz);
+    std::vector<double> values(nnz);
+    readRange(_indices, offsets[0], nnz, H5::PredType::NATIVE_INT,
+        indices.data());
+    readRange(_values, offsets[0], nnz, H5::PredType::NATIVE_DOUBLE,
+        values.data());
+
+    std::vector<double> scales(count, 1.0);
+    if (_has_scales) {
+        readRange(_scales, start, count, H5::PredType::NATIVE_DOUBLE,
+            scales.data());
+    }
+
+    for (int r = 0; r < count; ++r) {
+        for (long long k = offsets[r]; k < offsets[r + 1]; ++k) {
+            size_t i = (size_t)(k - offsets[0]);
+            rows(r, indices[i]) = values[i] * scales[r];
+        }
+    }
+    return rows;
+}
+
+void H5DataSetView::readRange(const H5::DataSet& dataset, hsize_t start,
+    hsize_t count, const H5::DataType& mem_type, void* data) const
+{
+    if (count == 0) return;
+
+    hsize_t offset[1] = { start };
+    hsize_t size[1] = { count };
+    H5::DataSpace file_space = dataset.getSpace();
+    file_space.selectHyperslab(H5S_SELECT_SET, size, offset);
+    H5::DataSpace mem_space(1, size);
+
+    dataset.read(data, mem_type, mem_space, file_space);
+}
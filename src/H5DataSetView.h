@@ -0,0 +1,112 @@
+#ifndef OPENSIM_H5_DATASET_VIEW_H_
+#define OPENSIM_H5_DATASET_VIEW_H_
+/* -------------------------------------------------------------------------- *
+ *                             H5DataSetView.h                                *
+ * -------------------------------------------------------------------------- *
+ * Author(s): Colin Smith                                                     *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may    *
+ * not use this file except in compliance with the License. You may obtain a  *
+ * copy of the License at http://www.apache.org/licenses/LICENSE-2.0.         *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,         *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ * -------------------------------------------------------------------------- */
+
+#include <string>
+#include <vector>
+#include "SimTKcommon.h"
+#include "H5Cpp.h"
+#include "osimPluginDLL.h"
+
+namespace OpenSim {
+
+//=============================================================================
+//                              H5DataSetView
+//=============================================================================
+/**
+A read only view of a (frames x columns) dataset in an .h5 file, such as
+the per triangle pressure of a contact mesh written by JointMechanicsTool.
+Nothing is read when the view is created, each read only fetches the
+requested frames and columns (e.g. a subset of triangles) from the file
+with a hyperslab selection, so only the chunks that contain them are read
+and decompressed. Whole per triangle matrices never need to be loaded.
+
+The view can be a 1D dataset (frames x 1), a 2D dataset, or a sparse (CSR)
+group written by H5FileAdapter::writeSparseDataSetSimTKMatrix(), which is
+densified as it is read.
+
+Views are created with H5FileAdapter::openDataSetView() and stay valid
+while the H5FileAdapter is open.
+
+@author Colin Smith
+*/
+
+class OSIMPLUGIN_API H5DataSetView {
+
+public:
+//=============================================================================
+// METHODS
+//=============================================================================
+    H5DataSetView();
+
+    /** path is an existing 1D or 2D dataset or sparse (CSR) group in
+    file. */
+    H5DataSetView(const H5::H5File& file, const std::string& path);
+
+    const std::string& getPath() const { return _path; }
+    int getNumRows() const { return _n_rows; }
+    int getNumColumns() const { return _n_cols; }
+    bool isSparse() const { return _sparse; }
+
+    /** Read count rows (frames) starting at row start. */
+    SimTK::Matrix readRows(int start, int count) const;
+
+    SimTK::Vector readRow(int row) const;
+
+    /** Read the columns (e.g. a subset of triangles) of count rows
+    starting at row start, in the order they are listed. If count is -1,
+    all rows after start are read. */
+    SimTK::Matrix readColumns(const std::vector<int>& columns,
+        int start = 0, int count = -1) const;
+
+private:
+    void checkRange(int start, int count) const;
+
+    /** Read the sorted, unique columns of count rows from the dense
+    dataset into data (count x columns.size(), row major). */
+    void readDenseBlock(int start, int count,
+        const std::vector<int>& columns, std::vector<double>& data) const;
+
+    SimTK::Matrix readSparseRows(int start, int count) const;
+
+    void readRange(const H5::DataSet& dataset, hsize_t start, hsize_t count,
+        const H5::DataType& mem_type, void* data) const;
+
+//=============================================================================
+// DATA
+//=============================================================================
+    std::string _path;
+    int _n_rows;
+    int _n_cols;
+    int _rank;
+    bool _sparse;
+    bool _has_scales;
+
+    H5::DataSet _dataset;
+
+    //Sparse (CSR) datasets
+    H5::DataSet _offsets;
+    H5::DataSet _indices;
+    H5::DataSet _values;
+    H5::DataSet _scales;
+
+//=============================================================================
+};  // END of class H5DataSetView
+
+} // end of namespace OpenSim
+
+#endif // OPENSIM_H5_DATASET_VIEW_H_
@@ -17,12 +17,35 @@
 #include "H5FileAdapter.h"
 #include "HelperFunctions.h"
 #include <fstream>
+#include <cmath>
 
 using namespace OpenSim;
 
+namespace {
+	//Nonzeros are appended in large chunks, a chunk per frame would be tiny
+	const int sparse_chunk_size = 16384;
+
+	H5::PredType getSparseValueType(const std::string& precision) {
+		if (precision == "double") return H5::PredType::NATIVE_DOUBLE;
+		if (precision == "float") return H5::PredType::NATIVE_FLOAT;
+		if (precision == "int16") return H5::PredType::NATIVE_SHORT;
+
+		OPENSIM_THROW(Exception, "H5FileAdapter: sparse dataset precision "
+			"must be 'double', 'float' or 'int16', not '" + precision + "'.")
+	}
+
+	std::string getChildPath(const std::string& group_path,
+		const std::string& name) {
+		return (group_path == "/") ? "/" + name : group_path + "/" + name;
+	}
+}
+
 H5FileAdapter::H5FileAdapter()
 {
 	_time_is_empty = true;
+	_chunk_size = 64;
+	_compression_level = 0;
+	_shuffle = false;
 }
 
 H5FileAdapter* H5FileAdapter::clone() const
@@ -35,10 +58,59 @@ void H5FileAdapter::open(const std::string& file_name)
 	_file = H5::H5File(file_name, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
 }
 
+void H5FileAdapter::open(const std::string& file_name, bool append)
+{
+	std::ifstream file_check(file_name);
+	bool file_exists = file_check.good();
+	file_check.close();
+
+	if (append && file_exists) {
+		_file = H5::H5File(file_name, H5F_ACC_RDWR, H5P_DEFAULT, H5P_DEFAULT);
+		_time_is_empty = !exists("/time");
+	}
+	else {
+		open(file_name);
+	}
+}
+
+void H5FileAdapter::openReadOnly(const std::string& file_name)
+{
+	_file = H5::H5File(file_name, H5F_ACC_RDONLY, H5P_DEFAULT, H5P_DEFAULT);
+	_time_is_empty = !exists("/time");
+}
+
 void H5FileAdapter::close() {
+	_extendible_datasets.clear();
 	_file.close();
 }
 
+void H5FileAdapter::flush() {
+	_file.flush(H5F_SCOPE_GLOBAL);
+}
+
+bool H5FileAdapter::exists(const std::string& path) {
+	//H5Lexists fails if an intermediate group is missing, check each level
+	std::string sub_path = "";
+	std::vector<std::string> levels = split_string(path, "/");
+
+	for (std::string level : levels) {
+		if (level.empty()) continue;
+
+		sub_path = sub_path + "/" + level;
+		if (H5Lexists(_file.getId(), sub_path.c_str(), H5P_DEFAULT) <= 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void H5FileAdapter::remove(const std::string& path) {
+	if (exists(path)) {
+		_extendible_datasets.erase(path);
+		_file.unlink(path);
+	}
+}
+
 void H5FileAdapter::createGroup(const std::string& group_name) {
     
     if(H5Lexists(_file.getId(), group_name.c_str(), H5P_DEFAULT ) == 0){
@@ -248,13 +320,128 @@ void H5FileAdapter::writeComponentGroupDataSetVector(std::string group_name,
     }
 }
     
+void H5FileAdapter::writeSparseComponentGroupDataSetVector(std::string group_name,
+	std::vector<std::string> names,
+	std::vector<std::string> output_vector_names,
+	std::vector<std::vector<SimTK::Matrix>> output_vector_values,
+	const std::string& precision)
+{
+	createGroup(group_name);
+
+	int i = 0;
+	for (std::string comp_name : names) {
+		std::string comp_group = group_name + "/" + comp_name;
+		createGroup(comp_group);
+
+		int j = 0;
+		for (std::string data_label : output_vector_names) {
+			writeSparseDataSetSimTKMatrix(output_vector_values[i][j],
+				comp_group + "/" + data_label, precision);
+			j++;
+		}
+		i++;
+	}
+}
+
+void H5FileAdapter::writePackedComponentGroupDataSet(std::string group_name,
+	std::vector<std::string> names,
+	std::vector<std::string> output_double_names,
+	std::vector<SimTK::Matrix> output_double_values)
+{
+	createGroup(group_name);
+
+	int n_comp = (int)names.size();
+	if (n_comp == 0) return;
+	int n_rows = output_double_values[0].nrow();
+
+	int j = 0;
+	for (std::string data_label : output_double_names) {
+		SimTK::Matrix data(n_rows, n_comp);
+		for (int i = 0; i < n_comp; ++i) {
+			data(i) = output_double_values[i](j);
+		}
+		std::string dataset_path = group_name + "/" + data_label;
+		writeDataSetSimTKMatrix(data, dataset_path);
+		writeStringArrayAttribute(dataset_path, "components", names);
+		j++;
+	}
+}
+
+void H5FileAdapter::writePackedComponentGroupDataSetVec3(std::string group_name,
+	std::vector<std::string> names,
+	std::vector<std::string> output_vec3_names,
+	std::vector<SimTK::Matrix_<SimTK::Vec3>> output_vec3_values)
+{
+	createGroup(group_name);
+
+	int n_comp = (int)names.size();
+	if (n_comp == 0) return;
+	hsize_t dim_data[3];
+	dim_data[0] = output_vec3_values[0].nrow();
+	dim_data[1] = n_comp;
+	dim_data[2] = 3;
+
+	H5::PredType datatype(H5::PredType::NATIVE_DOUBLE);
+	std::vector<double> data(dim_data[0] * dim_data[1] * 3);
+
+	int j = 0;
+	for (std::string data_label : output_vec3_names) {
+		for (int r = 0; r < (int)dim_data[0]; ++r) {
+			for (int i = 0; i < n_comp; ++i) {
+				for (int k = 0; k < 3; ++k) {
+					data[(r * n_comp + i) * 3 + k] = output_vec3_values[i](r, j)(k);
+				}
+			}
+		}
+
+		std::string dataset_path = group_name + "/" + data_label;
+		H5::DataSpace dataspace(3, dim_data, dim_data);
+		H5::DataSet dataset = _file.createDataSet(dataset_path, datatype, dataspace);
+		dataset.write(&data[0], datatype);
+
+		writeStringArrayAttribute(dataset_path, "components", names);
+		j++;
+	}
+}
+
+void H5FileAdapter::writeStringArrayAttribute(const std::string& dataset_path,
+	const std::string& name, const std::vector<std::string>& values)
+{
+	H5::DataSet dataset = _file.openDataSet(dataset_path);
+
+	if (dataset.attrExists(name)) {
+		dataset.removeAttr(name);
+	}
+
+	std::vector<const char*> c_values;
+	for (const std::string& value : values) {
+		c_values.push_back(value.c_str());
+	}
+
+	hsize_t dim[1] = { values.size() };
+	H5::DataSpace dataspace(1, dim);
+	H5::StrType datatype(H5::PredType::C_S1, H5T_VARIABLE);
+
+	H5::Attribute attribute = dataset.createAttribute(name, datatype, dataspace);
+	attribute.write(datatype, &c_values[0]);
+}
+
 void H5FileAdapter::writeDataSetSimTKVector(const SimTK::Vector& data_vector, const std::string dataset_path) {
 	hsize_t dim_data[1];
 	dim_data[0] = data_vector.size();
 
 	H5::DataSpace dataspace(1, dim_data, dim_data);
 	H5::PredType datatype(H5::PredType::NATIVE_DOUBLE);
-	H5::DataSet dataset = _file.createDataSet(dataset_path, datatype, dataspace);
+	H5::DataSet dataset;
+
+	//Overwrite existing dataset in place if the size is unchanged
+	if (exists(dataset_path) && getDataSetSize(dataset_path) == data_vector.size()) {
+		dataset = _file.openDataSet(dataset_path);
+	}
+	else {
+		remove(dataset_path);
+		dataset = _file.createDataSet(dataset_path, datatype, dataspace);
+	}
 
 	//Allocate space for data
 	double* data = (double*)malloc(dim_data[0] * sizeof(double));
@@ -368,9 +555,801 @@ void H5FileAdapter::writeTimeDataSet(const Array<double>& time) {
 	}
 }
 	
+void H5FileAdapter::setChunkSize(int chunk_size) {
+	_chunk_size = chunk_size;
+}
+
+void H5FileAdapter::setCompressionLevel(int compression_level) {
+	_compression_level = compression_level;
+}
+
+void H5FileAdapter::createParentGroups(const std::string& path) {
+	std::string sub_path = "";
+	std::vector<std::string> levels = split_string(path, "/");
+
+	for (int i = 0; i < (int)levels.size() - 1; ++i) {
+		if (levels[i].empty()) continue;
+
+		sub_path = sub_path + "/" + levels[i];
+		if (H5Lexists(_file.getId(), sub_path.c_str(), H5P_DEFAULT) <= 0) {
+			_file.createGroup(sub_path);
+		}
+	}
+}
+
+void H5FileAdapter::setShuffle(bool shuffle) {
+	_shuffle = shuffle;
+}
+
+void H5FileAdapter::createExtendibleDataSet(const std::string& dataset_path, int n_cols) {
+	getExtendibleDataSet(dataset_path, n_cols);
+}
+
+void H5FileAdapter::createExtendibleDataSetVec3(const std::string& dataset_path, int n_cols) {
+	getExtendibleDataSet(dataset_path, n_cols, 3);
+}
+
+H5::DataSet& H5FileAdapter::getExtendibleDataSet(const std::string& dataset_path,
+	int n_cols, int n_depth, const H5::DataType& datatype, int chunk_rows_max) {
+	auto it = _extendible_datasets.find(dataset_path);
+	if (it != _extendible_datasets.end()) {
+		return it->second;
+	}
+
+	if (!exists(dataset_path)) {
+		createParentGroups(dataset_path);
+
+		//Limit the chunk to the default 1 MB chunk cache, larger chunks are
+		//rewritten (and recompressed) every time a row is appended
+		int rank = (n_cols == 0) ? 1 : (n_depth == 0) ? 2 : 3;
+		hsize_t row_bytes = 
+			datatype.getSize() * std::max(n_cols, 1) * std::max(n_depth, 1);
+		hsize_t chunk_rows = (chunk_rows_max > 0) ? chunk_rows_max : _chunk_size;
+		chunk_rows = std::max((hsize_t)1,
+			std::min(chunk_rows, (hsize_t)(1 << 20) / row_bytes));
+
+		hsize_t dim_data[3] = { 0, (hsize_t)n_cols, (hsize_t)n_depth };
+		hsize_t max_dim_data[3] = { H5S_UNLIMITED, (hsize_t)n_cols, (hsize_t)n_depth };
+		hsize_t dim_chunk[3] = { chunk_rows, (hsize_t)n_cols, (hsize_t)n_depth };
+
+		H5::DataSpace dataspace(rank, dim_data, max_dim_data);
+		H5::DSetCreatPropList prop_list;
+		prop_list.setChunk(rank, dim_chunk);
+		if (_shuffle) {
+			prop_list.setShuffle();
+		}
+		if (_compression_level > 0) {
+			prop_list.setDeflate(_compression_level);
+		}
+
+		_file.createDataSet(dataset_path, datatype, dataspace, prop_list);
+	}
+
+	return _extendible_datasets[dataset_path] = _file.openDataSet(dataset_path);
+}
+
+void H5FileAdapter::appendDataSetValue(double value, const std::string dataset_path) {
+	H5::PredType datatype(H5::PredType::NATIVE_DOUBLE);
+
+	H5::DataSet& dataset = getExtendibleDataSet(dataset_path, 0);
+
+	hsize_t offset[1];
+	offset[0] = dataset.getSpace().getSimpleExtentNpoints();
+
+	hsize_t dim_new[1] = { offset[0] + 1 };
+	dataset.extend(dim_new);
+
+	hsize_t dim_value[1] = { 1 };
+	H5::DataSpace file_space = dataset.getSpace();
+	file_space.selectHyperslab(H5S_SELECT_SET, dim_value, offset);
+	H5::DataSpace mem_space(1, dim_value);
+
+	dataset.write(&value, datatype, mem_space, file_space);
+}
+
+void H5FileAdapter::appendDataSetVectorRow(const SimTK::Vector& values, const std::string dataset_path) {
+	H5::PredType datatype(H5::PredType::NATIVE_DOUBLE);
+	hsize_t n_cols = values.size();
+
+	H5::DataSet& dataset = getExtendibleDataSet(dataset_path, (int)n_cols);
+
+	hsize_t dim_current[2];
+	dataset.getSpace().getSimpleExtentDims(dim_current);
+
+	OPENSIM_THROW_IF(dim_current[1] != n_cols, Exception,
+		"appendDataSetVectorRow: " + dataset_path + " has " +
+		std::to_string(dim_current[1]) + " columns, row has " +
+		std::to_string(n_cols) + ".")
+
+	hsize_t dim_new[2] = { dim_current[0] + 1, n_cols };
+	dataset.extend(dim_new);
+
+	hsize_t offset[2] = { dim_current[0], 0 };
+	hsize_t dim_row[2] = { 1, n_cols };
+	H5::DataSpace file_space = dataset.getSpace();
+	file_space.selectHyperslab(H5S_SELECT_SET, dim_row, offset);
+	H5::DataSpace mem_space(2, dim_row);
+
+	dataset.write(&values[0], datatype, mem_space, file_space);
+}
+
+void H5FileAdapter::appendDataSetVec3Row(const SimTK::Vector_<SimTK::Vec3>& values, const std::string dataset_path) {
+	H5::PredType datatype(H5::PredType::NATIVE_DOUBLE);
+	hsize_t n_cols = values.size();
+
+	H5::DataSet& dataset = getExtendibleDataSet(dataset_path, (int)n_cols, 3);
+
+	hsize_t dim_current[3];
+	dataset.getSpace().getSimpleExtentDims(dim_current);
+
+	OPENSIM_THROW_IF(dim_current[1] != n_cols, Exception,
+		"appendDataSetVec3Row: " + dataset_path + " has " +
+		std::to_string(dim_current[1]) + " columns, row has " +
+		std::to_string(n_cols) + ".")
+
+	hsize_t dim_new[3] = { dim_current[0] + 1, n_cols, 3 };
+	dataset.extend(dim_new);
+
+	std::vector<double> data(n_cols * 3);
+	for (int c = 0; c < (int)n_cols; ++c) {
+		for (int k = 0; k < 3; ++k) {
+			data[c * 3 + k] = values(c)(k);
+		}
+	}
+
+	hsize_t offset[3] = { dim_current[0], 0, 0 };
+	hsize_t dim_row[3] = { 1, n_cols, 3 };
+	H5::DataSpace file_space = dataset.getSpace();
+	file_space.selectHyperslab(H5S_SELECT_SET, dim_row, offset);
+	H5::DataSpace mem_space(3, dim_row);
+
+	dataset.write(&data[0], datatype, mem_space, file_space);
+}
+
+void H5FileAdapter::appendDataSetValues(H5::DataSet& dataset,
+	const void* data, hsize_t n, const H5::DataType& mem_type)
+{
+	if (n == 0) return;
+
+	hsize_t offset[1];
+	offset[0] = dataset.getSpace().getSimpleExtentNpoints();
+
+	hsize_t dim_new[1] = { offset[0] + n };
+	dataset.extend(dim_new);
+
+	hsize_t dim_values[1] = { n };
+	H5::DataSpace file_space = dataset.getSpace();
+	file_space.selectHyperslab(H5S_SELECT_SET, dim_values, offset);
+	H5::DataSpace mem_space(1, dim_values);
+
+	dataset.write(data, mem_type, mem_space, file_space);
+}
+
+void H5FileAdapter::appendDataSetRows(const void* data, hsize_t n_rows,
+	int n_cols, const H5::DataType& mem_type, const std::string& dataset_path,
+	const H5::DataType& file_type, int chunk_rows)
+{
+	H5::DataSet& dataset = getExtendibleDataSet(
+		dataset_path, n_cols, 0, file_type, chunk_rows);
+
+	if (n_rows == 0) return;
+
+	int rank = (n_cols == 0) ? 1 : 2;
+	hsize_t dim_current[2] = { 0, 0 };
+	dataset.getSpace().getSimpleExtentDims(dim_current);
+
+	OPENSIM_THROW_IF(rank == 2 && dim_current[1] != (hsize_t)n_cols,
+		Exception, "appendDataSetRows: " + dataset_path + " has " +
+		std::to_string(dim_current[1]) + " columns, not " +
+		std::to_string(n_cols) + ".")
+
+	hsize_t dim_new[2] = { dim_current[0] + n_rows, (hsize_t)n_cols };
+	dataset.extend(dim_new);
+
+	hsize_t offset[2] = { dim_current[0], 0 };
+	hsize_t dim_rows[2] = { n_rows, (hsize_t)n_cols };
+	H5::DataSpace file_space = dataset.getSpace();
+	file_space.selectHyperslab(H5S_SELECT_SET, dim_rows, offset);
+	H5::DataSpace mem_space(rank, dim_rows);
+
+	dataset.write(data, mem_type, mem_space, file_space);
+}
+
+H5::Attribute H5FileAdapter::createAttribute(const std::string& path,
+	const std::string& name, const H5::DataType& datatype,
+	const H5::DataSpace& dataspace)
+{
+	if (_file.childObjType(path) == H5O_TYPE_GROUP) {
+		H5::Group group = _file.openGroup(path);
+		if (group.attrExists(name)) {
+			group.removeAttr(name);
+		}
+		return group.createAttribute(name, datatype, dataspace);
+	}
+
+	H5::DataSet dataset = _file.openDataSet(path);
+	if (dataset.attrExists(name)) {
+		dataset.removeAttr(name);
+	}
+	return dataset.createAttribute(name, datatype, dataspace);
+}
+
+void H5FileAdapter::writeIntArrayAttribute(const std::string& path,
+	const std::string& name, const std::vector<int>& values)
+{
+	hsize_t dim[1] = { values.size() };
+	H5::DataSpace dataspace(1, dim);
+
+	H5::Attribute attribute = createAttribute(
+		path, name, H5::PredType::NATIVE_INT, dataspace);
+	attribute.write(H5::PredType::NATIVE_INT, values.data());
+}
+
+void H5FileAdapter::writeStringAttribute(const std::string& path,
+	const std::string& name, const std::string& value)
+{
+	H5::StrType datatype(H5::PredType::C_S1, value.size());
+	H5::DataSpace dataspace(H5S_SCALAR);
+
+	H5::Attribute attribute = createAttribute(path, name, datatype, dataspace);
+	attribute.write(datatype, value);
+}
+
+void H5FileAdapter::createSparseDataSet(const std::string& group_path,
+	int n_cols, const std::string& precision)
+{
+	H5::PredType value_type = getSparseValueType(precision);
+
+	if (exists(group_path)) {
+		H5::Group group = _file.openGroup(group_path);
+		int file_n_cols;
+		group.openAttribute("n_cols").read(H5::PredType::NATIVE_INT, &file_n_cols);
+
+		OPENSIM_THROW_IF(file_n_cols != n_cols, Exception,
+			"createSparseDataSet: " + group_path + " has " +
+			std::to_string(file_n_cols) + " columns, not " +
+			std::to_string(n_cols) + ".")
+		return;
+	}
+
+	createParentGroups(group_path + "/offsets");
+
+	H5::DataSet& offsets = getExtendibleDataSet(group_path + "/offsets", 0, 0,
+		H5::PredType::NATIVE_LLONG);
+	long long first_offset = 0;
+	appendDataSetValues(offsets, &first_offset, 1, H5::PredType::NATIVE_LLONG);
+
+	getExtendibleDataSet(group_path + "/indices", 0, 0,
+		H5::PredType::NATIVE_INT, sparse_chunk_size);
+	getExtendibleDataSet(group_path + "/values", 0, 0,
+		value_type, sparse_chunk_size);
+	if (precision == "int16") {
+		getExtendibleDataSet(group_path + "/scales", 0);
+	}
+
+	H5::Group group = _file.openGroup(group_path);
+	H5::DataSpace scalar_space(H5S_SCALAR);
+
+	H5::Attribute n_cols_attr = group.createAttribute(
+		"n_cols", H5::PredType::NATIVE_INT, scalar_space);
+	n_cols_attr.write(H5::PredType::NATIVE_INT, &n_cols);
+
+	H5::StrType str_type(H5::PredType::C_S1, precision.size());
+	H5::Attribute precision_attr = group.createAttribute(
+		"precision", str_type, scalar_space);
+	precision_attr.write(str_type, precision);
+}
+
+void H5FileAdapter::appendSparseRows(const SimTK::Matrix& data,
+	const std::string& group_path, const std::string& precision)
+{
+	createSparseDataSet(group_path, data.ncol(), precision);
+
+	H5::DataSet& offsets_dataset = getExtendibleDataSet(
+		group_path + "/offsets", 0, 0, H5::PredType::NATIVE_LLONG);
+	H5::DataSet& indices_dataset = getExtendibleDataSet(
+		group_path + "/indices", 0, 0, H5::PredType::NATIVE_INT,
+		sparse_chunk_size);
+	H5::DataSet& values_dataset = getExtendibleDataSet(
+		group_path + "/values", 0, 0, getSparseValueType(precision),
+		sparse_chunk_size);
+
+	bool quantize = (precision == "int16");
+	long long nnz = indices_dataset.getSpace().getSimpleExtentNpoints();
+
+	std::vector<long long> offsets;
+	std::vector<int> indices;
+	std::vector<double> values;
+	std::vector<short> quantized_values;
+	std::vector<double> scales;
+
+	for (int r = 0; r < data.nrow(); ++r) {
+		double scale = 1.0;
+		if (quantize) {
+			double max_abs = 0.0;
+			for (int c = 0; c < data.ncol(); ++c) {
+				max_abs = std::max(max_abs, std::abs(data(r, c)));
+			}
+			if (max_abs > 0.0) {
+				scale = max_abs / 32767.0;
+			}
+			scales.push_back(scale);
+		}
+
+		for (int c = 0; c < data.ncol(); ++c) {
+			double value = data(r, c);
+			if (value == 0.0) continue;
+
+			indices.push_back(c);
+			if (quantize) {
+				quantized_values.push_back((short)std::lround(value / scale));
+			}
+			else {
+				values.push_back(value);
+			}
+		}
+		offsets.push_back(nnz + (long long)indices.size());
+	}
+
+	appendDataSetValues(offsets_dataset, offsets.data(), offsets.size(),
+		H5::PredType::NATIVE_LLONG);
+	appendDataSetValues(indices_dataset, indices.data(), indices.size(),
+		H5::PredType::NATIVE_INT);
+
+	if (quantize) {
+		appendDataSetValues(values_dataset, quantized_values.data(),
+			quantized_values.size(), H5::PredType::NATIVE_SHORT);
+
+		H5::DataSet& scales_dataset = getExtendibleDataSet(
+			group_path + "/scales", 0);
+		appendDataSetValues(scales_dataset, scales.data(), scales.size(),
+			H5::PredType::NATIVE_DOUBLE);
+	}
+	else {
+		appendDataSetValues(values_dataset, values.data(), values.size(),
+			H5::PredType::NATIVE_DOUBLE);
+	}
+}
+
+void H5FileAdapter::writeSparseDataSetSimTKMatrix(const SimTK::Matrix& data_matrix,
+	const std::string& group_path, const std::string& precision)
+{
+	appendSparseRows(data_matrix, group_path, precision);
+}
+
+void H5FileAdapter::appendSparseDataSetRow(const SimTK::Vector& values,
+	const std::string& group_path, const std::string& precision)
+{
+	SimTK::Matrix row(1, values.size());
+	row.updRow(0) = ~values;
+	appendSparseRows(row, group_path, precision);
+}
+
+void H5FileAdapter::readDataSetRange(const std::string& dataset_path,
+	hsize_t start, hsize_t count, const H5::DataType& mem_type, void* data)
+{
+	if (count == 0) return;
+
+	H5::DataSet dataset = _file.openDataSet(dataset_path);
+
+	hsize_t offset[1] = { start };
+	hsize_t dim_values[1] = { count };
+	H5::DataSpace file_space = dataset.getSpace();
+	file_space.selectHyperslab(H5S_SELECT_SET, dim_values, offset);
+	H5::DataSpace mem_space(1, dim_values);
+
+	dataset.read(data, mem_type, mem_space, file_space);
+}
+
+SimTK::Matrix H5FileAdapter::readSparseDataSetSimTKMatrix(const std::string& group_path)
+{
+	int n_cols;
+	_file.openGroup(group_path).openAttribute("n_cols").read(
+		H5::PredType::NATIVE_INT, &n_cols);
+
+	int n_rows = getDataSetSize(group_path + "/offsets") - 1;
+	SimTK::Matrix data(n_rows, n_cols, 0.0);
+	if (n_rows <= 0) return data;
+
+	std::vector<long long> offsets(n_rows + 1);
+	readDataSetRange(group_path + "/offsets", 0, offsets.size(),
+		H5::PredType::NATIVE_LLONG, offsets.data());
+
+	hsize_t nnz = offsets[n_rows];
+	std::vector<int> indices(nnz);
+	std::vector<double> values(nnz);
+	readDataSetRange(group_path + "/indices", 0, nnz,
+		H5::PredType::NATIVE_INT, indices.data());
+	readDataSetRange(group_path + "/values", 0, nnz,
+		H5::PredType::NATIVE_DOUBLE, values.data());
+
+	std::vector<double> scales(n_rows, 1.0);
+	if (exists(group_path + "/scales")) {
+		readDataSetRange(group_path + "/scales", 0, n_rows,
+			H5::PredType::NATIVE_DOUBLE, scales.data());
+	}
+
+	for (int r = 0; r < n_rows; ++r) {
+		for (long long k = offsets[r]; k < offsets[r + 1]; ++k) {
+			data(r, indices[k]) = values[k] * scales[r];
+		}
+	}
+	return data;
+}
+
+SimTK::Vector H5FileAdapter::readSparseDataSetRow(const std::string& group_path, int row)
+{
+	int n_cols;
+	_file.openGroup(group_path).openAttribute("n_cols").read(
+		H5::PredType::NATIVE_INT, &n_cols);
+
+	int n_rows = getDataSetSize(group_path + "/offsets") - 1;
+	OPENSIM_THROW_IF(row < 0 || row >= n_rows, IndexOutOfRange,
+		(size_t)row, 0, (size_t)std::max(n_rows - 1, 0))
+
+	long long offsets[2];
+	readDataSetRange(group_path + "/offsets", row, 2,
+		H5::PredType::NATIVE_LLONG, offsets);
+
+	hsize_t nnz = offsets[1] - offsets[0];
+	std::vector<int> indices(nnz);
+	std::vector<double> values(nnz);
+	readDataSetRange(group_path + "/indices", offsets[0], nnz,
+		H5::PredType::NATIVE_INT, indices.data());
+	readDataSetRange(group_path + "/values", offsets[0], nnz,
+		H5::PredType::NATIVE_DOUBLE, values.data());
+
+	double scale = 1.0;
+	if (exists(group_path + "/scales")) {
+		readDataSetRange(group_path + "/scales", row, 1,
+			H5::PredType::NATIVE_DOUBLE, &scale);
+	}
+
+	SimTK::Vector data(n_cols, 0.0);
+	for (hsize_t k = 0; k < nnz; ++k) {
+		data(indices[k]) = values[k] * scale;
+	}
+	return data;
+}
+
+void H5FileAdapter::appendDataSetRow(const SimTK::RowVector& row, std::vector<std::string> column_dataset_paths) {
+	for (int i = 0; i < row.size(); ++i) {
+		appendDataSetValue(row(i), column_dataset_paths[i]);
+	}
+}
+
+int H5FileAdapter::getDataSetSize(const std::string dataset_path) {
+	if (!exists(dataset_path)) {
+		return 0;
+	}
+	H5::DataSet dataset = _file.openDataSet(dataset_path);
+	return (int)dataset.getSpace().getSimpleExtentNpoints();
+}
+
+void H5FileAdapter::resizeDataSet(const std::string dataset_path, int size) {
+	H5::DataSet dataset = _file.openDataSet(dataset_path);
+
+	std::vector<hsize_t> dim_data(dataset.getSpace().getSimpleExtentNdims());
+	dataset.getSpace().getSimpleExtentDims(&dim_data[0]);
+	dim_data[0] = size;
+	dataset.extend(&dim_data[0]);
+}
+
+SimTK::Vector H5FileAdapter::readDataSetSimTKVector(const std::string dataset_path) {
+	H5::DataSet dataset = _file.openDataSet(dataset_path);
+	H5::PredType datatype(H5::PredType::NATIVE_DOUBLE);
+
+	int size = (int)dataset.getSpace().getSimpleExtentNpoints();
+	SimTK::Vector data_vector(size, 0.0);
+
+	if (size == 0) {
+		return data_vector;
+	}
+
+	//Allocate space for data
+	double* data = (double*)malloc(size * sizeof(double));
+
+	dataset.read(&data[0], datatype);
+
+	for (int r = 0; r < size; ++r) {
+		data_vector(r) = data[r];
+	}
+
+	//Free dynamically allocated memory
+	free(data);
+
+	return data_vector;
+}
+
+std::vector<std::string> H5FileAdapter::readStringArrayAttribute(
+	const std::string& dataset_path, const std::string& name)
+{
+	H5::Attribute attribute = _file.openDataSet(dataset_path).openAttribute(name);
+	H5::DataSpace dataspace = attribute.getSpace();
+	H5::StrType datatype(H5::PredType::C_S1, H5T_VARIABLE);
+
+	std::vector<char*> c_values(dataspace.getSimpleExtentNpoints());
+	std::vector<std::string> values;
+	if (c_values.empty()) return values;
+
+	attribute.read(datatype, &c_values[0]);
+
+	for (char* c_value : c_values) {
+		values.push_back(c_value ? c_value : "");
+	}
+
+	//The strings are allocated by the HDF5 library
+	H5Dvlen_reclaim(datatype.getId(), dataspace.getId(), H5P_DEFAULT,
+		&c_values[0]);
+
+	return values;
+}
+
+H5DataSetView H5FileAdapter::openDataSetView(const std::string& path)
+{
+	OPENSIM_THROW_IF(!exists(path), Exception,
+		"H5FileAdapter: " + path + " does not exist.")
+
+	return H5DataSetView(_file, path);
+}
+
+bool H5FileAdapter::isGroup(const std::string& path)
+{
+	return path == "/" || _file.childObjType(path) == H5O_TYPE_GROUP;
+}
+
+bool H5FileAdapter::isSparseDataSet(const std::string& group_path)
+{
+	return isGroup(group_path) && exists(group_path + "/offsets") &&
+		_file.openGroup(group_path).attrExists("n_cols");
+}
+
+std::vector<std::string> H5FileAdapter::getChildNames(const std::string& group_path)
+{
+	H5::Group group = _file.openGroup(group_path);
+
+	std::vector<std::string> names;
+	for (hsize_t i = 0; i < group.getNumObjs(); ++i) {
+		names.push_back(group.getObjnameByIdx(i));
+	}
+	return names;
+}
+
+std::vector<hsize_t> H5FileAdapter::getDataSetDims(const std::string& dataset_path)
+{
+	H5::DataSpace dataspace = _file.openDataSet(dataset_path).getSpace();
+
+	std::vector<hsize_t> dims(dataspace.getSimpleExtentNdims());
+	if (!dims.empty()) {
+		dataspace.getSimpleExtentDims(&dims[0]);
+	}
+	return dims;
+}
+
+std::vector<double> H5FileAdapter::readTimeVector()
+{
+	OPENSIM_THROW_IF(!exists("/time"), Exception,
+		"H5FileAdapter: the file has no /time dataset, time series tables "
+		"cannot be read.")
+
+	std::vector<double> time(getDataSetSize("/time"));
+	readDataSetRange("/time", 0, time.size(), H5::PredType::NATIVE_DOUBLE,
+		time.data());
+	return time;
+}
+
+TimeSeriesTable H5FileAdapter::readTimeSeriesTable(const std::string& path)
+{
+	std::vector<double> time = readTimeVector();
+	hsize_t n_frames = time.size();
+
+	OPENSIM_THROW_IF(!exists(path), Exception,
+		"H5FileAdapter: " + path + " does not exist.")
+
+	std::vector<std::string> labels;
+	SimTK::Matrix data;
+
+	if (isGroup(path) && !isSparseDataSet(path)) {
+		//Each 1D dataset with a value per frame is a column
+		std::vector<std::string> paths;
+		for (std::string name : getChildNames(path)) {
+			std::string child_path = getChildPath(path, name);
+			if (child_path == "/time" || isGroup(child_path)) continue;
+
+			std::vector<hsize_t> dims = getDataSetDims(child_path);
+			if (dims.size() == 1 && dims[0] == n_frames) {
+				labels.push_back(name);
+				paths.push_back(child_path);
+			}
+		}
+
+		data.resize((int)n_frames, (int)labels.size());
+		for (int c = 0; c < (int)paths.size(); ++c) {
+			data(c) = readDataSetSimTKVector(paths[c]);
+		}
+	}
+	else {
+		H5DataSetView view = openDataSetView(path);
+
+		OPENSIM_THROW_IF(view.getNumRows() != (int)n_frames, Exception,
+			"H5FileAdapter: " + path + " has " + 
+			std::to_string(view.getNumRows()) + " rows, /time has " + 
+			std::to_string(n_frames) + ".")
+
+		data = view.readRows(0, (int)n_frames);
+
+		if (!view.isSparse() &&
+			_file.openDataSet(path).attrExists("components")) {
+			labels = readStringArrayAttribute(path, "components");
+		}
+		else if (data.ncol() == 1) {
+			labels.push_back(split_string(path, "/").back());
+		}
+		else {
+			for (int c = 0; c < data.ncol(); ++c) {
+				labels.push_back(std::to_string(c));
+			}
+		}
+	}
+	return TimeSeriesTable(time, data, labels);
+}
+
+TimeSeriesTableVec3 H5FileAdapter::readTimeSeriesTableVec3(const std::string& path)
+{
+	std::vector<double> time = readTimeVector();
+	hsize_t n_frames = time.size();
+
+	OPENSIM_THROW_IF(!exists(path), Exception,
+		"H5FileAdapter: " + path + " does not exist.")
+
+	std::vector<std::string> labels;
+	std::vector<std::string> paths;
+
+	if (isGroup(path)) {
+		//Each (frames x 3) dataset is a column
+		for (std::string name : getChildNames(path)) {
+			std::string child_path = getChildPath(path, name);
+			if (isGroup(child_path)) continue;
+
+			std::vector<hsize_t> dims = getDataSetDims(child_path);
+			if (dims.size() == 2 && dims[0] == n_frames && dims[1] == 3 &&
+				!_file.openDataSet(child_path).attrExists("components")) {
+				labels.push_back(name);
+				paths.push_back(child_path);
+			}
+		}
+	}
+	else {
+		paths.push_back(path);
+	}
+
+	std::vector<hsize_t> dims = paths.empty() ?
+		std::vector<hsize_t>{ n_frames, 3 } : getDataSetDims(paths[0]);
+	bool packed = (dims.size() == 3);
+
+	OPENSIM_THROW_IF(dims[0] != n_frames || dims.back() != 3, Exception,
+		"H5FileAdapter: " + path + " is not a (frames x 3) or "
+		"(frames x components x 3) dataset with a row per value of /time.")
+
+	int n_cols = packed ? (int)dims[1] : (int)paths.size();
+	SimTK::Matrix_<SimTK::Vec3> data((int)n_frames, n_cols);
+	std::vector<double> values;
+
+	if (packed) {
+		values.resize(n_frames * n_cols * 3);
+		if (!values.empty()) {
+			_file.openDataSet(path).read(&values[0], H5::PredType::NATIVE_DOUBLE);
+		}
+
+		for (int r = 0; r < (int)n_frames; ++r) {
+			for (int c = 0; c < n_cols; ++c) {
+				for (int k = 0; k < 3; ++k) {
+					data(r, c)(k) = values[((size_t)r * n_cols + c) * 3 + k];
+				}
+			}
+		}
+
+		if (_file.openDataSet(path).attrExists("components")) {
+			labels = readStringArrayAttribute(path, "components");
+		}
+		else {
+			for (int c = 0; c < n_cols; ++c) {
+				labels.push_back(std::to_string(c));
+			}
+		}
+	}
+	else {
+		values.resize(n_frames * 3);
+		for (int c = 0; c < n_cols; ++c) {
+			if (!values.empty()) {
+				_file.openDataSet(paths[c]).read(&values[0],
+					H5::PredType::NATIVE_DOUBLE);
+			}
+
+			for (int r = 0; r < (int)n_frames; ++r) {
+				data(r, c) = SimTK::Vec3(values[3 * r], values[3 * r + 1],
+					values[3 * r + 2]);
+			}
+		}
+
+		if (!isGroup(path)) {
+			labels.push_back(split_string(path, "/").back());
+		}
+	}
+	return TimeSeriesTableVec3(time, data, labels);
+}
+
+void H5FileAdapter::readGroupTables(const std::string& group_path,
+	int n_frames, OutputTables& tables)
+{
+	bool has_values = false;
+	bool has_vec3 = false;
+
+	for (std::string name : getChildNames(group_path)) {
+		std::string path = getChildPath(group_path, name);
+		if (path == "/time") continue;
+
+		if (isGroup(path)) {
+			//Contact mesh geometry (one row per triangle) is not a time series
+			if (name == "geometry") continue;
+
+			if (!isSparseDataSet(path)) {
+				readGroupTables(path, n_frames, tables);
+			}
+			else if (getDataSetSize(path + "/offsets") == n_frames + 1) {
+				tables[path] = std::make_shared<TimeSeriesTable>(
+					readTimeSeriesTable(path));
+			}
+			continue;
+		}
+
+		//Datasets that do not have a row per frame (e.g. checkpoints) are
+		//not time series
+		std::vector<hsize_t> dims = getDataSetDims(path);
+		if (dims.empty() || dims[0] != (hsize_t)n_frames) continue;
+
+		bool packed = _file.openDataSet(path).attrExists("components");
+
+		if (dims.size() == 1) {
+			has_values = true;
+		}
+		else if (dims.size() == 2 && dims[1] == 3 && !packed) {
+			has_vec3 = true;
+		}
+		else if (dims.size() == 2) {
+			tables[path] = std::make_shared<TimeSeriesTable>(
+				readTimeSeriesTable(path));
+		}
+		else if (dims.size() == 3 && dims[2] == 3) {
+			tables[path] = std::make_shared<TimeSeriesTableVec3>(
+				readTimeSeriesTableVec3(path));
+		}
+	}
+
+	if (has_values) {
+		tables[group_path] = std::make_shared<TimeSeriesTable>(
+			readTimeSeriesTable(group_path));
+	}
+	if (has_vec3) {
+		tables[group_path + "_vec3"] = std::make_shared<TimeSeriesTableVec3>(
+			readTimeSeriesTableVec3(group_path));
+	}
+}
+
 H5FileAdapter::OutputTables H5FileAdapter::extendRead(const std::string& fileName) const 
 {
     OutputTables output_tables{};
+
+    //Reading opens the file, which is not const
+    H5FileAdapter reader;
+    reader.openReadOnly(fileName);
+
+    if (reader.exists("/time")) {
+        int n_frames = reader.getDataSetSize("/time");
+        reader.readGroupTables("/", n_frames, output_tables);
+    }
+    reader.close();
+
     return output_tables;
 };
 
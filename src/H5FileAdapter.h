@@ -26,6 +26,17 @@ data in a compressed file size and can be more quickly written and read than
 text file formats such as .sto or .mot. The file has a hierarchical structure
 of groups 
 
+Files with a /time dataset are read back with read() (or 
+readTimeSeriesTable() and readTimeSeriesTableVec3() after openReadOnly()).
+Each group of 1D datasets with a value per frame is read to a 
+TimeSeriesTable, the dataset names are the column labels. The (frames x 3)
+datasets of a group are read to a TimeSeriesTableVec3 with the key
+group path + "_vec3". Every other 2D (e.g. per triangle) or packed dataset
+and sparse (CSR) group is read to its own table. Large per triangle 
+datasets can instead be read a few frames or triangles at a time with 
+openDataSetView(). The contact mesh geometry groups (see 
+ContactStatisticsTool) are not time series and are skipped.
+
 @author Colin Smith
 
 */
@@ -35,8 +46,10 @@ of groups
 #include "H5Cpp.h"
 #include "hdf5_hl.h"
 #include "osimPluginDLL.h"
+#include "H5DataSetView.h"
 #include "OpenSim/Common/TimeSeriesTable.h"
 #include "OpenSim/Common/Array.h"
+#include <map>
 
 namespace OpenSim {
 
@@ -54,7 +67,15 @@ namespace OpenSim {
 
 
 	   void open(const std::string& file_name);
+	   void open(const std::string& file_name, bool append);
+
+	   /** Open an existing file without write access, to read results.*/
+	   void openReadOnly(const std::string& file_name);
 	   void close();
+	   void flush();
+
+	   bool exists(const std::string& path);
+	   void remove(const std::string& path);
 
 	   void createGroup(const std::string& new_group);
 
@@ -76,6 +97,57 @@ namespace OpenSim {
 
 	   void writeTimeDataSet(const Array<double>& time);
 
+	   /** Append a value to the end of a 1D extendible dataset, the dataset
+	   is created (chunked with unlimited size) if it does not exist.*/
+	   void appendDataSetValue(double value, const std::string dataset_path);
+
+	   /** Append each element of row to the corresponding 1D extendible 
+	   dataset in column_dataset_paths.*/
+	   void appendDataSetRow(const SimTK::RowVector& row, std::vector<std::string> column_dataset_paths);
+
+	   /** Append values as a new row of a 2D extendible dataset (rows x 
+	   values.size()), the dataset is created if it does not exist.*/
+	   void appendDataSetVectorRow(const SimTK::Vector& values, const std::string dataset_path);
+
+	   /** Number of rows per chunk of extendible datasets created after this
+	   is called.*/
+	   void setChunkSize(int chunk_size);
+
+	   /** gzip compression level (0-9, 0 is no compression) of extendible 
+	   datasets created after this is called.*/
+	   void setCompressionLevel(int compression_level);
+
+	   /** Apply the byte shuffle filter before compression to extendible
+	   datasets created after this is called. Shuffling groups the bytes of
+	   the doubles by significance, which usually compresses much better.*/
+	   void setShuffle(bool shuffle);
+
+	   /** Create an empty extendible dataset that values are appended to.
+	   If n_cols is 0 the dataset is 1D, otherwise it is 2D (rows x n_cols).
+	   Does nothing if the dataset already exists.*/
+	   void createExtendibleDataSet(const std::string& dataset_path, int n_cols);
+
+	   /** Create an empty 3D extendible dataset (rows x n_cols x 3) that 
+	   Vec3 rows are appended to.*/
+	   void createExtendibleDataSetVec3(const std::string& dataset_path, int n_cols);
+
+	   /** Create all groups in path that do not exist, excluding the last
+	   level.*/
+	   void createParentGroups(const std::string& path);
+
+	   int getDataSetSize(const std::string dataset_path);
+
+	   /** Change the number of rows of an extendible dataset, used to
+	   discard rows appended after the last checkpoint.*/
+	   void resizeDataSet(const std::string dataset_path, int size);
+
+	   SimTK::Vector readDataSetSimTKVector(const std::string dataset_path);
+
+	   /** Names of the groups and datasets in group_path.*/
+	   std::vector<std::string> getChildNames(const std::string& group_path);
+
+	   bool isGroup(const std::string& path);
+
 	   void writeStatesDataSet(const TimeSeriesTable& table);
 
 	   void writeComponentGroupDataSet(std::string group_name, std::vector<std::string> names,
@@ -92,6 +164,107 @@ namespace OpenSim {
            std::vector<std::string> output_vector_names,
            std::vector<std::vector<SimTK::Matrix>> output_vector_values);
 
+       /** Packed layout of writeComponentGroupDataSet(), one 2D dataset 
+       (frames x components) per output (group_name/output) instead of one 
+       dataset per component and output. The component names are written 
+       to the "components" attribute of each dataset in column order.*/
+       void writePackedComponentGroupDataSet(std::string group_name,
+           std::vector<std::string> names,
+           std::vector<std::string> output_double_names,
+           std::vector<SimTK::Matrix> output_double_values);
+
+       /** Packed layout of writeComponentGroupDataSetVec3(), one 3D dataset 
+       (frames x components x 3) per output.*/
+       void writePackedComponentGroupDataSetVec3(std::string group_name,
+           std::vector<std::string> names,
+           std::vector<std::string> output_vec3_names,
+           std::vector<SimTK::Matrix_<SimTK::Vec3>> output_vec3_values);
+
+       /** Append values as a new frame of a 3D extendible dataset 
+       (frames x values.size() x 3), the dataset is created if it does not
+       exist.*/
+       void appendDataSetVec3Row(const SimTK::Vector_<SimTK::Vec3>& values, const std::string dataset_path);
+
+       /** Sparse (CSR) storage of a matrix whose rows are mostly zero, such
+       as the per triangle pressure and proximity of a contact mesh. The 
+       matrix is written to the group group_path as:
+
+       offsets (rows + 1) : the nonzero values of row r are at [offsets[r], offsets[r+1])
+       indices (nonzeros) : column of each nonzero value
+       values (nonzeros) : nonzero values in precision
+       scales (rows) : only for int16 precision, value = values * scales[r]
+
+       The number of columns and the precision are stored in the "n_cols" and
+       "precision" attributes of the group. precision is "double", "float" 
+       or "int16" (each row is quantized to 16 bit integers scaled by the 
+       max absolute value of the row).*/
+       void writeSparseDataSetSimTKMatrix(const SimTK::Matrix& data_matrix,
+           const std::string& group_path, const std::string& precision);
+
+       /** Append values as a new row of a sparse (CSR) dataset, the group is
+       created if it does not exist.*/
+       void appendSparseDataSetRow(const SimTK::Vector& values,
+           const std::string& group_path, const std::string& precision);
+
+       /** Create an empty sparse (CSR) dataset with n_cols columns. Does 
+       nothing if the group already exists.*/
+       void createSparseDataSet(const std::string& group_path, int n_cols,
+           const std::string& precision);
+
+       /** Sparse layout of writeComponentGroupDataSetVector(), each output 
+       is written with writeSparseDataSetSimTKMatrix().*/
+       void writeSparseComponentGroupDataSetVector(std::string group_name,
+           std::vector<std::string> names,
+           std::vector<std::string> output_vector_names,
+           std::vector<std::vector<SimTK::Matrix>> output_vector_values,
+           const std::string& precision);
+
+       /** Densify a sparse (CSR) dataset to a rows x n_cols matrix.*/
+       SimTK::Matrix readSparseDataSetSimTKMatrix(const std::string& group_path);
+
+       /** Densify a single row of a sparse (CSR) dataset, only that row is 
+       read from the file.*/
+       SimTK::Vector readSparseDataSetRow(const std::string& group_path, int row);
+
+       /** Append n_rows rows to an extendible dataset of file_type, the
+       dataset is created if it does not exist. If n_cols is 0 the dataset
+       is 1D, otherwise it is 2D (rows x n_cols). data holds n_rows x n_cols
+       values of mem_type. If chunk_rows is 0, the chunk size set by
+       setChunkSize() is used.*/
+       void appendDataSetRows(const void* data, hsize_t n_rows, int n_cols,
+           const H5::DataType& mem_type, const std::string& dataset_path,
+           const H5::DataType& file_type, int chunk_rows = 0);
+
+       /** Write a 1D integer attribute to a group or dataset, an existing
+       attribute with the same name is replaced.*/
+       void writeIntArrayAttribute(const std::string& path,
+           const std::string& name, const std::vector<int>& values);
+
+       /** Write a fixed length string attribute to a group or dataset, an
+       existing attribute with the same name is replaced.*/
+       void writeStringAttribute(const std::string& path,
+           const std::string& name, const std::string& value);
+
+       /** Write a 1D variable length string attribute, an existing
+       attribute with the same name is replaced.*/
+       void writeStringArrayAttribute(const std::string& dataset_path,
+           const std::string& name, const std::vector<std::string>& values);
+
+       std::vector<std::string> readStringArrayAttribute(
+           const std::string& dataset_path, const std::string& name);
+
+       /** Lazy view of the 1D or 2D dataset or sparse (CSR) group at path,
+       the frames and columns are only read when they are requested.*/
+       H5DataSetView openDataSetView(const std::string& path);
+
+       /** Read a group of 1D datasets (one column per dataset), a 1D or 2D
+       dataset or a sparse (CSR) group with a row per value of /time.*/
+       TimeSeriesTable readTimeSeriesTable(const std::string& path);
+
+       /** Read a group of (frames x 3) datasets (one column per dataset) or
+       a packed (frames x components x 3) dataset.*/
+       TimeSeriesTableVec3 readTimeSeriesTableVec3(const std::string& path);
+
     protected:
         OutputTables extendRead(const std::string& fileName) const override;
 
@@ -99,10 +272,47 @@ namespace OpenSim {
     private:
 
 
+		H5::DataSet& getExtendibleDataSet(const std::string& dataset_path,
+			int n_cols, int n_depth = 0,
+			const H5::DataType& datatype = H5::PredType::NATIVE_DOUBLE,
+			int chunk_rows = 0);
+
+		/** Create an attribute on the group or dataset at path, an existing
+		attribute with the same name is removed first.*/
+		H5::Attribute createAttribute(const std::string& path,
+			const std::string& name, const H5::DataType& datatype,
+			const H5::DataSpace& dataspace);
+
+		/** Append n values to the end of a 1D extendible dataset.*/
+		void appendDataSetValues(H5::DataSet& dataset, const void* data,
+			hsize_t n, const H5::DataType& mem_type);
+
+		/** Read count values starting at start from a 1D dataset.*/
+		void readDataSetRange(const std::string& dataset_path, hsize_t start,
+			hsize_t count, const H5::DataType& mem_type, void* data);
+
+		void appendSparseRows(const SimTK::Matrix& data,
+			const std::string& group_path, const std::string& precision);
+
+		bool isSparseDataSet(const std::string& group_path);
+		std::vector<hsize_t> getDataSetDims(const std::string& dataset_path);
+		std::vector<double> readTimeVector();
+
+		/** Add a table for each time series in group_path and its
+		subgroups to tables.*/
+		void readGroupTables(const std::string& group_path, int n_frames,
+			OutputTables& tables);
+
 	//Data
 	private:
 		H5::H5File _file;
 		bool _time_is_empty;
+		int _chunk_size;
+		int _compression_level;
+		bool _shuffle;
+
+		//Open extendible datasets, so appending does not reopen them
+		std::map<std::string, H5::DataSet> _extendible_datasets;
 
     };
 
@@ -17,12 +17,14 @@
 #include <OpenSim/Simulation/Model/Model.h>
 #include "JointMechanicsTool.h"
 #include "VTPFileAdapter.h"
+#include "VTPStreamWriter.h"
+#include "VTKHDFWriter.h"
+#include "ContactStatisticsTool.h"
 #include "H5Cpp.h"
 #include "hdf5_hl.h"
 #include "Smith2018ArticularContactForce.h"
 #include "HelperFunctions.h"
 #include "Blankevoort1991Ligament.h"
-#include <OpenSim/Analyses/StatesReporter.h>
 #include <OpenSim/Common/STOFileAdapter.h>
 #include <OpenSim/Common/GCVSpline.h>
 #include <OpenSim/Common/CSVFileAdapter.h>
@@ -96,9 +98,18 @@ void JointMechanicsTool::constructProperties()
     
     constructProperty_write_vtp_files(true);
     constructProperty_vtp_file_format("binary");
+    constructProperty_vtp_compression_level(0);
     constructProperty_write_h5_file(true);
     constructProperty_h5_states_data(true);
     constructProperty_h5_kinematics_data(true);
+    constructProperty_stream_h5_file(false);
+    constructProperty_h5_compression_level(4);
+    constructProperty_h5_packed_layout(false);
+    constructProperty_h5_contact_map_format("dense");
+    constructProperty_h5_contact_map_precision("double");
+    constructProperty_geometry_only_report(false);
+    constructProperty_num_threads(1);
+    constructProperty_num_output_threads(0);
 
     constructProperty_AnalysisSet(AnalysisSet());
 }
@@ -111,9 +122,6 @@ void JointMechanicsTool::setModel(Model& aModel)
 
 
 void JointMechanicsTool::run() {
-    //Set the max number of points a ligament or muscle path can contain
-    _max_path_points = 100;
-
     //Make results directory
     int makeDir_out = IO::makeDir(get_results_directory());
     if (errno == ENOENT && makeDir_out == -1) {
@@ -126,40 +134,76 @@ void JointMechanicsTool::run() {
         OPENSIM_THROW(Exception, "No model was set in JointMechanicsTool");
     }
 
+    OPENSIM_THROW_IF(get_vtp_file_format() != "ascii" &&
+        get_vtp_file_format() != "binary" &&
+        get_vtp_file_format() != "appended" &&
+        get_vtp_file_format() != "vtkhdf", Exception,
+        "vtp_file_format must be 'ascii', 'binary', 'appended' or 'vtkhdf', "
+        "not '" + get_vtp_file_format() + "'.")
+
+    OPENSIM_THROW_IF(get_h5_contact_map_format() != "dense" &&
+        get_h5_contact_map_format() != "sparse", Exception,
+        "h5_contact_map_format must be 'dense' or 'sparse', not '" +
+        get_h5_contact_map_format() + "'.")
+
+    OPENSIM_THROW_IF(get_h5_contact_map_precision() != "double" &&
+        get_h5_contact_map_precision() != "float" &&
+        get_h5_contact_map_precision() != "int16", Exception,
+        "h5_contact_map_precision must be 'double', 'float' or 'int16', "
+        "not '" + get_h5_contact_map_precision() + "'.")
+
     SimTK::State state = _model->initSystem();
 
     readStatesFromFile();
 
+    int n_threads = get_num_threads();
+    if (n_threads < 1) {
+        n_threads = SimTK::ParallelExecutor::getNumProcessors();
+    }
+    n_threads = std::min(n_threads, _n_frames);
+
+    if (n_threads > 1 && get_write_h5_file() && get_stream_h5_file()) {
+        std::cout << "WARNING: num_threads is ignored because "
+            "stream_h5_file is true, the frames are streamed in order." 
+            << std::endl;
+        n_threads = 1;
+    }
+
+    //Copy the model for each block before the analyses are added
+    std::vector<Model> block_models;
+    if (n_threads > 1) {
+        for (int b = 0; b < n_threads; ++b) {
+            block_models.push_back(*_model);
+        }
+    }
+
+    _output_pipeline = std::make_shared<OutputPipeline>(
+        get_num_output_threads());
+
     initialize(state);
 
+    //The analyses are performed in order after the frames are recorded
+    int n_frames_serial = _n_frames;
+    if (n_threads > 1) {
+        recordFramesInParallel(block_models);
+
+        if (_model->getAnalysisSet().getSize() == 0) {
+            n_frames_serial = 0;
+        }
+    }
+
     //loop over each frame
-    for (int i = 0; i < _n_frames; ++i) {
+    for (int i = 0; i < n_frames_serial; ++i) {
         
-        //Set Time
-        state.setTime(_time[i]);
+        //Set Time, Qs, Us and Muscle States
+        setFrameState(*_model, state, i);
 
-        std::cout << "Time: " << _time[i] << std::endl;
-
-        //Set Qs and Us
-        int nCoord = 0;
-        for (const Coordinate& coord : _model->getComponentList<Coordinate>()) {
-            coord.setValue(state, _q_matrix(i, nCoord));
-            coord.setSpeedValue(state, _u_matrix(i, nCoord));
-            nCoord++;
-        }
+        //Record Values
+        if (n_threads == 1) {
+            std::cout << "Time: " << _time[i] << std::endl;
 
-        //Set Muscle States
-        if(!_muscle_paths.empty()){
-            int nMsl = 0;
-            for (const Muscle& msl : _model->updComponentList<Muscle>()) {
-                for (int j = 0; j < _muscle_state_names[nMsl].size(); ++j) {
-                    msl.setStateVariableValue(state, _muscle_state_names[nMsl][j], _muscle_state_data[nMsl][j][i]);
-                }
-                nMsl++;
-            }
+            record(*_model, state, i);
         }
-        //Record Values
-        record(state,i);
 
         //Perform analyses
         if (i == 0) {
@@ -170,6 +214,125 @@ void JointMechanicsTool::run() {
         }
     }
     printResults(get_results_file_basename(), get_results_directory());
+
+    _output_pipeline.reset();
+}
+
+void JointMechanicsTool::setFrameState(const Model& model,
+    SimTK::State& state, int frame_num) const
+{
+    //Set Time
+    state.setTime(_time[frame_num]);
+
+    //Set Qs and Us
+    int nCoord = 0;
+    for (const Coordinate& coord : model.getComponentList<Coordinate>()) {
+        coord.setValue(state, _q_matrix(frame_num, nCoord));
+        coord.setSpeedValue(state, _u_matrix(frame_num, nCoord));
+        nCoord++;
+    }
+
+    //Set Muscle States
+    if(!_muscle_paths.empty()){
+        int nMsl = 0;
+        for (const Muscle& msl : model.getComponentList<Muscle>()) {
+            for (int j = 0; j < _muscle_state_names[nMsl].size(); ++j) {
+                msl.setStateVariableValue(state, _muscle_state_names[nMsl][j],
+                    _muscle_state_data[nMsl][j][frame_num]);
+            }
+            nMsl++;
+        }
+    }
+}
+
+namespace OpenSim {
+
+/**
+Records a contiguous block of frames with the block's own model copy. The
+frames of a block are recorded in order with a single State, so the contact
+search of each frame is warm started from the previous frame in the block.
+The results are written directly into the (preallocated) rows of the output
+storage of each frame.
+*/
+class JointMechanicsFrameBlockTask : public SimTK::ParallelExecutor::Task {
+public:
+    JointMechanicsFrameBlockTask(JointMechanicsTool& tool,
+        std::vector<Model>& models, std::vector<SimTK::State>& states,
+        const std::vector<int>& block_start,
+        std::vector<std::string>& errors) :
+        _tool(tool), _models(models), _states(states),
+        _block_start(block_start), _errors(errors) {}
+
+    void execute(int index) override {
+        try {
+            const Model& model = _models[index];
+            SimTK::State& s = _states[index];
+
+            for (int i = _block_start[index];
+                i < _block_start[index + 1]; ++i) {
+                _tool.setFrameState(model, s, i);
+                _tool.record(model, s, i);
+            }
+        }
+        catch (const std::exception& x) {
+            _errors[index] = x.what();
+        }
+    }
+
+private:
+    JointMechanicsTool& _tool;
+    std::vector<Model>& _models;
+    std::vector<SimTK::State>& _states;
+    const std::vector<int>& _block_start;
+    std::vector<std::string>& _errors;
+};
+
+} // namespace OpenSim
+
+void JointMechanicsTool::recordFramesInParallel(
+    std::vector<Model>& block_models)
+{
+    int n_blocks = (int)block_models.size();
+
+    std::vector<int> block_start(n_blocks + 1);
+    for (int b = 0; b <= n_blocks; ++b) {
+        block_start[b] = (b * _n_frames) / n_blocks;
+    }
+
+    //The contact meshes are cached, so the copies share the mesh geometry.
+    //Each block State gets the same modeling options as the serial State.
+    std::vector<SimTK::State> block_states;
+    for (Model& model : block_models) {
+        block_states.push_back(model.initSystem());
+        setContactModelingOptions(model, block_states.back());
+    }
+
+    std::cout << "Recording " << _n_frames << " frames in " << n_blocks <<
+        " blocks using " << n_blocks << " threads." << std::endl;
+
+    std::vector<std::string> errors(n_blocks);
+
+    JointMechanicsFrameBlockTask task(
+        *this, block_models, block_states, block_start, errors);
+
+    SimTK::ParallelExecutor executor(n_blocks);
+    executor.execute(task, n_blocks);
+
+    for (int b = 0; b < n_blocks; ++b) {
+        OPENSIM_THROW_IF(!errors[b].empty(), Exception,
+            "Recording frames " + std::to_string(block_start[b]) + " to " +
+            std::to_string(block_start[b + 1] - 1) + " failed: " + errors[b])
+    }
+}
+
+void JointMechanicsTool::setContactModelingOptions(const Model& model,
+    SimTK::State& state) const
+{
+    //Turn on mesh flipping so metrics are computed for casting and target
+    for (const std::string& frc_path : _contact_force_paths) {
+        model.getComponent<Smith2018ArticularContactForce>(frc_path).
+            setModelingOption(state, "flip_meshes", 1);
+    }
 }
 
 void JointMechanicsTool::readStatesFromFile() {
@@ -321,13 +484,17 @@ void JointMechanicsTool::readStatesFromFile() {
 }
 
 void JointMechanicsTool::initialize(SimTK::State& state) {
-    //States
-    if (get_h5_states_data()) {
-        StatesReporter* states_rep = new StatesReporter();
-        states_rep->setName("states_analysis");
-        states_rep->setStepInterval(1);
-        states_rep->setPrintResultFiles(false);
-        _model->addAnalysis(states_rep);
+    //The per frame outputs are only stored for every frame if they are used
+    //after the last frame (.vtp files or .h5 file written at the end)
+    _stream_h5 = get_write_h5_file() && get_stream_h5_file();
+    _n_buffer_frames = _n_frames;
+
+    //Otherwise the streamed frames are recorded in a ring buffer, a row is
+    //reused once the output pipeline has appended it to the .h5 file
+    if (_stream_h5 && !get_write_vtp_files()) {
+        int n_pending = _output_pipeline ?
+            _output_pipeline->getMaxPendingJobs() : 0;
+        _n_buffer_frames = std::min(n_pending + 1, _n_frames);
     }
 
     //Add Analysis set
@@ -343,6 +510,12 @@ void JointMechanicsTool::initialize(SimTK::State& state) {
 
     state = _model->initSystem();
 
+    //States
+    if (get_h5_states_data()) {
+        _states_values.resize(_n_frames, _model->getNumStateVariables());
+        _states_values = SimTK::NaN;
+    }
+
     setupContactStorage(state);
  
     setupLigamentStorage();
@@ -355,6 +528,12 @@ void JointMechanicsTool::initialize(SimTK::State& state) {
         setupCoordinateStorage();
     }
 
+    setupGeometryOnlyReport();
+
+    if (_stream_h5) {
+        openH5Stream();
+    }
+
   
 }
 
@@ -413,14 +592,7 @@ void JointMechanicsTool::setupContactStorage(SimTK::State& state) {
             }
         }
     }
-    //Turn on mesh flipping so metrics are computed for casting and target
-    for (int i = 0; i < _contact_force_paths.size(); ++i) {
-
-        Smith2018ArticularContactForce& contactForce = _model->updComponent
-            <Smith2018ArticularContactForce>(_contact_force_paths[i]);
-
-        contactForce.setModelingOption(state, "flip_meshes", 1);		
-    }
+    setContactModelingOptions(*_model, state);
 
     //Realize Report so the sizes of output vectors are known
     _model->realizeReport(state);
@@ -479,8 +651,8 @@ void JointMechanicsTool::setupContactStorage(SimTK::State& state) {
     int nOutputVec3 = _contact_output_vec3_names.size();
     int nOutputVector = _contact_output_vector_double_names.size();
 
-    SimTK::Matrix double_data(_n_frames, nOutputDouble,-1);
-    SimTK::Matrix_<SimTK::Vec3> vec3_data(_n_frames, nOutputVec3,SimTK::Vec3(-1));    
+    SimTK::Matrix double_data(_n_buffer_frames, nOutputDouble,-1);
+    SimTK::Matrix_<SimTK::Vec3> vec3_data(_n_buffer_frames, nOutputVec3,SimTK::Vec3(-1));    
 
     for (std::string frc_path : _contact_force_paths) {
         const Smith2018ArticularContactForce& frc = _model->updComponent<Smith2018ArticularContactForce>(frc_path);
@@ -497,22 +669,15 @@ void JointMechanicsTool::setupContactStorage(SimTK::State& state) {
             const Output<SimTK::Vector>& vector_output = dynamic_cast<const Output<SimTK::Vector>&>(abs_output);
             int output_vector_size = vector_output.getValue(state).size();
             
-            def_output_vector.push_back(SimTK::Matrix(_n_frames, output_vector_size,-1));
+            def_output_vector.push_back(SimTK::Matrix(_n_buffer_frames, output_vector_size,-1));
         }
         _contact_output_vector_double_values.push_back(def_output_vector);
 
     }
     
-    //Vertex location storage
-    _mesh_vertex_locations.resize(_contact_mesh_paths.size());
-
-    for (int i = 0; i < _contact_mesh_paths.size(); ++i) {
-
-        int mesh_nVer = _model->getComponent<Smith2018ContactMesh>
-            (_contact_mesh_paths[i]).getPolygonalMesh().getNumVertices();
-
-        _mesh_vertex_locations[i].resize(_n_frames, mesh_nVer);
-    }
+    //Mesh transform storage
+    _mesh_transforms.assign(_contact_mesh_paths.size(),
+        std::vector<SimTK::Transform>(_n_buffer_frames));
 
 }
 
@@ -590,7 +755,7 @@ void JointMechanicsTool::setupAttachedGeometriesStorage() {
             _attach_geo_names.push_back(geo.getName());
             _attach_geo_frames.push_back(frame.getAbsolutePathString());
             _attach_geo_meshes.push_back(ply_mesh);
-            _attach_geo_vertex_locations.push_back(SimTK::Matrix_<SimTK::Vec3>(_n_frames, ply_mesh.getNumVertices()));
+            _attach_geo_transforms.push_back(std::vector<SimTK::Transform>(_n_buffer_frames));
         }
     }
 }
@@ -690,7 +855,7 @@ void JointMechanicsTool::setupLigamentStorage() {
     }
 
     int nLigamentOutputs = _ligament_output_double_names.size();
-    SimTK::Matrix lig_output_data(_n_frames, nLigamentOutputs,-1);
+    SimTK::Matrix lig_output_data(_n_buffer_frames, nLigamentOutputs,-1);
 
     //Ligament Storage
     for (std::string lig_path : _ligament_paths) {
@@ -698,12 +863,8 @@ void JointMechanicsTool::setupLigamentStorage() {
             _model->updComponent<Blankevoort1991Ligament>(lig_path);
 
         //Path Point Storage
-        SimTK::Matrix_<SimTK::Vec3> lig_matrix(_n_frames, 
-            _max_path_points, SimTK::Vec3(-1));
-        SimTK::Vector lig_vector(_n_frames, -1);
-
-        _ligament_path_points.push_back(lig_matrix);
-        _ligament_path_nPoints.push_back(lig_vector);
+        _ligament_path_points.push_back(
+            std::vector<std::vector<SimTK::Vec3>>(_n_buffer_frames));
 
         //Output Data Storage
         _ligament_output_double_values.push_back(lig_output_data);
@@ -775,7 +936,7 @@ void JointMechanicsTool::setupMuscleStorage() {
     }
     
     int nMuscleOutputs = _muscle_output_double_names.size();
-    SimTK::Matrix msl_output_data(_n_frames, nMuscleOutputs,-1);
+    SimTK::Matrix msl_output_data(_n_buffer_frames, nMuscleOutputs,-1);
 
     //Muscle Storage
     for (std::string msl_path : _muscle_paths) {
@@ -783,12 +944,8 @@ void JointMechanicsTool::setupMuscleStorage() {
             _model->updComponent<Muscle>(msl_path);
 
         //Path Point Storage
-        SimTK::Matrix_<SimTK::Vec3> msl_matrix(_n_frames, 
-            _max_path_points, SimTK::Vec3(-1));
-        SimTK::Vector msl_vector(_n_frames, -1);
-
-        _muscle_path_points.push_back(msl_matrix);
-        _muscle_path_nPoints.push_back(msl_vector);
+        _muscle_path_points.push_back(
+            std::vector<std::vector<SimTK::Vec3>>(_n_buffer_frames));
 
         //Output Data Storage
         _muscle_output_double_values.push_back(msl_output_data);
@@ -803,35 +960,85 @@ void JointMechanicsTool::setupCoordinateStorage() {
     for (const Coordinate& coord : _model->updComponentList<Coordinate>()) {
         _coordinate_names.push_back(coord.getName());
 
-        SimTK::Matrix coord_data(_n_frames, 2, -1.0);
+        SimTK::Matrix coord_data(_n_buffer_frames, 2, -1.0);
         _coordinate_output_double_values.push_back(coord_data);
     }
 }
 
-int JointMechanicsTool::record(const SimTK::State& s, const int frame_num)
+void JointMechanicsTool::setupGeometryOnlyReport() {
+    _use_geometry_only_report = false;
+    _geometry_only_disabled_force_paths.clear();
+
+    if (!get_geometry_only_report()) return;
+
+    if (!_muscle_output_double_names.empty()) {
+        std::cout << "WARNING: geometry_only_report is ignored because "
+            "muscle_outputs are requested." << std::endl;
+        return;
+    }
+
+    _use_geometry_only_report = true;
+
+    for (const Force& force : _model->getComponentList<Force>()) {
+        if (!force.get_appliesForce()) continue;
+
+        std::string path = force.getAbsolutePathString();
+        if (std::find(_contact_force_paths.begin(), _contact_force_paths.end(),
+            path) != _contact_force_paths.end()) continue;
+
+        _geometry_only_disabled_force_paths.push_back(path);
+    }
+}
+
+void JointMechanicsTool::setGeometryOnlyForcesApplied(const Model& model,
+    SimTK::State& s, bool applied) const
+{
+    for (const std::string& path : _geometry_only_disabled_force_paths) {
+        model.getComponent<Force>(path).setAppliesForce(s, applied);
+    }
+}
+
+int JointMechanicsTool::record(const Model& model, SimTK::State& s,
+    const int frame_num)
 {
-    _model->realizeReport(s);
+    if (_use_geometry_only_report) {
+        //Only the recorded contact forces are computed, the contact
+        //statistics are computed directly instead of in realizeReport
+        setGeometryOnlyForcesApplied(model, s, false);
+        model.realizeDynamics(s);
+
+        for (const std::string& frc_path : _contact_force_paths) {
+            model.getComponent<Smith2018ArticularContactForce>(frc_path).
+                realizeContactMetricCaches(s);
+        }
+    }
+    else {
+        model.realizeReport(s);
+    }
+
+    //Without buffering, each frame overwrites a row of the ring buffer
+    int row = frame_num % _n_buffer_frames;
 
-    //Store mesh vertex locations
+    //Store states
+    if (get_h5_states_data()) {
+        _states_values.updRow(frame_num) =
+            ~model.getStateVariableValues(s);
+    }
+
+    //Store mesh transforms
     std::string frame_name = get_output_frame();
-    const Frame& frame = _model->updComponent<Frame>(frame_name);
+    const Frame& frame = model.getComponent<Frame>(frame_name);
     std::string origin_name = get_output_origin();
-    const Frame& origin = _model->updComponent<Frame>(origin_name);
+    const Frame& origin = model.getComponent<Frame>(origin_name);
 
     SimTK::Vec3 origin_pos = origin.findStationLocationInAnotherFrame(s, SimTK::Vec3(0), frame);
 
     for (int i = 0; i < _contact_mesh_paths.size(); ++i) {
-        int nVertex = _mesh_vertex_locations[i].ncol();
-
-        SimTK::Vector_<SimTK::Vec3> ver = _model->getComponent<Smith2018ContactMesh>
-            (_contact_mesh_paths[i]).getVertexLocations();
-
-        const SimTK::Transform& T = _model->getComponent<Smith2018ContactMesh>
+        SimTK::Transform T = model.getComponent<Smith2018ContactMesh>
             (_contact_mesh_paths[i]).getMeshFrame().findTransformBetween(s,frame);
 
-        for (int j = 0; j < nVertex; ++j) {
-            _mesh_vertex_locations[i](frame_num, j) = T.shiftFrameStationToBase(ver(j)) - origin_pos;
-        }
+        T.updP() -= origin_pos;
+        _mesh_transforms[i][row] = T;
     }
 
 
@@ -839,13 +1046,10 @@ int JointMechanicsTool::record(const SimTK::State& s, const int frame_num)
     if (!_attach_geo_names.empty()) {
         for (int i = 0; i < _attach_geo_names.size(); ++i) {
 
-            const SimTK::PolygonalMesh& mesh = _attach_geo_meshes[i];
+            SimTK::Transform trans = model.getComponent<PhysicalFrame>(_attach_geo_frames[i]).findTransformBetween(s, frame);
 
-            SimTK::Transform trans = _model->updComponent<PhysicalFrame>(_attach_geo_frames[i]).findTransformBetween(s, frame);
-            
-            for (int j = 0; j < mesh.getNumVertices(); ++j) {
-                _attach_geo_vertex_locations[i](frame_num, j) = trans.shiftFrameStationToBase(mesh.getVertexPosition(j)) - origin_pos;
-            }
+            trans.updP() -= origin_pos;
+            _attach_geo_transforms[i][row] = trans;
         }
     }
 
@@ -853,23 +1057,23 @@ int JointMechanicsTool::record(const SimTK::State& s, const int frame_num)
     if (!_contact_force_paths.empty()) {
         int nFrc = 0;
         for (std::string frc_path : _contact_force_paths) {
-            const Smith2018ArticularContactForce& frc = _model->updComponent<Smith2018ArticularContactForce>(frc_path);
+            const Smith2018ArticularContactForce& frc = model.getComponent<Smith2018ArticularContactForce>(frc_path);
 
             int nDouble = 0;
             for (std::string output_name : _contact_output_double_names) {
-                _contact_output_double_values[nFrc].set(frame_num, nDouble, frc.getOutputValue<double>(s, output_name));
+                _contact_output_double_values[nFrc].set(row, nDouble, frc.getOutputValue<double>(s, output_name));
                 nDouble++;
             }
 
             int nVec3 = 0;
             for (std::string output_name : _contact_output_vec3_names) {
-                _contact_output_vec3_values[nFrc].set(frame_num, nVec3, frc.getOutputValue<SimTK::Vec3>(s, output_name));
+                _contact_output_vec3_values[nFrc].set(row, nVec3, frc.getOutputValue<SimTK::Vec3>(s, output_name));
                 nVec3++;
             }
             
             int nVector = 0;
             for (std::string output_name : _contact_output_vector_double_names) {
-                _contact_output_vector_double_values[nFrc][nVector].updRow(frame_num) = ~frc.getOutputValue<SimTK::Vector>(s, output_name);                                
+                _contact_output_vector_double_values[nFrc][nVector].updRow(row) = ~frc.getOutputValue<SimTK::Vector>(s, output_name);                                
                 nVector++;
             }
             nFrc++;
@@ -880,23 +1084,17 @@ int JointMechanicsTool::record(const SimTK::State& s, const int frame_num)
     if (!_ligament_paths.empty()) {
         int nLig = 0;
         for (const std::string& lig_path : _ligament_paths) {
-            Blankevoort1991Ligament& lig = _model->updComponent<Blankevoort1991Ligament>(lig_path);
+            const Blankevoort1991Ligament& lig = model.getComponent<Blankevoort1991Ligament>(lig_path);
             //Path Points
-            const GeometryPath& geoPath = lig.upd_GeometryPath();
-
-            int nPoints = 0;
-            SimTK::Vector_<SimTK::Vec3> path_points(_max_path_points, SimTK::Vec3(-1));
+            const GeometryPath& geoPath = lig.get_GeometryPath();
 
-            getGeometryPathPoints(s, geoPath, path_points, nPoints);
-            for (int i = 0; i < nPoints; ++i) {
-                _ligament_path_points[nLig].set(frame_num,i,path_points(i));
-            }
-            _ligament_path_nPoints[nLig][frame_num] = nPoints;
+            getGeometryPathPoints(model, s, geoPath,
+                _ligament_path_points[nLig][row]);
                 
             //Output Data
             int j = 0;
             for (std::string output_name : _ligament_output_double_names) {
-                _ligament_output_double_values[nLig].set(frame_num,j, lig.getOutputValue<double>(s, output_name));
+                _ligament_output_double_values[nLig].set(row,j, lig.getOutputValue<double>(s, output_name));
                 j++;
             }
             nLig++;
@@ -907,24 +1105,18 @@ int JointMechanicsTool::record(const SimTK::State& s, const int frame_num)
     if (!_muscle_paths.empty()) {
         int nMsl = 0;
         for (const std::string& msl_path : _muscle_paths) {
-            Muscle& msl = _model->updComponent<Muscle>(msl_path);
+            const Muscle& msl = model.getComponent<Muscle>(msl_path);
 
             //Path Points
-            const GeometryPath& geoPath = msl.upd_GeometryPath();
+            const GeometryPath& geoPath = msl.getGeometryPath();
 
-            int nPoints = 0;
-            SimTK::Vector_<SimTK::Vec3> path_points(_max_path_points,SimTK::Vec3(-1));
-            getGeometryPathPoints(s, geoPath, path_points, nPoints);
-            for (int i = 0; i < nPoints; ++i) {
-                _muscle_path_points[nMsl].set(frame_num,i,path_points(i));
-            }
-            _muscle_path_nPoints[nMsl][frame_num] = nPoints;
-                
+            getGeometryPathPoints(model, s, geoPath,
+                _muscle_path_points[nMsl][row]);
 
             //Output Data
             int j = 0;
             for (std::string output_name : _muscle_output_double_names) {
-                _muscle_output_double_values[nMsl].set(frame_num,j, msl.getOutputValue<double>(s, output_name));
+                _muscle_output_double_values[nMsl].set(row,j, msl.getOutputValue<double>(s, output_name));
                 j++;
             }
             nMsl++;
@@ -934,25 +1126,36 @@ int JointMechanicsTool::record(const SimTK::State& s, const int frame_num)
     //Store Coordinate Data
     if (get_h5_kinematics_data()) {
         int nCoord = 0;
-        for (const Coordinate& coord : _model->updComponentList<Coordinate>()) {
-            _coordinate_output_double_values[nCoord](frame_num,0) = coord.getValue(s);
-            _coordinate_output_double_values[nCoord](frame_num,1) = coord.getSpeedValue(s);   
+        for (const Coordinate& coord : model.getComponentList<Coordinate>()) {
+            _coordinate_output_double_values[nCoord](row,0) = coord.getValue(s);
+            _coordinate_output_double_values[nCoord](row,1) = coord.getSpeedValue(s);   
             nCoord++;
         }
     }
+
+    if (_stream_h5) {
+        submitOutput([this, frame_num, row]() {
+            streamH5Frame(frame_num, row); }, OutputPipeline::hdf5_sink);
+    }
+
+    //Restore the forces for the analyses
+    if (_use_geometry_only_report) {
+        setGeometryOnlyForcesApplied(model, s, true);
+    }
     return(0);
 }
 
-void JointMechanicsTool::getGeometryPathPoints(const SimTK::State& s, const GeometryPath& geoPath, SimTK::Vector_<SimTK::Vec3>& path_points, int& nPoints) {
-    const Frame& out_frame = _model->getComponent<Frame>(get_output_frame());
+void JointMechanicsTool::getGeometryPathPoints(const Model& model,
+    const SimTK::State& s, const GeometryPath& geoPath, std::vector<SimTK::Vec3>& path_points) {
+    const Frame& out_frame = model.getComponent<Frame>(get_output_frame());
     
-    const Frame& origin = _model->getComponent<Frame>(get_output_origin());
+    const Frame& origin = model.getComponent<Frame>(get_output_origin());
 
     SimTK::Vec3 origin_pos = origin.findStationLocationInAnotherFrame(s, SimTK::Vec3(0), out_frame);
 
     const Array<AbstractPathPoint*>& pathPoints = geoPath.getCurrentPath(s);
     
-    nPoints = 0;
+    path_points.clear();
     for (int i = 0; i < pathPoints.getSize(); ++i) {
         AbstractPathPoint* point = pathPoints[i];
         PathWrapPoint* pwp = dynamic_cast<PathWrapPoint*>(point);
@@ -965,16 +1168,14 @@ void JointMechanicsTool::getGeometryPathPoints(const SimTK::State& s, const Geom
             // Cycle through each surface point and tranform to output frame
             for (int j = 0; j < surfacePoints.getSize(); ++j) {
                 pos = X_BG * surfacePoints[j]-origin_pos;
-                path_points.set(nPoints, pos);
-                nPoints++;
+                path_points.push_back(pos);
             }
         }
         else { // otherwise a regular PathPoint so just draw its location
             const SimTK::Transform& X_BG = point->getParentFrame().findTransformBetween(s, out_frame);
             pos = X_BG * point->getLocation(s)-origin_pos;
 
-            path_points.set(nPoints, pos);
-            nPoints++;
+            path_points.push_back(pos);
         }
     }
 }
@@ -1005,8 +1206,12 @@ int JointMechanicsTool::printResults(const std::string &aBaseName,const std::str
     //Analysis Results
     _model->updAnalysisSet().printResults(get_results_file_basename(), get_results_directory());
     
-    //Write VTP files
+    //Write VTP files, the files of each component are independent jobs
+    //unless they are written to .vtkhdf files with the HDF5 library
     if (get_write_vtp_files()) {
+        std::string vtp_sink = (get_vtp_file_format() == "vtkhdf") ?
+            OutputPipeline::hdf5_sink : "";
+
         //Contact Meshes
         for (int i = 0; i < _contact_mesh_names.size(); ++i) {
             std::string mesh_name = _contact_mesh_names[i];
@@ -1015,12 +1220,15 @@ int JointMechanicsTool::printResults(const std::string &aBaseName,const std::str
             std::cout << "Writing .vtp files: " << file_path << "/" 
                 << base_name << "_"<< mesh_name << std::endl;
 
-            writeVTPFile(mesh_path, _contact_force_names, true);
+            submitOutput([this, mesh_path]() {
+                writeVTPFile(mesh_path, _contact_force_names, true); },
+                vtp_sink);
         }
 
         //Attached Geometries
         if (!_attach_geo_names.empty()) {
-            writeAttachedGeometryVTPFiles(true);
+            submitOutput([this]() {
+                writeAttachedGeometryVTPFiles(true); }, vtp_sink);
         }
 
         //Ligaments
@@ -1030,9 +1238,10 @@ int JointMechanicsTool::printResults(const std::string &aBaseName,const std::str
                 std::cout << "Writing .vtp files: " << file_path << "/" 
                     << base_name << "_"<< lig << std::endl;
 
-                writeLineVTPFiles("ligament_" + lig, _ligament_path_nPoints[i],
-                    _ligament_path_points[i], _ligament_output_double_names,
-                    _ligament_output_double_values[i]);
+                submitOutput([this, lig, i]() {
+                    writeLineVTPFiles("ligament_" + lig,
+                        _ligament_path_points[i], _ligament_output_double_names,
+                        _ligament_output_double_values[i]); }, vtp_sink);
                 i++;
             }
         }
@@ -1044,17 +1253,27 @@ int JointMechanicsTool::printResults(const std::string &aBaseName,const std::str
                 std::cout << "Writing .vtp files: " << file_path << "/" 
                     << base_name << "_"<< msl << std::endl;
 
-                writeLineVTPFiles("muscle_" + msl, _muscle_path_nPoints[i],
-                    _muscle_path_points[i], _muscle_output_double_names,
-                    _muscle_output_double_values[i]);
+                submitOutput([this, msl, i]() {
+                    writeLineVTPFiles("muscle_" + msl,
+                        _muscle_path_points[i], _muscle_output_double_names,
+                        _muscle_output_double_values[i]); }, vtp_sink);
                 i++;
             }
         }
     }
 
     //Write h5 file
-    if (get_write_h5_file()) {
-        writeH5File(aBaseName, aDir);
+    if (_stream_h5) {
+        submitOutput([this]() { closeH5Stream(); }, OutputPipeline::hdf5_sink);
+    }
+    else if (get_write_h5_file()) {
+        submitOutput([this, aBaseName, aDir]() {
+            writeH5File(aBaseName, aDir); }, OutputPipeline::hdf5_sink);
+    }
+
+    //Wait for the files to be written
+    if (_output_pipeline) {
+        _output_pipeline->finish();
     }
 
     return(0);
@@ -1074,7 +1293,7 @@ void JointMechanicsTool::collectMeshContactOutputData(
         nFrc++;
 
         std::string mesh_type = "";
-        const Smith2018ArticularContactForce& frc = _model->updComponent<Smith2018ArticularContactForce>(frc_path);
+        const Smith2018ArticularContactForce& frc = _model->getComponent<Smith2018ArticularContactForce>(frc_path);
 
         std::string casting_mesh_name = frc.getConnectee<Smith2018ContactMesh>("casting_mesh").getName();
         std::string target_mesh_name = frc.getConnectee<Smith2018ContactMesh>("target_mesh").getName();
@@ -1201,6 +1420,9 @@ void JointMechanicsTool::writeVTPFile(const std::string& mesh_path,
     std::string frame = split_string(get_output_frame(), "/").back();
     std::string origin = split_string(get_output_origin(), "/").back();
 
+    bool streamed = (get_vtp_file_format() == "appended" ||
+        get_vtp_file_format() == "vtkhdf");
+
     //Collect data
     std::vector<SimTK::Matrix> triData, vertexData;
     std::vector<std::string> triDataNames, vertexDataNames;
@@ -1210,6 +1432,7 @@ void JointMechanicsTool::writeVTPFile(const std::string& mesh_path,
 
     //Mesh face connectivity
     const SimTK::PolygonalMesh& mesh = cnt_mesh.getPolygonalMesh();
+    const SimTK::Vector_<SimTK::Vec3>& vertices = cnt_mesh.getVertexLocations();
     
     SimTK::Matrix mesh_faces(mesh.getNumFaces(), mesh.getNumVerticesForFace(0));
 
@@ -1219,11 +1442,28 @@ void JointMechanicsTool::writeVTPFile(const std::string& mesh_path,
         }
     }
 
+    if (streamed) {
+        if (isDynamic) {
+            int mesh_index;
+            contains_string(_contact_mesh_names, mesh_name, mesh_index);
+
+            writeMeshVTPFilesAppended(file_path + "/" + base_name + 
+                "_contact_" + mesh_name + "_dynamic_" + frame + "_" + origin,
+                mesh, vertices, _mesh_transforms[mesh_index],
+                triDataNames, triData);
+        }
+        else {
+            writeMeshVTPFilesAppended(file_path + "/" + base_name + 
+                "_contact_" + mesh_name + "_static_" + frame,
+                mesh, vertices, {}, triDataNames, triData);
+        }
+        return;
+    }
+
     for (int frame_num = 0; frame_num < _n_frames; ++frame_num) {
         //Write file
         VTPFileAdapter* mesh_vtp = new VTPFileAdapter();
-        mesh_vtp->setDataFormat("binary");	
-        //mesh_vtp->setDataFormat("ascii");
+        mesh_vtp->setDataFormat(get_vtp_file_format());
         for (int i = 0; i < triDataNames.size(); ++i) {
             mesh_vtp->appendFaceData(triDataNames[i], ~triData[i][frame_num]);
         }
@@ -1233,7 +1473,8 @@ void JointMechanicsTool::writeVTPFile(const std::string& mesh_path,
             int mesh_index;
             contains_string(_contact_mesh_names, mesh_name, mesh_index);
 
-            mesh_vtp->setPointLocations(_mesh_vertex_locations[mesh_index][frame_num]);
+            mesh_vtp->setPointLocations(transformVertices(
+                _mesh_transforms[mesh_index][frame_num], vertices));
             mesh_vtp->setPolygonConnectivity(mesh_faces);
 
             mesh_vtp->write(base_name + "_contact_" + mesh_name + "_dynamic_" + frame + "_" + origin,
@@ -1259,6 +1500,9 @@ void JointMechanicsTool::writeAttachedGeometryVTPFiles(bool isDynamic) {
     std::string frame = split_string(get_output_frame(), "/").back();
     std::string origin = split_string(get_output_origin(), "/").back();
 
+    bool streamed = (get_vtp_file_format() == "appended" ||
+        get_vtp_file_format() == "vtkhdf");
+
     for (int i = 0; i < _attach_geo_names.size(); ++i) {
         std::cout << "Writing .vtp files: " << file_path << "/" 
             << base_name << "_"<< _attach_geo_names[i] << std::endl;
@@ -1266,6 +1510,11 @@ void JointMechanicsTool::writeAttachedGeometryVTPFiles(bool isDynamic) {
         //Face Connectivity
         const SimTK::PolygonalMesh& mesh = _attach_geo_meshes[i];
 
+        SimTK::Vector_<SimTK::Vec3> vertices(mesh.getNumVertices());
+        for (int j = 0; j < mesh.getNumVertices(); ++j) {
+            vertices(j) = mesh.getVertexPosition(j);
+        }
+
         SimTK::Matrix mesh_faces(mesh.getNumFaces(), mesh.getNumVerticesForFace(0));
 
         for (int j = 0; j < mesh.getNumFaces(); ++j) {
@@ -1274,14 +1523,27 @@ void JointMechanicsTool::writeAttachedGeometryVTPFiles(bool isDynamic) {
             }
         }
 
+        if (streamed) {
+            std::string dynamic_static = isDynamic ? "_dynamic_" : "_static_";
+            std::vector<SimTK::Transform> static_transforms;
+
+            writeMeshVTPFilesAppended(file_path + "/" + base_name + 
+                "_mesh_" + _attach_geo_names[i] + dynamic_static +
+                frame + "_" + origin, mesh, vertices,
+                isDynamic ? _attach_geo_transforms[i] : static_transforms,
+                {}, {});
+            continue;
+        }
+
         for (int frame_num = 0; frame_num < _n_frames; ++frame_num) {
 
             //Write file
             VTPFileAdapter* mesh_vtp = new VTPFileAdapter();
-            mesh_vtp->setDataFormat("binary");
+            mesh_vtp->setDataFormat(get_vtp_file_format());
             
             if (isDynamic) {
-                mesh_vtp->setPointLocations(_attach_geo_vertex_locations[i][frame_num]);
+                mesh_vtp->setPointLocations(transformVertices(
+                    _attach_geo_transforms[i][frame_num], vertices));
                 mesh_vtp->setPolygonConnectivity(mesh_faces);
 
                 mesh_vtp->write(base_name + "_mesh_" + _attach_geo_names[i] + "_dynamic_" +
@@ -1297,15 +1559,150 @@ void JointMechanicsTool::writeAttachedGeometryVTPFiles(bool isDynamic) {
     }
 }
 
+SimTK::RowVector_<SimTK::Vec3> JointMechanicsTool::transformVertices(
+    const SimTK::Transform& transform,
+    const SimTK::Vector_<SimTK::Vec3>& vertices)
+{
+    SimTK::RowVector_<SimTK::Vec3> points(vertices.size());
+    for (int j = 0; j < vertices.size(); ++j) {
+        points(j) = transform.shiftFrameStationToBase(vertices(j));
+    }
+    return points;
+}
+
+void JointMechanicsTool::writeMeshVTPFilesAppended(
+    const std::string& file_name, const SimTK::PolygonalMesh& mesh,
+    const SimTK::Vector_<SimTK::Vec3>& vertices,
+    const std::vector<SimTK::Transform>& transforms,
+    const std::vector<std::string>& face_data_names,
+    const std::vector<SimTK::Matrix>& face_data)
+{
+    int nVertices = vertices.size();
+    int nFaces = mesh.getNumFaces();
+
+    //Face connectivity is the same for all frames
+    std::vector<int32_t> connectivity;
+    std::vector<int32_t> offsets;
+    for (int j = 0; j < nFaces; ++j) {
+        for (int k = 0; k < mesh.getNumVerticesForFace(j); ++k) {
+            connectivity.push_back(mesh.getFaceVertex(j, k));
+        }
+        offsets.push_back((int32_t)connectivity.size());
+    }
+
+    //Buffers are reused for each frame
+    std::vector<float> points(3 * nVertices);
+    std::vector<std::vector<float>> values(face_data_names.size(),
+        std::vector<float>(nFaces));
+
+    //A .vtkhdf file for all frames or a .vtp file per frame
+    bool vtkhdf = (get_vtp_file_format() == "vtkhdf");
+    VTKHDFWriter hdf;
+    VTPStreamWriter vtp_file;
+    VTPStreamWriter& vtp = vtkhdf ? hdf : vtp_file;
+
+    vtp.setCompressionLevel(get_vtp_compression_level());
+    if (vtkhdf) {
+        hdf.open(file_name + ".vtkhdf");
+    }
+
+    for (int frame_num = 0; frame_num < _n_frames; ++frame_num) {
+        for (int j = 0; j < nVertices; ++j) {
+            SimTK::Vec3 pos = transforms.empty() ? vertices(j) :
+                transforms[frame_num].shiftFrameStationToBase(vertices(j));
+
+            for (int k = 0; k < 3; ++k) {
+                points[3 * j + k] = (float)pos(k);
+            }
+        }
+
+        vtp.clear();
+        vtp.setPoints(points.data(), nVertices);
+        vtp.setPolygons(connectivity.data(), offsets.data(), nFaces);
+
+        for (int d = 0; d < face_data_names.size(); ++d) {
+            for (int j = 0; j < nFaces; ++j) {
+                values[d][j] = (float)face_data[d](frame_num, j);
+            }
+            vtp.addCellData(face_data_names[d], values[d].data());
+        }
+
+        if (vtkhdf) {
+            hdf.appendFrame(_time[frame_num]);
+        }
+        else {
+            vtp_file.write(file_name + "_" + std::to_string(frame_num) + ".vtp");
+        }
+    }
+    hdf.close();
+}
+
 void JointMechanicsTool::writeLineVTPFiles(std::string line_name,
-    const SimTK::Vector& nPoints, const SimTK::Matrix_<SimTK::Vec3>& path_points,
+    const std::vector<std::vector<SimTK::Vec3>>& path_points,
     const std::vector<std::string>& output_double_names, const SimTK::Matrix& output_double_values) 
 {
+    if (get_vtp_file_format() == "appended" ||
+        get_vtp_file_format() == "vtkhdf") {
+        std::string frame = split_string(get_output_frame(), "/").back();
+        std::string origin = split_string(get_output_origin(), "/").back();
+
+        std::string file_name = get_results_directory() + "/" + 
+            get_results_file_basename() + "_" + line_name + "_" + 
+            frame + "_" + origin;
+
+        bool vtkhdf = (get_vtp_file_format() == "vtkhdf");
+        VTKHDFWriter hdf;
+        VTPStreamWriter vtp_file;
+        VTPStreamWriter& vtp = vtkhdf ? hdf : vtp_file;
+
+        vtp.setCompressionLevel(get_vtp_compression_level());
+        if (vtkhdf) {
+            hdf.open(file_name + ".vtkhdf");
+        }
+
+        std::vector<float> points;
+        std::vector<int32_t> connectivity;
+        std::vector<std::vector<float>> values(output_double_names.size());
+
+        for (int i = 0; i < _n_frames; ++i) {
+            int nPathPoints = (int)path_points[i].size();
+
+            points.resize(3 * nPathPoints);
+            connectivity.resize(nPathPoints);
+            for (int k = 0; k < nPathPoints; k++) {
+                for (int c = 0; c < 3; ++c) {
+                    points[3 * k + c] = (float)path_points[i][k](c);
+                }
+                connectivity[k] = k;
+            }
+            int32_t offset = nPathPoints;
+
+            vtp.clear();
+            vtp.setPoints(points.data(), nPathPoints);
+            vtp.setLines(connectivity.data(), &offset, 1);
+
+            for (int k = 0; k < output_double_names.size(); ++k) {
+                values[k].assign(nPathPoints,
+                    (float)output_double_values(i, k));
+                vtp.addPointData(output_double_names[k], values[k].data());
+            }
+
+            if (vtkhdf) {
+                hdf.appendFrame(_time[i]);
+            }
+            else {
+                vtp_file.write(file_name + "_" + std::to_string(i) + ".vtp");
+            }
+        }
+        hdf.close();
+        return;
+    }
+
     for (int i = 0; i < _n_frames; ++i) {
-        int nPathPoints = nPoints.get(i);
+        int nPathPoints = (int)path_points[i].size();
             
         VTPFileAdapter* mesh_vtp = new VTPFileAdapter();
-        mesh_vtp->setDataFormat("binary");
+        mesh_vtp->setDataFormat(get_vtp_file_format());
        
 
         //Collect points
@@ -1313,7 +1710,7 @@ void JointMechanicsTool::writeLineVTPFiles(std::string line_name,
         SimTK::Vector lines(nPathPoints);
 
         for (int k = 0; k < nPathPoints; k++) {
-            points(k) = path_points.get(i, k);
+            points(k) = path_points[i][k];
             lines(k) = k;
         }
                 
@@ -1347,39 +1744,55 @@ void JointMechanicsTool::writeH5File(
 
     //Write States Data
     if (get_h5_states_data()) {
-        StatesReporter& states_analysis = dynamic_cast<StatesReporter&>(_model->updAnalysisSet().get("states_analysis"));
-        const TimeSeriesTable& states_table = states_analysis.getStatesStorage().exportToTable();
-        h5_adapter.writeStatesDataSet(states_table);
+        h5_adapter.writeStatesDataSet(createStatesTable());
     }
 
     //Write coordinate data
     if (get_h5_kinematics_data()) {
-        h5_adapter.writeComponentGroupDataSet("Coordinates", _coordinate_names, _coordinate_output_double_names, _coordinate_output_double_values);
+        writeH5ComponentGroup(h5_adapter, "Coordinates", _coordinate_names, _coordinate_output_double_names, _coordinate_output_double_values);
     }
 
     //Write Muscle Data
     if (!_muscle_names.empty()) {
-        h5_adapter.writeComponentGroupDataSet("Muscles",_muscle_names, _muscle_output_double_names, _muscle_output_double_values);		
+        writeH5ComponentGroup(h5_adapter, "Muscles",_muscle_names, _muscle_output_double_names, _muscle_output_double_values);		
     }
 
     //Write Ligament Data
     if (!_ligament_names.empty()) {
-        h5_adapter.writeComponentGroupDataSet("Ligaments",_ligament_names, _ligament_output_double_names, _ligament_output_double_values);
+        writeH5ComponentGroup(h5_adapter, "Ligaments",_ligament_names, _ligament_output_double_names, _ligament_output_double_values);
     }
 
     //Write Contact Data
     if (!_contact_mesh_names.empty()) {
-        h5_adapter.writeComponentGroupDataSet("Smith2018ArticularContactForce",
+        writeH5ComponentGroup(h5_adapter, "Smith2018ArticularContactForce",
             _contact_force_names, 
             _contact_output_double_names, _contact_output_double_values);
         
-        h5_adapter.writeComponentGroupDataSetVec3("Smith2018ArticularContactForce",
-            _contact_force_names, 
-            _contact_output_vec3_names, _contact_output_vec3_values);
+        if (get_h5_packed_layout()) {
+            h5_adapter.writePackedComponentGroupDataSetVec3(
+                "Smith2018ArticularContactForce", _contact_force_names, 
+                _contact_output_vec3_names, _contact_output_vec3_values);
+        }
+        else {
+            h5_adapter.writeComponentGroupDataSetVec3("Smith2018ArticularContactForce",
+                _contact_force_names, 
+                _contact_output_vec3_names, _contact_output_vec3_values);
+        }
 
-        h5_adapter.writeComponentGroupDataSetVector("Smith2018ArticularContactForce",
-            _contact_force_names, 
-            _contact_output_vector_double_names, _contact_output_vector_double_values);
+        if (get_h5_contact_map_format() == "sparse") {
+            h5_adapter.writeSparseComponentGroupDataSetVector(
+                "Smith2018ArticularContactForce", _contact_force_names,
+                _contact_output_vector_double_names,
+                _contact_output_vector_double_values,
+                get_h5_contact_map_precision());
+        }
+        else {
+            h5_adapter.writeComponentGroupDataSetVector("Smith2018ArticularContactForce",
+                _contact_force_names, 
+                _contact_output_vector_double_names, _contact_output_vector_double_values);
+        }
+
+        writeH5MeshGeometry(h5_adapter);
 
         //h5_adapter.writeComponentGroupDataSet("Smith2018ArticularContactForce",_contact_force_names, _contact_output_double_names, _contact_output_double_values);
         /*std::string contact_path = "/Smith2018ArticularContactForce";
@@ -1483,6 +1896,227 @@ void JointMechanicsTool::writeH5File(
 
 }
 
+void JointMechanicsTool::writeH5ComponentGroup(H5FileAdapter& h5_adapter,
+    const std::string& group_name, const std::vector<std::string>& names,
+    const std::vector<std::string>& output_double_names,
+    const std::vector<SimTK::Matrix>& output_double_values)
+{
+    if (get_h5_packed_layout()) {
+        h5_adapter.writePackedComponentGroupDataSet(group_name, names,
+            output_double_names, output_double_values);
+    }
+    else {
+        h5_adapter.writeComponentGroupDataSet(group_name, names,
+            output_double_names, output_double_values);
+    }
+}
+
+void JointMechanicsTool::openH5Stream()
+{
+    const std::string h5_file{ get_results_directory() + "/" + 
+        get_results_file_basename() + ".h5" };
+
+    _h5_stream.setCompressionLevel(get_h5_compression_level());
+    _h5_stream.setShuffle(get_h5_compression_level() > 0);
+    _h5_stream.open(h5_file);
+
+    //Create all datasets up front, the frames are appended in record()
+    _h5_stream.createExtendibleDataSet("/time", 0);
+    streamH5Frame(-1, -1);
+
+    if (!_contact_mesh_names.empty()) {
+        writeH5MeshGeometry(_h5_stream);
+    }
+}
+
+void JointMechanicsTool::writeH5MeshGeometry(H5FileAdapter& h5_adapter)
+{
+    //Mesh geometry of the per triangle outputs, so the contact statistics
+    //can be recomputed from the .h5 file (see ContactStatisticsTool)
+    for (int i = 0; i < _contact_force_paths.size(); ++i) {
+        ContactStatisticsTool::writeH5MeshGeometry(h5_adapter,
+            "/Smith2018ArticularContactForce/" + _contact_force_names[i],
+            _model->getComponent<Smith2018ArticularContactForce>(
+                _contact_force_paths[i]));
+    }
+}
+
+void JointMechanicsTool::streamH5Frame(int frame_num, int row)
+{
+    //If row is negative, the datasets are created without appending a frame
+    if (frame_num >= 0) {
+        _h5_stream.appendDataSetValue(_time[frame_num], "/time");
+    }
+
+    if (get_h5_kinematics_data()) {
+        streamH5ComponentGroup("/Coordinates", _coordinate_names,
+            _coordinate_output_double_names, _coordinate_output_double_values,
+            row);
+    }
+
+    if (!_muscle_names.empty()) {
+        streamH5ComponentGroup("/Muscles", _muscle_names,
+            _muscle_output_double_names, _muscle_output_double_values, row);
+    }
+
+    if (!_ligament_names.empty()) {
+        streamH5ComponentGroup("/Ligaments", _ligament_names,
+            _ligament_output_double_names, _ligament_output_double_values, row);
+    }
+
+    if (_contact_mesh_names.empty()) return;
+
+    std::string group_name = "/Smith2018ArticularContactForce";
+
+    streamH5ComponentGroup(group_name, _contact_force_names,
+        _contact_output_double_names, _contact_output_double_values, row);
+
+    if (get_h5_packed_layout()) {
+        int n_comp = (int)_contact_force_names.size();
+
+        for (int j = 0; j < _contact_output_vec3_names.size(); ++j) {
+            std::string path = group_name + "/" + _contact_output_vec3_names[j];
+
+            if (row < 0) {
+                _h5_stream.createExtendibleDataSetVec3(path, n_comp);
+                _h5_stream.writeStringArrayAttribute(
+                    path, "components", _contact_force_names);
+                continue;
+            }
+            SimTK::Vector_<SimTK::Vec3> values(n_comp);
+            for (int i = 0; i < n_comp; ++i) {
+                values(i) = _contact_output_vec3_values[i](row, j);
+            }
+            _h5_stream.appendDataSetVec3Row(values, path);
+        }
+    }
+
+    for (int i = 0; i < _contact_force_names.size(); ++i) {
+        std::string comp_group = group_name + "/" + _contact_force_names[i];
+
+        int n_vec3 = get_h5_packed_layout() ? 0 :
+            (int)_contact_output_vec3_names.size();
+
+        for (int j = 0; j < n_vec3; ++j) {
+
+            std::string path = comp_group + "/" + _contact_output_vec3_names[j];
+
+            if (row < 0) {
+                _h5_stream.createExtendibleDataSet(path, 3);
+                continue;
+            }
+            const SimTK::Vec3& value = _contact_output_vec3_values[i](row, j);
+            _h5_stream.appendDataSetVectorRow(SimTK::Vector(value), path);
+        }
+
+        for (int j = 0; j < _contact_output_vector_double_names.size(); ++j) {
+            std::string path = 
+                comp_group + "/" + _contact_output_vector_double_names[j];
+
+            const SimTK::Matrix& data = 
+                _contact_output_vector_double_values[i][j];
+
+            bool sparse = (get_h5_contact_map_format() == "sparse");
+
+            if (row < 0) {
+                if (sparse) {
+                    _h5_stream.createSparseDataSet(path, data.ncol(),
+                        get_h5_contact_map_precision());
+                }
+                else {
+                    _h5_stream.createExtendibleDataSet(path, data.ncol());
+                }
+                continue;
+            }
+            //Copy the (strided) matrix row to contiguous memory
+            SimTK::Vector values = ~data.row(row);
+            if (sparse) {
+                _h5_stream.appendSparseDataSetRow(values, path,
+                    get_h5_contact_map_precision());
+            }
+            else {
+                _h5_stream.appendDataSetVectorRow(values, path);
+            }
+        }
+    }
+}
+
+void JointMechanicsTool::streamH5ComponentGroup(
+    const std::string& group_name, const std::vector<std::string>& names,
+    const std::vector<std::string>& output_double_names,
+    const std::vector<SimTK::Matrix>& output_double_values, int row)
+{
+    if (get_h5_packed_layout()) {
+        int n_comp = (int)names.size();
+
+        for (int j = 0; j < output_double_names.size(); ++j) {
+            std::string path = group_name + "/" + output_double_names[j];
+
+            if (row < 0) {
+                _h5_stream.createExtendibleDataSet(path, n_comp);
+                _h5_stream.writeStringArrayAttribute(path, "components", names);
+                continue;
+            }
+            SimTK::Vector values(n_comp);
+            for (int i = 0; i < n_comp; ++i) {
+                values(i) = output_double_values[i](row, j);
+            }
+            _h5_stream.appendDataSetVectorRow(values, path);
+        }
+        return;
+    }
+
+    for (int i = 0; i < names.size(); ++i) {
+        for (int j = 0; j < output_double_names.size(); ++j) {
+            std::string path = 
+                group_name + "/" + names[i] + "/" + output_double_names[j];
+
+            if (row < 0) {
+                _h5_stream.createExtendibleDataSet(path, 0);
+                continue;
+            }
+            _h5_stream.appendDataSetValue(output_double_values[i](row, j), path);
+        }
+    }
+}
+
+void JointMechanicsTool::closeH5Stream()
+{
+    if (get_h5_states_data()) {
+        _h5_stream.writeStatesDataSet(createStatesTable());
+    }
+    _h5_stream.close();
+}
+
+TimeSeriesTable JointMechanicsTool::createStatesTable() const
+{
+    std::vector<double> time(_n_frames);
+    for (int i = 0; i < _n_frames; ++i) {
+        time[i] = _time[i];
+    }
+
+    Array<std::string> state_names = _model->getStateVariableNames();
+    std::vector<std::string> labels;
+    for (int i = 0; i < state_names.getSize(); ++i) {
+        labels.push_back(state_names[i]);
+    }
+
+    return TimeSeriesTable(time, _states_values, labels);
+}
+
+void JointMechanicsTool::submitOutput(
+    OutputPipeline::Job job, const std::string& sink)
+{
+    //Without a pipeline (e.g. printResults() called outside of run()), the
+    //job is run immediately
+    if (_output_pipeline) {
+        _output_pipeline->submit(job, sink);
+    }
+    else {
+        job();
+    }
+}
+
 void JointMechanicsTool::loadModel(const std::string &aToolSetupFileName)
 {
     
@@ -20,6 +20,7 @@
 #include <OpenSim/Simulation/Model/Model.h>
 #include "Smith2018ArticularContactForce.h"
 #include "H5FileAdapter.h"
+#include "OutputPipeline.h"
 #include "osimPluginDLL.h"
 #include "H5Cpp.h"
 #include "hdf5_hl.h"
@@ -62,6 +63,8 @@ class OSIMPLUGIN_API JointMechanicsTool : public Object {
 
     OpenSim_DECLARE_CONCRETE_OBJECT(JointMechanicsTool, Object);
 
+    friend class JointMechanicsFrameBlockTask;
+
 //=============================================================================
 // PROPERTIES
 //=============================================================================
@@ -163,11 +166,21 @@ public:
     OpenSim_DECLARE_PROPERTY(write_vtp_files, bool,
         "Write .vtp files for visualization. The default value is true.")
 
-    OpenSim_DECLARE_PROPERTY(vtp_file_format, bool,
-        "Write .vtp files in 'ascii' (can edit in text editor) or "
-        "'binary' (more compact and can be read faster) formats. "
+    OpenSim_DECLARE_PROPERTY(vtp_file_format, std::string,
+        "Write .vtp files in 'ascii' (can edit in text editor), "
+        "'binary' (more compact and can be read faster) or 'appended' "
+        "(raw binary appended to the end of the file, fastest to write and "
+        "read, can be compressed with vtp_compression_level) formats. "
+        "'vtkhdf' writes a single .vtkhdf (VTKHDF time series) file per "
+        "mesh, ligament and muscle instead of a .vtp file per frame, the "
+        "mesh topology is only written once. "
         "The default value is binary")
 
+    OpenSim_DECLARE_PROPERTY(vtp_compression_level, int,
+        "zlib compression level (0-9) of the .vtp files, 0 disables "
+        "compression. Only used if vtp_file_format is appended or vtkhdf. "
+        "The default value is 0.")
+
     OpenSim_DECLARE_PROPERTY(write_h5_file, bool,
         "Write binary .h5 file")
 
@@ -177,6 +190,65 @@ public:
     OpenSim_DECLARE_PROPERTY(h5_kinematics_data, bool,
         "Write kinematics data to .h5 file")
 
+    OpenSim_DECLARE_PROPERTY(stream_h5_file, bool,
+        "Append each frame to the .h5 file as it is recorded instead of "
+        "writing the file after the last frame. The datasets are chunked and "
+        "compressed, and if write_vtp_files is false the outputs are not "
+        "stored for every frame, so memory use does not grow with the number "
+        "of frames. The default value is false.")
+
+    OpenSim_DECLARE_PROPERTY(h5_compression_level, int,
+        "gzip compression level (0-9) of the streamed .h5 datasets, 0 "
+        "disables compression. Only used if stream_h5_file is true. "
+        "The default value is 4.")
+
+    OpenSim_DECLARE_PROPERTY(h5_packed_layout, bool,
+        "Write one dataset per output type (e.g. /Ligaments/total_force) "
+        "with a column per component instead of one dataset per component "
+        "and output (e.g. /Ligaments/<name>/total_force). The column order "
+        "is stored in the 'components' attribute of each dataset. Vec3 "
+        "outputs are written as frames x components x 3 datasets. Per "
+        "triangle outputs are still written per contact force because the "
+        "meshes have different numbers of triangles. "
+        "The default value is false.")
+
+    OpenSim_DECLARE_PROPERTY(h5_contact_map_format, std::string,
+        "Storage of the per triangle contact outputs (e.g. "
+        "casting_triangle_pressure) in the .h5 file. 'dense' writes a "
+        "frames x triangles dataset. 'sparse' only writes the nonzero "
+        "values of each frame in CSR format (offsets, indices and values "
+        "datasets), use H5FileAdapter::readSparseDataSetSimTKMatrix() to "
+        "densify. The default value is dense.")
+
+    OpenSim_DECLARE_PROPERTY(h5_contact_map_precision, std::string,
+        "Precision of the values of sparse contact maps: 'double', 'float' "
+        "or 'int16' (each frame is scaled by its max absolute value). Only "
+        "used if h5_contact_map_format is sparse. "
+        "The default value is double.")
+
+    OpenSim_DECLARE_PROPERTY(geometry_only_report, bool,
+        "Only realize what the requested outputs depend on instead of "
+        "realizing the full model to Stage::Report. While recording, all "
+        "forces except the recorded Smith2018ArticularContactForces are "
+        "disabled, so muscle dynamics and the model accelerations are not "
+        "computed. Ligament outputs only depend on the path length and "
+        "speed. Ignored if muscle_outputs are requested. "
+        "The default value is false.")
+
+    OpenSim_DECLARE_PROPERTY(num_threads, int,
+        "Number of threads used to record the frames. The frames are split "
+        "into contiguous blocks that are recorded in parallel, each with its "
+        "own copy of the model. If -1, the number of processors is used. "
+        "The default value is 1.")
+
+    OpenSim_DECLARE_PROPERTY(num_output_threads, int,
+        "Number of threads that write the .vtp and .h5 files in the "
+        "background. With stream_h5_file, the frames are appended to the "
+        ".h5 file while the next frames are recorded, and the .vtp files "
+        "of each contact mesh, ligament and muscle are written in parallel. "
+        "If 0, the files are written in order on the main thread. If -1, "
+        "the number of processors is used. The default value is 0.")
+
     OpenSim_DECLARE_UNNAMED_PROPERTY(AnalysisSet,"Analyses to be performed "
         "during forward simulation.")
 
@@ -203,7 +275,15 @@ private:
     void initialize(SimTK::State& state);
     void readStatesFromFile();
     
-    int record(const SimTK::State& s, const int frame_num);
+    void setFrameState(const Model& model, SimTK::State& state,
+        int frame_num) const;
+    int record(const Model& model, SimTK::State& s, const int frame_num);
+    void recordFramesInParallel(std::vector<Model>& block_models);
+    void setContactModelingOptions(const Model& model,
+        SimTK::State& state) const;
+    void setupGeometryOnlyReport();
+    void setGeometryOnlyForcesApplied(const Model& model, SimTK::State& s,
+        bool applied) const;
     
     
     void writeVTPFile(const std::string& mesh_name,
@@ -212,9 +292,32 @@ private:
     void writeAttachedGeometryVTPFiles(bool isDynamic);
 
     void writeLineVTPFiles(std::string line_name,
-        const SimTK::Vector& nPoints, const SimTK::Matrix_<SimTK::Vec3>& path_points,
+        const std::vector<std::vector<SimTK::Vec3>>& path_points,
         const std::vector<std::string>& output_double_names, const SimTK::Matrix& output_double_values);
+    void writeMeshVTPFilesAppended(const std::string& file_name,
+        const SimTK::PolygonalMesh& mesh,
+        const SimTK::Vector_<SimTK::Vec3>& vertices,
+        const std::vector<SimTK::Transform>& transforms,
+        const std::vector<std::string>& face_data_names,
+        const std::vector<SimTK::Matrix>& face_data);
+    SimTK::RowVector_<SimTK::Vec3> transformVertices(
+        const SimTK::Transform& transform,
+        const SimTK::Vector_<SimTK::Vec3>& vertices);
     void writeH5File(const std::string &aBaseName, const std::string &aDir);
+    void openH5Stream();
+    void streamH5Frame(int frame_num, int row);
+    void writeH5ComponentGroup(H5FileAdapter& h5_adapter,
+        const std::string& group_name, const std::vector<std::string>& names,
+        const std::vector<std::string>& output_double_names,
+        const std::vector<SimTK::Matrix>& output_double_values);
+    void streamH5ComponentGroup(const std::string& group_name,
+        const std::vector<std::string>& names,
+        const std::vector<std::string>& output_double_names,
+        const std::vector<SimTK::Matrix>& output_double_values, int row);
+    void closeH5Stream();
+    TimeSeriesTable createStatesTable() const;
+    void writeH5MeshGeometry(H5FileAdapter& h5_adapter);
+    void submitOutput(OutputPipeline::Job job, const std::string& sink = "");
 
     void setupLigamentStorage();
     void setupMuscleStorage();
@@ -223,7 +326,7 @@ private:
     void setupContactStorage(SimTK::State& state);
     std::string findMeshFile(const std::string& file);
 
-    void getGeometryPathPoints(const SimTK::State& s, const GeometryPath& geoPath, SimTK::Vector_<SimTK::Vec3>& path_points, int& nPoints);
+    void getGeometryPathPoints(const Model& model, const SimTK::State& s, const GeometryPath& geoPath, std::vector<SimTK::Vec3>& path_points);
     void collectMeshContactOutputData(const std::string& mesh_name,
         std::vector<SimTK::Matrix>& faceData, std::vector<std::string>& faceDataNames,
         std::vector<SimTK::Matrix>& pointData, std::vector<std::string>& pointDataNames);
@@ -238,16 +341,23 @@ private:
 
     Array<double> _time;
     int _n_frames;
+    int _n_buffer_frames;
     int _n_out_frames;
 
     SimTK::Matrix _q_matrix;
     SimTK::Matrix _u_matrix;
 
+    //frames x state variables, recorded for h5_states_data
+    SimTK::Matrix _states_values;
+
     std::vector<std::string> _contact_force_names;
     std::vector<std::string> _contact_force_paths;
     std::vector<std::string> _contact_mesh_names;
     std::vector<std::string> _contact_mesh_paths;
-    std::vector<SimTK::Matrix_<SimTK::Vec3>> _mesh_vertex_locations;
+
+    //Meshes are rigid, so each frame only stores the transform from the 
+    //mesh frame to the output frame (shifted by the output origin)
+    std::vector<std::vector<SimTK::Transform>> _mesh_transforms;
     
     std::vector<std::string> _contact_output_double_names;
     std::vector<std::string> _contact_output_vec3_names;
@@ -259,21 +369,17 @@ private:
     std::vector<std::string> _attach_geo_names;
     std::vector<std::string> _attach_geo_frames;
     std::vector<SimTK::PolygonalMesh> _attach_geo_meshes;
-    std::vector<SimTK::Matrix_<SimTK::Vec3>> _attach_geo_vertex_locations;
-    
-    int _max_path_points;
+    std::vector<std::vector<SimTK::Transform>> _attach_geo_transforms;
 
     std::vector<std::string> _ligament_names;
     std::vector<std::string> _ligament_paths;
-    std::vector<SimTK::Vector> _ligament_path_nPoints;
-    std::vector < SimTK::Matrix_< SimTK::Vec3>> _ligament_path_points;
+    std::vector<std::vector<std::vector<SimTK::Vec3>>> _ligament_path_points;
     std::vector<std::string> _ligament_output_double_names;
     std::vector<SimTK::Matrix> _ligament_output_double_values;
 
     std::vector<std::string> _muscle_names;
     std::vector<std::string> _muscle_paths;
-    std::vector<SimTK::Vector> _muscle_path_nPoints;
-    std::vector < SimTK::Matrix_< SimTK::Vec3>> _muscle_path_points;
+    std::vector<std::vector<std::vector<SimTK::Vec3>>> _muscle_path_points;
     std::vector<std::string> _muscle_output_double_names;
     std::vector<SimTK::Matrix> _muscle_output_double_values;
 
@@ -287,7 +393,17 @@ private:
     TimeSeriesTable _frame_transform_in_ground;
     int _frame_transform_n_col;
 
+    bool _use_geometry_only_report;
+    std::vector<std::string> _geometry_only_disabled_force_paths;
+
+    bool _stream_h5;
+    H5FileAdapter _h5_stream;
+
     std::string _directoryOfSetupFile;
+
+    //Declared last so the writer threads are stopped before the results
+    //they write are destroyed
+    std::shared_ptr<OutputPipeline> _output_pipeline;
 //=============================================================================
 };  // END of class JointMechanicsTool
 
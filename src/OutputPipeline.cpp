@@ -0,0 +1,209 @@
+/* -------------------------------------------------------------------------- *
+ *                            OutputPipeline.cpp                              *
+ * -------------------------------------------------------------------------- *
+ * Author(s): Colin Smith                                                     *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may    *
+ * not use this file except in compliance with the License. You may obtain a  *
+ * copy of the License at http://www.apache.org/licenses/LICENSE-2.0.         *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,         *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ * -------------------------------------------------------------------------- */
+
+#include "OutputPipeline.h"
+#include <OpenSim/Common/Exception.h>
+#include <algorithm>
+#include <SimTKcommon/internal/ParallelExecutor.h>
+
+using namespace OpenSim;
+
+const std::string OutputPipeline::hdf5_sink = "hdf5";
+
+std::mutex& OutputPipeline::getHDF5Mutex()
+{
+    static std::mutex hdf5_mutex;
+    return hdf5_mutex;
+}
+
+//=============================================================================
+// CONSTRUCTORS
+//=============================================================================
+
+OutputPipeline::OutputPipeline(int num_threads, int max_queued_jobs)
+{
+    _max_queued_jobs = std::max(max_queued_jobs, 1);
+    _n_running = 0;
+    _stop = false;
+
+    if (num_threads < 0) {
+        num_threads = SimTK::ParallelExecutor::getNumProcessors();
+    }
+
+    for (int i = 0; i < num_threads; ++i) {
+        _threads.push_back(std::thread(&OutputPipeline::runWriter, this));
+    }
+}
+
+OutputPipeline::~OutputPipeline()
+{
+    stopWriters();
+}
+
+//=============================================================================
+// METHODS
+//=============================================================================
+
+int OutputPipeline::getMaxPendingJobs() const
+{
+    if (_threads.empty()) return 0;
+
+    return _max_queued_jobs + (int)_threads.size();
+}
+
+void OutputPipeline::submit(Job job, const std::string& sink)
+{
+    if (_threads.empty()) {
+        OPENSIM_THROW_IF(_stop, Exception,
+            "OutputPipeline: submit() was called after finish().")
+
+        if (sink == hdf5_sink) {
+            std::lock_guard<std::mutex> hdf5_lock(getHDF5Mutex());
+            job();
+        }
+        else {
+            job();
+        }
+        return;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        OPENSIM_THROW_IF(_stop, Exception,
+            "OutputPipeline: submit() was called after finish().")
+
+        _job_done.wait(lock, [this] {
+            return (int)_queue.size() < _max_queued_jobs || _error; });
+
+        if (!_error) {
+            _queue.push_back({ std::move(job), sink });
+            _job_ready.notify_one();
+            return;
+        }
+    }
+
+    //A job failed, stop producing
+    finish();
+}
+
+void OutputPipeline::wait()
+{
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _job_done.wait(lock, [this] {
+            return _queue.empty() && _n_running == 0; });
+    }
+    rethrowError();
+}
+
+void OutputPipeline::finish()
+{
+    stopWriters();
+    rethrowError();
+}
+
+void OutputPipeline::runWriter()
+{
+    QueuedJob queued_job;
+
+    while (popJob(queued_job)) {
+        try {
+            if (queued_job.sink == hdf5_sink) {
+                std::lock_guard<std::mutex> hdf5_lock(getHDF5Mutex());
+                queued_job.job();
+            }
+            else {
+                queued_job.job();
+            }
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (!_error) {
+                _error = std::current_exception();
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        _n_running--;
+        if (!queued_job.sink.empty()) {
+            _busy_sinks.erase(queued_job.sink);
+        }
+        queued_job.job = nullptr;
+
+        //The next job of this sink may be waiting, and submit() or wait()
+        //may be waiting for space in the queue, an error or the last job
+        _job_ready.notify_all();
+        _job_done.notify_all();
+    }
+}
+
+bool OutputPipeline::popJob(QueuedJob& queued_job)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    while (true) {
+        //First queued job whose sink is not being written by another thread,
+        //which keeps the jobs of each sink in order
+        for (auto it = _queue.begin(); it != _queue.end(); ++it) {
+            if (!it->sink.empty() && _busy_sinks.count(it->sink)) {
+                continue;
+            }
+
+            queued_job = std::move(*it);
+            _queue.erase(it);
+            _n_running++;
+
+            if (!queued_job.sink.empty()) {
+                _busy_sinks.insert(queued_job.sink);
+            }
+            _job_done.notify_all();
+            return true;
+        }
+
+        if (_stop && _queue.empty()) return false;
+
+        _job_ready.wait(lock);
+    }
+}
+
+void OutputPipeline::stopWriters()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _job_ready.notify_all();
+
+    for (std::thread& thread : _threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+}
+
+void OutputPipeline::rethrowError()
+{
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        std::swap(error, _error);
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
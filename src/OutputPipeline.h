@@ -0,0 +1,138 @@
+#ifndef OPENSIM_OUTPUT_PIPELINE_H_
+#define OPENSIM_OUTPUT_PIPELINE_H_
+/* -------------------------------------------------------------------------- *
+ *                             OutputPipeline.h                               *
+ * -------------------------------------------------------------------------- *
+ * Author(s): Colin Smith                                                     *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may    *
+ * not use this file except in compliance with the License. You may obtain a  *
+ * copy of the License at http://www.apache.org/licenses/LICENSE-2.0.         *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,         *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ * -------------------------------------------------------------------------- */
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include "osimPluginDLL.h"
+
+namespace OpenSim {
+
+//=============================================================================
+//                              OutputPipeline
+//=============================================================================
+/**
+Writes result files in the background while a tool keeps computing. The
+tool submits each piece of output (e.g. a frame appended to an .h5 file, or
+the .vtp files of a mesh) as a job, and a pool of writer threads does the
+encoding, compression and file I/O.
+
+Each job is submitted to a sink, a name for the file or library it writes
+to. Jobs submitted to the same sink run one at a time in the order they
+were submitted, so frames are appended in order. Jobs without a sink can
+run at the same time as any other job. All jobs that call the HDF5 library
+(.h5 and .vtkhdf files) must use the hdf5_sink because the library is not
+thread safe. The hdf5_sink jobs hold getHDF5Mutex() while they run, so code
+that calls the HDF5 library on another thread while a pipeline may be
+running (e.g. H5ContactReporter, which writes during the AnalysisSet steps
+of a tool) must lock it too.
+
+The queue holds at most max_queued_jobs jobs. submit() blocks while the
+queue is full, so a producer can never get more than getMaxPendingJobs()
+jobs ahead of the writers. The data used by a job must stay valid until
+the job has run.
+
+With 0 threads, submit() runs each job immediately on the calling thread,
+which is the same as writing the files without the pipeline.
+
+If a job throws, the remaining jobs are still run and the first exception
+is rethrown by the next call to submit(), wait() or finish().
+
+@author Colin Smith
+*/
+
+class OSIMPLUGIN_API OutputPipeline {
+
+public:
+    typedef std::function<void()> Job;
+
+    /** Sink of all jobs that call the HDF5 library. */
+    static const std::string hdf5_sink;
+
+    /** Lock held by the hdf5_sink jobs, HDF5 calls made outside of the
+    pipeline must hold it as well. */
+    static std::mutex& getHDF5Mutex();
+
+//=============================================================================
+// METHODS
+//=============================================================================
+    /** If num_threads is negative, one writer thread is used for each
+    processor. */
+    explicit OutputPipeline(int num_threads = 0, int max_queued_jobs = 64);
+    ~OutputPipeline();
+
+    OutputPipeline(const OutputPipeline&) = delete;
+    OutputPipeline& operator=(const OutputPipeline&) = delete;
+
+    int getNumThreads() const { return (int)_threads.size(); }
+
+    /** The maximum number of submitted jobs that have not finished. A
+    producer that reuses a ring of buffers for its jobs needs
+    getMaxPendingJobs() + 1 buffers. */
+    int getMaxPendingJobs() const;
+
+    /** Queue job, blocking while the queue is full. */
+    void submit(Job job, const std::string& sink = "");
+
+    /** Wait for all submitted jobs to finish, e.g. before reading back a
+    file that is written by the pipeline. */
+    void wait();
+
+    /** Wait for all submitted jobs to finish and stop the writer threads.
+    No jobs can be submitted afterwards. */
+    void finish();
+
+private:
+    struct QueuedJob {
+        Job job;
+        std::string sink;
+    };
+
+    void runWriter();
+    bool popJob(QueuedJob& queued_job);
+    void stopWriters();
+    void rethrowError();
+
+//=============================================================================
+// DATA
+//=============================================================================
+    int _max_queued_jobs;
+    int _n_running;
+    bool _stop;
+
+    std::vector<std::thread> _threads;
+    std::deque<QueuedJob> _queue;
+    std::set<std::string> _busy_sinks;
+    std::exception_ptr _error;
+
+    std::mutex _mutex;
+    std::condition_variable _job_ready;
+    std::condition_variable _job_done;
+
+//=============================================================================
+};  // END of class OutputPipeline
+
+} // end of namespace OpenSim
+
+#endif // OPENSIM_OUTPUT_PIPELINE_H_
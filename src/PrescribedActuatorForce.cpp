@@ -0,0 +1,111 @@
+/* -------------------------------------------------------------------------- *
+ *                        PrescribedActuatorForce.cpp                         *
+ * -------------------------------------------------------------------------- *
+ * Author(s): Colin Smith                                                     *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may    *
+ * not use this file except in compliance with the License. You may obtain a  *
+ * copy of the License at http://www.apache.org/licenses/LICENSE-2.0.         *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ * -------------------------------------------------------------------------- */
+
+#include <OpenSim/Simulation/Model/Model.h>
+#include <OpenSim/Simulation/Model/PathActuator.h>
+#include <OpenSim/Actuators/CoordinateActuator.h>
+#include <OpenSim/Common/Constant.h>
+#include "PrescribedActuatorForce.h"
+
+using namespace OpenSim;
+
+//=============================================================================
+// CONSTRUCTORS
+//=============================================================================
+
+PrescribedActuatorForce::PrescribedActuatorForce() : Force()
+{
+    constructProperties();
+}
+
+PrescribedActuatorForce::PrescribedActuatorForce(const std::string& name,
+    const ScalarActuator& actuator, const Function& force_function) : Force()
+{
+    constructProperties();
+    setName(name);
+    set_force_function(force_function);
+    connectSocket_actuator(actuator);
+}
+
+void PrescribedActuatorForce::constructProperties()
+{
+    constructProperty_force_function(Constant(0.0));
+}
+
+void PrescribedActuatorForce::extendConnectToModel(Model& model)
+{
+    Super::extendConnectToModel(model);
+
+    const ScalarActuator& actuator = getConnectee<ScalarActuator>("actuator");
+
+    OPENSIM_THROW_IF(
+        dynamic_cast<const PathActuator*>(&actuator) == nullptr &&
+        dynamic_cast<const CoordinateActuator*>(&actuator) == nullptr,
+        Exception, getName() + ": actuator " + actuator.getName() +
+        " must be a PathActuator or a CoordinateActuator.")
+}
+
+//=============================================================================
+// COMPUTATION
+//=============================================================================
+
+double PrescribedActuatorForce::getActuation(const SimTK::State& state) const
+{
+    return get_force_function().calcValue(SimTK::Vector(1, state.getTime()));
+}
+
+void PrescribedActuatorForce::computeForce(const SimTK::State& state,
+    SimTK::Vector_<SimTK::SpatialVec>& bodyForces,
+    SimTK::Vector& generalizedForces) const
+{
+    if (!get_appliesForce()) return;
+
+    const ScalarActuator& actuator = getConnectee<ScalarActuator>("actuator");
+    double actuation = getActuation(state);
+
+    if (const PathActuator* path_actuator =
+            dynamic_cast<const PathActuator*>(&actuator)) {
+
+        path_actuator->getGeometryPath().addInEquivalentForces(
+            state, actuation, bodyForces, generalizedForces);
+    }
+    else if (const CoordinateActuator* coord_actuator =
+            dynamic_cast<const CoordinateActuator*>(&actuator)) {
+
+        applyGeneralizedForce(state, *coord_actuator->getCoordinate(),
+            actuation, generalizedForces);
+    }
+}
+
+//=============================================================================
+// REPORTING
+//=============================================================================
+
+OpenSim::Array<std::string> PrescribedActuatorForce::getRecordLabels() const
+{
+    //Reported in place of the disabled actuator
+    OpenSim::Array<std::string> labels("");
+    labels.append(getConnectee<ScalarActuator>("actuator").getName());
+    return labels;
+}
+
+OpenSim::Array<double> PrescribedActuatorForce::getRecordValues(
+    const SimTK::State& state) const
+{
+    OpenSim::Array<double> values(1);
+    values.append(getActuation(state));
+    return values;
+}
@@ -0,0 +1,100 @@
+#ifndef OPENSIM_PRESCRIBED_ACTUATOR_FORCE_H_
+#define OPENSIM_PRESCRIBED_ACTUATOR_FORCE_H_
+/* -------------------------------------------------------------------------- *
+ *                         PrescribedActuatorForce.h                          *
+ * -------------------------------------------------------------------------- *
+ * Author(s): Colin Smith                                                     *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may    *
+ * not use this file except in compliance with the License. You may obtain a  *
+ * copy of the License at http://www.apache.org/licenses/LICENSE-2.0.         *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ * -------------------------------------------------------------------------- */
+
+#include <OpenSim/Simulation/Model/Force.h>
+#include <OpenSim/Simulation/Model/Actuator.h>
+#include <OpenSim/Common/Function.h>
+#include "osimPluginDLL.h"
+
+namespace OpenSim {
+
+//=============================================================================
+//                         PrescribedActuatorForce
+//=============================================================================
+/**
+This class applies a time varying actuation (force or torque), defined by
+force_function, in place of the actuation of a ScalarActuator. The actuation
+is applied along the GeometryPath of PathActuators (including Muscles) or to
+the Coordinate of CoordinateActuators.
+
+Because the actuation is evaluated from the state time whenever forces are
+computed, the prescribed actuation varies continuously during integration.
+Compared to overriding the actuation of the actuator, which is a discrete
+state variable, the integrator does not need to be reinitialized each time
+the prescribed value changes. The actuator itself should have appliesForce
+set to false so the actuation is not applied twice. The outputs of the
+disabled actuator are then zero, so the prescribed actuation is reported
+(e.g. by the ForceReporter) under the name of the actuator.
+
+@author Colin Smith
+*/
+
+class OSIMPLUGIN_API PrescribedActuatorForce : public Force {
+OpenSim_DECLARE_CONCRETE_OBJECT(PrescribedActuatorForce, Force)
+
+public:
+//=============================================================================
+// PROPERTIES
+//=============================================================================
+    OpenSim_DECLARE_PROPERTY(force_function, Function,
+        "Actuation (force or torque) vs time applied in place of the "
+        "actuator. The default value is Constant(0.0).")
+
+//=============================================================================
+// SOCKETS
+//=============================================================================
+    OpenSim_DECLARE_SOCKET(actuator, ScalarActuator,
+        "The actuator whose actuation is prescribed. Must be a PathActuator "
+        "or a CoordinateActuator.")
+
+//=============================================================================
+// OUTPUTS
+//=============================================================================
+    OpenSim_DECLARE_OUTPUT(actuation, double, getActuation,
+        SimTK::Stage::Time)
+
+//=============================================================================
+// METHODS
+//=============================================================================
+public:
+    PrescribedActuatorForce();
+    PrescribedActuatorForce(const std::string& name,
+        const ScalarActuator& actuator, const Function& force_function);
+
+    double getActuation(const SimTK::State& state) const;
+
+protected:
+    void computeForce(const SimTK::State& state,
+        SimTK::Vector_<SimTK::SpatialVec>& bodyForces,
+        SimTK::Vector& generalizedForces) const override;
+
+    OpenSim::Array<std::string> getRecordLabels() const override;
+    OpenSim::Array<double> getRecordValues(
+        const SimTK::State& state) const override;
+
+    void extendConnectToModel(Model& model) override;
+
+private:
+    void constructProperties();
+
+//=============================================================================
+};  // END of class PrescribedActuatorForce
+
+} // end of namespace OpenSim
+
+#endif // OPENSIM_PRESCRIBED_ACTUATOR_FORCE_H_
@@ -25,12 +25,15 @@
 #include <OpenSim/Common/Object.h>
 #include "RegisterTypes_osimPlugin.h"
 #include "Blankevoort1991Ligament.h"
+#include "PrescribedActuatorForce.h"
 #include "Smith2018ContactMesh.h"
 #include "Smith2018ArticularContactForce.h"
 #include "JointMechanicsTool.h"
 #include "ForsimTool.h"
 #include "COMAKTool.h"
 #include "COMAKInverseKinematicsTool.h"
+#include "H5ContactReporter.h"
+#include "ContactStatisticsTool.h"
 using namespace OpenSim;
 using namespace std;
 
@@ -44,6 +47,7 @@ static dllObjectInstantiator instantiator;
 OSIMPLUGIN_API void RegisterTypes_osimPlugin()
 {
     Object::registerType(Blankevoort1991Ligament());
+    Object::registerType(PrescribedActuatorForce());
     Object::registerType(Smith2018ContactMesh());
     Object::registerType(Smith2018ArticularContactForce());
     Object::registerType(JointMechanicsTool());
@@ -54,6 +58,10 @@ OSIMPLUGIN_API void RegisterTypes_osimPlugin()
     Object::registerType(COMAKCostFunctionParameter());
     Object::registerType(COMAKCostFunctionParameterSet());
     Object::registerType(COMAKInverseKinematicsTool());
+    Object::registerType(H5ContactReporter());
+    Object::registerType(ContactStatisticsTool());
+    Object::registerType(ContactStatisticsRegion());
+    Object::registerType(ContactStatisticsRegionSet());
 }
 
 dllObjectInstantiator::dllObjectInstantiator() 
@@ -117,6 +117,13 @@ extendAddToSystem(MultibodySystem& system) const
         "casting.triangle.previous_contacting_triangle",
         casting_mesh_def_vector_int, Stage::LowestRuntime);
 
+    //Casting triangles with a contacting target triangle, only computed
+    //with fixed_contact_correspondence
+    addCacheVariable<std::vector<int>>("target.triangle.active",
+        std::vector<int>(), Stage::Position);
+    addCacheVariable<std::vector<int>>("casting.triangle.active",
+        std::vector<int>(), Stage::Position);
+
     //Triangles with ray intersections
     addCacheVariable<int>("target.num_active_triangles",
         0, Stage::Position);
@@ -236,6 +243,7 @@ extendAddToSystem(MultibodySystem& system) const
     //Modeling Options
     //----------------
     addModelingOption("flip_meshes", 1);
+    addModelingOption("fixed_contact_correspondence", 1);
 }
 
 void Smith2018ArticularContactForce::computeMeshProximity(
@@ -252,6 +260,12 @@ void Smith2018ArticularContactForce::computeMeshProximity(
     const Smith2018ContactMesh& target_mesh,const std::string& cache_mesh_name,
     SimTK::Vector& triangle_proximity) const
 {
+    if (getModelingOption(state, "fixed_contact_correspondence")) {
+        computeMeshProximityFixedCorrespondence(state, casting_mesh,
+            target_mesh, cache_mesh_name, triangle_proximity);
+        return;
+    }
+
     // Get Mesh Properties
     Vector_<SimTK::Vec3> tri_cen = casting_mesh.getTriangleCenters();
     Vector_<SimTK::UnitVec3> tri_nor = casting_mesh.getTriangleNormals();
@@ -296,7 +310,7 @@ void Smith2018ArticularContactForce::computeMeshProximity(
         //recheck same contact triangle and neighbors
         if (target_tri[i] >= 0) {
             //same triangle
-            if (target_mesh._obb.rayIntersectTri(
+            if (target_mesh.getOBBTreeNode().rayIntersectTri(
                 target_mesh.getPolygonalMesh(), origin, -direction,
                 target_tri[i], contact_point, distance))
             {
@@ -319,7 +333,7 @@ void Smith2018ArticularContactForce::computeMeshProximity(
                 target_mesh.getNeighborTris(target_tri[i]);
 
             for (int neighbor_tri : neighborTris) {
-                if (target_mesh._obb.rayIntersectTri(
+                if (target_mesh.getOBBTreeNode().rayIntersectTri(
                     target_mesh.getPolygonalMesh(), origin, -direction,
                     neighbor_tri, contact_point, distance))
                 {
@@ -382,6 +396,87 @@ void Smith2018ArticularContactForce::computeMeshProximity(
         ".num_contacting_triangles_different", nDiffTri);
 }
 
+void Smith2018ArticularContactForce::computeMeshProximityFixedCorrespondence(
+    const State& state, const Smith2018ContactMesh& casting_mesh,
+    const Smith2018ContactMesh& target_mesh, const std::string& cache_mesh_name,
+    SimTK::Vector& triangle_proximity) const
+{
+    // Get Mesh Properties
+    const Vector_<SimTK::Vec3>& tri_cen = casting_mesh.getTriangleCenters();
+    const Vector_<SimTK::UnitVec3>& tri_nor = casting_mesh.getTriangleNormals();
+    const Vector_<SimTK::Vec3>& target_tri_cen = target_mesh.getTriangleCenters();
+    const Vector_<SimTK::UnitVec3>& target_tri_nor = 
+        target_mesh.getTriangleNormals();
+
+    Transform MeshCtoMeshT = casting_mesh.getMeshFrame().
+        findTransformBetween(state, target_mesh.getMeshFrame());
+
+    triangle_proximity.resize(casting_mesh.getNumFaces());
+    triangle_proximity = 0;
+
+    //Contacting triangles are held at their values from the last state
+    //where the full collision detection was performed
+    std::vector<int> target_tri = updCacheVariableValue<std::vector<int>>
+        (state, cache_mesh_name + ".triangle.previous_contacting_triangle");
+
+    int nActiveTri = 0;
+    int nContactingTri = 0;
+
+    //The active triangles are reused by computeMeshDynamics(), the cached
+    //vector keeps its capacity so it is not reallocated
+    std::vector<int>& active_tri = updCacheVariableValue<std::vector<int>>
+        (state, cache_mesh_name + ".triangle.active");
+    active_tri.clear();
+
+    //Intersect the ray of each active casting triangle with the plane of 
+    //its contacting target triangle
+    for (int i = 0; i < casting_mesh.getNumFaces(); ++i) {
+        if (target_tri[i] < 0) {
+            continue;
+        }
+        nActiveTri++;
+        active_tri.push_back(i);
+
+        SimTK::Vec3 origin = MeshCtoMeshT.shiftFrameStationToBase(tri_cen(i));
+        SimTK::UnitVec3 direction(
+            MeshCtoMeshT.xformFrameVecToBase(tri_nor(i)));
+
+        const SimTK::UnitVec3& plane_normal = target_tri_nor(target_tri[i]);
+        double ray_dot_normal = ~(-direction) * plane_normal;
+
+        if (fabs(ray_dot_normal) < SimTK::SignificantReal) {
+            continue;
+        }
+
+        double distance = ~(target_tri_cen(target_tri[i]) - origin) *
+            plane_normal / ray_dot_normal;
+
+        if (distance >= get_min_proximity() &&
+            distance <= get_max_proximity()) {
+
+            triangle_proximity(i) = distance;
+            if (triangle_proximity(i) > 0.0) { nContactingTri++; }
+        }
+    }
+
+    //Store Contact Info
+    markCacheVariableValid(state, cache_mesh_name + ".triangle.active");
+    setCacheVariableValue(state, cache_mesh_name +
+        ".triangle.previous_contacting_triangle", target_tri);
+    setCacheVariableValue(state, cache_mesh_name + 
+        ".triangle.proximity", triangle_proximity);
+    setCacheVariableValue(state, cache_mesh_name + 
+        ".num_active_triangles", nActiveTri);
+    setCacheVariableValue(state, cache_mesh_name + 
+        ".num_contacting_triangles", nContactingTri);
+    setCacheVariableValue(state, cache_mesh_name + 
+        ".num_contacting_triangles_same", nActiveTri);
+    setCacheVariableValue(state, cache_mesh_name + 
+        ".num_contacting_triangles_neighbor", 0);
+    setCacheVariableValue(state, cache_mesh_name + 
+        ".num_contacting_triangles_different", 0);
+}
+
 void Smith2018ArticularContactForce::computeMeshDynamics(
     const State& state, const Smith2018ContactMesh& casting_mesh,
     const Smith2018ContactMesh& target_mesh) const
@@ -432,9 +527,22 @@ void Smith2018ArticularContactForce::computeMeshDynamics(
     double ET, EC; //elastic modulus
     double vT, vC; //poissons ratio
 
+    //With fixed contact correspondence, only the active set can be in contact
+    bool fixed_correspondence = 
+        getModelingOption(state, "fixed_contact_correspondence") != 0;
+
+    const std::vector<int>* active_tri = fixed_correspondence ?
+        &getCacheVariableValue<std::vector<int>>(state,
+            cache_mesh_name + ".triangle.active") : nullptr;
+
+    int n_faces = fixed_correspondence ?
+        (int)active_tri->size() : casting_mesh.getNumFaces();
+
     //Compute Tri Pressure and Potential Energy
     //-----------------------------------------
-    for (int i = 0; i < casting_mesh.getNumFaces(); ++i) {
+    for (int f = 0; f < n_faces; ++f) {
+        int i = fixed_correspondence ? (*active_tri)[f] : f;
+
         if (triangle_proximity(i) <= 0) {
             triangle_pressure(i) = 0;
             triangle_energy(i) = 0;
@@ -526,7 +634,9 @@ void Smith2018ArticularContactForce::computeMeshDynamics(
     triangle_force.resize(casting_mesh.getNumFaces());
     triangle_force = Vec3(0.0);
 
-    for (int i = 0; i < casting_mesh.getNumFaces(); ++i) {
+    for (int f = 0; f < n_faces; ++f) {
+        int i = fixed_correspondence ? (*active_tri)[f] : f;
+
         for (int j = 0; j < 3; ++j) {
             triangle_force(i)(j) = 
                 triangle_pressure(i) * triangle_area(i) * -triangle_normal(i)(j);
@@ -641,6 +751,10 @@ void Smith2018ArticularContactForce::computeForce(const State& state,
         casting_frame.findTransformBetween(state, target_frame);
 
     for (int i = 0; i < casting_mesh.getNumFaces(); ++i) {
+        if (casting_triangle_proximity(i) <= 0) {
+            continue;
+        }
+
         Vec3 casting_force_ground =
             T_casting_to_ground.xformFrameVecToBase(casting_triangle_force(i));
 
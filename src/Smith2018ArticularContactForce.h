@@ -256,6 +256,17 @@ All outputs are reported in the local mesh reference frame (ie the reference
 frame of the mesh_file. The ContactForce and ContactMoment outputs are 
 expressed in this frame and calculated at the origin of this frame.). 
 
+# Fixed Contact Correspondence
+
+When the pose is only perturbed by a tiny amount (ie finite differencing
+in COMAK), repeating the collision detection is unnecessary. Calling
+setFixedContactCorrespondence(state, true) freezes the contacting target
+triangle of each casting triangle found at the last proximity computation.
+The proximity of each of these triangles is then computed by intersecting the
+casting triangle ray with the plane of its contacting target triangle, and the
+pressures and forces are only computed for this active set. Triangles that 
+were not in contact remain out of contact until the option is turned off.
+
 # References
 
    [1] Smith, C. R., Won Choi, K., Negrut, D., & Thelen, D. G. (2018).
@@ -702,6 +713,19 @@ public:
             (state, "casting.regional.contact_moment");
     }
 
+    /** Keep the contacting triangle correspondences fixed for subsequent
+    realizations of state (see Fixed Contact Correspondence above). This 
+    sets the "fixed_contact_correspondence" modeling option, so the state
+    must be realized at Stage::Position with the option off first.*/
+    void setFixedContactCorrespondence(
+        SimTK::State& state, bool fixed) const {
+        setModelingOption(state, "fixed_contact_correspondence", fixed);
+    }
+
+    bool getFixedContactCorrespondence(const SimTK::State& state) const {
+        return getModelingOption(state, "fixed_contact_correspondence") == 1;
+    }
+
     double computePotentialEnergy(
         const SimTK::State& state) const override;
 
@@ -712,6 +736,11 @@ public:
     OpenSim::Array<double> getRecordValues(const SimTK::State& s) const;
     OpenSim::Array<std::string> getRecordLabels() const;
 
+    /** Compute the contact area, proximity, pressure and force statistics
+    (total and regional) that are otherwise computed in realizeReport. The
+    state must be realized to Stage::Dynamics.*/
+    void realizeContactMetricCaches(const SimTK::State& state) const;
+
 protected:
     void extendAddToSystem(SimTK::MultibodySystem& system) const override;
     void extendRealizeReport(const SimTK::State & state) const override;
@@ -727,6 +756,12 @@ protected:
         const std::string& cache_mesh_name,
         SimTK::Vector& triangle_proximity) const;
 
+    void computeMeshProximityFixedCorrespondence(const SimTK::State& state,
+        const Smith2018ContactMesh& casting_mesh,
+        const Smith2018ContactMesh& target_mesh,
+        const std::string& cache_mesh_name,
+        SimTK::Vector& triangle_proximity) const;
+
     void computeMeshDynamics(const SimTK::State& state,
         const Smith2018ContactMesh& casting_mesh,
         const Smith2018ContactMesh& target_mesh) const;
@@ -749,7 +784,6 @@ protected:
         const SimTK::Vector& total_triangle_pressure,
         const std::vector<int>& triIndices) const;
 
-    void realizeContactMetricCaches(const SimTK::State& state) const;
     
     //void computeRegionalContactStats(const SimTK::State& state) const;
 
@@ -31,6 +31,8 @@
 #include "simmath/internal/OBBTree.h"
 #include <set>
 #include <cmath>
+#include <sstream>
+#include <iomanip>
 
 using namespace OpenSim;
 
@@ -44,7 +46,6 @@ Smith2018ContactMesh::Smith2018ContactMesh()
 {
     setNull();
     constructProperties();
-    _mesh_is_cached = false;
 }
 
 Smith2018ContactMesh::Smith2018ContactMesh(const std::string& name, 
@@ -53,7 +54,6 @@ Smith2018ContactMesh::Smith2018ContactMesh(const std::string& name,
 {
     setNull();
     constructProperties();
-    _mesh_is_cached = false;
 
     setName(name);
     set_mesh_file(mesh_file);
@@ -114,14 +114,43 @@ void Smith2018ContactMesh::extendScale(
         getConnectee<PhysicalFrame>("scale_frame"));
 
     set_scale_factors(scale_factors);
-    _mesh_is_cached = false;
+    _geometry.reset();
 }
 
 void Smith2018ContactMesh::extendFinalizeFromProperties() {
     Super::extendFinalizeFromProperties();
-    if (!_mesh_is_cached) {
+
+    //Copies share the geometry unless the properties it is computed from
+    //were changed on the copy
+    if (!_geometry || _geometry->mesh_file != get_mesh_file() ||
+        _geometry->scale_factors != get_scale_factors()) {
         initializeMesh();
     }
+
+    //Material properties are not shared, they may differ between copies
+    //(e.g. ForsimTool ensemble overrides)
+    int n_tri = getNumFaces();
+
+    if (get_use_variable_thickness()) {
+        std::stringstream thickness_key;
+        thickness_key << std::setprecision(17) << get_mesh_back_file() <<
+            "\n" << get_min_thickness() << "\n" << get_max_thickness();
+
+        if (thickness_key.str() != _variable_thickness_key) {
+            computeVariableThickness();
+            _variable_thickness_key = thickness_key.str();
+        }
+    }
+    else {
+        _tri_thickness.resize(n_tri);
+        _tri_thickness = get_thickness();
+        _variable_thickness_key.clear();
+    }
+
+    _tri_elastic_modulus.resize(n_tri);
+    _tri_elastic_modulus = get_elastic_modulus();
+    _tri_poissons_ratio.resize(n_tri);
+    _tri_poissons_ratio = get_poissons_ratio();
 }
 
 void Smith2018ContactMesh::extendConnectToModel(Model& model)
@@ -226,11 +255,14 @@ std::string Smith2018ContactMesh::findMeshFile(const std::string& file)
 
 void Smith2018ContactMesh::initializeMesh()
 {
-    _mesh_is_cached = true;
+    std::shared_ptr<MeshGeometry> geometry = std::make_shared<MeshGeometry>();
+    SimTK::PolygonalMesh& mesh = geometry->mesh;
+    geometry->mesh_file = get_mesh_file();
+    geometry->scale_factors = get_scale_factors();
 
     // Load Mesh from file
     std::string file = findMeshFile(get_mesh_file());
-    _mesh.loadFile(file);
+    mesh.loadFile(file);
 
     //Scale Mesh
     SimTK::Real xscale = get_scale_factors()(0);
@@ -242,38 +274,34 @@ void Smith2018ContactMesh::initializeMesh()
     scale_rot.set(1, 1, yscale);
     scale_rot.set(2, 2, zscale);
     SimTK::Transform scale_transform(scale_rot,SimTK::Vec3(0.0));
-    _mesh.transformMesh(scale_transform);
+    mesh.transformMesh(scale_transform);
     
     //Allocate space
-    _tri_center.resize(_mesh.getNumFaces());
-    _tri_normal.resize(_mesh.getNumFaces());
-    _tri_area.resize(_mesh.getNumFaces());
-    _tri_thickness.resize(_mesh.getNumFaces());
-    _tri_elastic_modulus.resize(_mesh.getNumFaces());
-    _tri_poissons_ratio.resize(_mesh.getNumFaces());
-
-    _vertex_locations.resize(_mesh.getNumVertices());
-    _face_vertex_locations.resize(_mesh.getNumFaces(), 3);
+    geometry->tri_center.resize(mesh.getNumFaces());
+    geometry->tri_normal.resize(mesh.getNumFaces());
+    geometry->tri_area.resize(mesh.getNumFaces());
+
+    geometry->vertex_locations.resize(mesh.getNumVertices());
+    geometry->face_vertex_locations.resize(mesh.getNumFaces(), 3);
         
-    _regional_tri_ind.resize(6);    
-    _regional_n_tri.assign(6,0);
+    geometry->regional_tri_ind.resize(6);    
 
     // Compute Mesh Properties
     //========================
 
-    for (int i = 0; i < _mesh.getNumFaces(); ++i) {
+    for (int i = 0; i < mesh.getNumFaces(); ++i) {
 
         // Get Triangle Vertice Positions
-        int v1_i = _mesh.getFaceVertex(i, 0);
-        int v2_i = _mesh.getFaceVertex(i, 1);
-        int v3_i = _mesh.getFaceVertex(i, 2);
+        int v1_i = mesh.getFaceVertex(i, 0);
+        int v2_i = mesh.getFaceVertex(i, 1);
+        int v3_i = mesh.getFaceVertex(i, 2);
 
-        SimTK::Vec3 v1 = _mesh.getVertexPosition(v1_i);
-        SimTK::Vec3 v2 = _mesh.getVertexPosition(v2_i);
-        SimTK::Vec3 v3 = _mesh.getVertexPosition(v3_i);
+        SimTK::Vec3 v1 = mesh.getVertexPosition(v1_i);
+        SimTK::Vec3 v2 = mesh.getVertexPosition(v2_i);
+        SimTK::Vec3 v3 = mesh.getVertexPosition(v3_i);
 
         // Compute Triangle Center
-        _tri_center(i) = (v1 + v2 + v3) / 3.0;
+        geometry->tri_center(i) = (v1 + v2 + v3) / 3.0;
 
         // Compute Triangle Normal
         SimTK::Vec3 e1 = v3 - v1;
@@ -284,7 +312,7 @@ void Smith2018ContactMesh::initializeMesh()
         double mag = cross.norm();
 
         for (int j = 0; j < 3; ++j) {
-            _tri_normal(i).set(j,-cross[j] / mag);
+            geometry->tri_normal(i).set(j,-cross[j] / mag);
         }
 
         
@@ -306,53 +334,51 @@ void Smith2018ContactMesh::initializeMesh()
 
         // Now employ Heron's formula
         double s = (s1 + s2 + s3) / 2.0;
-        _tri_area[i] = sqrt(s*(s - s1)*(s - s2)*(s - s3));
+        geometry->tri_area[i] = sqrt(s*(s - s1)*(s - s2)*(s - s3));
         
         //Determine regional triangle indices
         for (int j = 0; j < 3; ++j) {
-            if (_tri_center(i)(j) < 0.0) {
-                _regional_tri_ind[j*2].push_back(i);
-                _regional_n_tri[j * 2]++;
+            if (geometry->tri_center(i)(j) < 0.0) {
+                geometry->regional_tri_ind[j*2].push_back(i);
             }
             else {
-                _regional_tri_ind[j * 2 + 1].push_back(i);
-                _regional_n_tri[j * 2 +1]++;
+                geometry->regional_tri_ind[j * 2 + 1].push_back(i);
             }
         }  
     }
 
     //Vertex Locations
-    for (int i = 0; i < _mesh.getNumVertices(); ++i) {
-        _vertex_locations(i) = _mesh.getVertexPosition(i);
+    for (int i = 0; i < mesh.getNumVertices(); ++i) {
+        geometry->vertex_locations(i) = mesh.getVertexPosition(i);
     }
 
     //Face Vertex Locations
-    for (int i = 0; i < _mesh.getNumFaces(); ++i) {
+    for (int i = 0; i < mesh.getNumFaces(); ++i) {
         for (int j = 0; j < 3; ++j) {
-            int v_ind = _mesh.getFaceVertex(i, j);
-            _face_vertex_locations(i,j) = _mesh.getVertexPosition(v_ind);
+            int v_ind = mesh.getFaceVertex(i, j);
+            geometry->face_vertex_locations(i,j) = mesh.getVertexPosition(v_ind);
         }
     }
 
     //Vertex Connectivity
-    std::vector<std::vector<int>> ver_tri_ind(_mesh.getNumVertices());
-    std::vector<int> ver_nTri(_mesh.getNumVertices());
+    std::vector<std::vector<int>> ver_tri_ind(mesh.getNumVertices());
+    std::vector<int> ver_nTri(mesh.getNumVertices());
 
-    for (int i = 0; i < _mesh.getNumFaces(); ++i) {
+    for (int i = 0; i < mesh.getNumFaces(); ++i) {
         for (int j = 0; j < 3; ++j) {
-            int ver = _mesh.getFaceVertex(i, j);
+            int ver = mesh.getFaceVertex(i, j);
             ver_tri_ind[ver].push_back(i);
             ver_nTri[ver]++;
         }
     }
 
     //Triangle Neighbors
-    _tri_neighbors.resize(_mesh.getNumFaces());
+    geometry->tri_neighbors.resize(mesh.getNumFaces());
 
-    for (int i = 0; i < _mesh.getNumFaces(); ++i) {
+    for (int i = 0; i < mesh.getNumFaces(); ++i) {
         for (int j = 0; j < 3; ++j) {
 
-            int ver = _mesh.getFaceVertex(i, j);
+            int ver = mesh.getFaceVertex(i, j);
 
             for (int k = 0; k < ver_nTri[ver]; ++k) {
                 int tri = ver_tri_ind[ver][k];
@@ -361,33 +387,26 @@ void Smith2018ContactMesh::initializeMesh()
                 if (tri == i) {
                     continue;
                 }
-                _tri_neighbors[i].insert(tri);
+                geometry->tri_neighbors[i].insert(tri);
             }
 
         }
     }
 
     //Construct the OBB Tree
-    SimTK::Array_<int> allFaces(_mesh.getNumFaces());
-    for (int i = 0; i < _mesh.getNumFaces(); ++i) {
+    SimTK::Array_<int> allFaces(mesh.getNumFaces());
+    for (int i = 0; i < mesh.getNumFaces(); ++i) {
         allFaces[i] = i;}
 
-    createObbTree(_obb, _mesh, allFaces);
+    createObbTree(geometry->obb, mesh, allFaces);
+    _geometry = geometry;
+
+    //The variable thickness depends on the geometry
+    _variable_thickness_key.clear();
 
     //Create Decorative Mesh
     _decorative_mesh.reset(new SimTK::DecorativeMeshFile(file));
     _decorative_mesh->setScaleFactors(get_scale_factors());
-
-    //Triangle Material Properties
-    if(get_use_variable_thickness()){
-        computeVariableThickness();
-    }
-    else {
-        _tri_thickness = get_thickness();
-    }
-
-    _tri_elastic_modulus = get_elastic_modulus();
-    _tri_poissons_ratio = get_poissons_ratio();
 }
 
 void Smith2018ContactMesh::computeVariableThickness() {
@@ -398,9 +417,10 @@ void Smith2018ContactMesh::computeVariableThickness() {
 
     // Load mesh_back_file
     std::string file = findMeshFile(get_mesh_back_file());
-    _mesh_back.loadFile(file);
+    SimTK::PolygonalMesh mesh_back;
+    mesh_back.loadFile(file);
 
-    //Scale _mesh_back
+    //Scale mesh_back
     SimTK::Real xscale = get_scale_factors()(0);
     SimTK::Real yscale = get_scale_factors()(1);
     SimTK::Real zscale = get_scale_factors()(2);
@@ -410,19 +430,22 @@ void Smith2018ContactMesh::computeVariableThickness() {
     scale_rot.set(1, 1, yscale);
     scale_rot.set(2, 2, zscale);
     SimTK::Transform scale_transform(scale_rot,SimTK::Vec3(0.0));
-    _mesh_back.transformMesh(scale_transform);
+    mesh_back.transformMesh(scale_transform);
 
     // Create OBB tree for back mesh
-    SimTK::Array_<int> allFaces(_mesh_back.getNumFaces());
+    SimTK::Array_<int> allFaces(mesh_back.getNumFaces());
 
-    for (int i = 0; i < _mesh_back.getNumFaces(); ++i) {
+    for (int i = 0; i < mesh_back.getNumFaces(); ++i) {
         allFaces[i] = i;
     }    
 
-    createObbTree(_back_obb,_mesh_back, allFaces);
+    OBBTreeNode back_obb;
+    createObbTree(back_obb, mesh_back, allFaces);
+
+    _tri_thickness.resize(_geometry->mesh.getNumFaces());
 
     //Loop through all triangles in cartilage mesh
-    for (int i = 0; i < _mesh.getNumFaces(); ++i) {
+    for (int i = 0; i < _geometry->mesh.getNumFaces(); ++i) {
 
         //Use mech_back OBB tree to find cartilage thickness
         //--------------------------------------------------
@@ -431,8 +454,8 @@ void Smith2018ContactMesh::computeVariableThickness() {
         SimTK::Vec3 intersection_point;
         double depth = 0.0;
 
-        if (_back_obb.rayIntersectOBB(_mesh_back,
-            _tri_center(i), -_tri_normal(i), tri, intersection_point, depth)) {
+        if (back_obb.rayIntersectOBB(mesh_back,
+            _geometry->tri_center(i), -_geometry->tri_normal(i), tri, intersection_point, depth)) {
 
             if (depth < min_thickness) {
                 depth = min_thickness;
@@ -616,8 +639,8 @@ bool Smith2018ContactMesh::rayIntersectMesh(
     double obb_distance=-1;
     SimTK::Array_<int> obb_triangles;
 
-    if (_obb.rayIntersectOBB(_mesh, origin, direction, tri,
-        intersection_point, distance)) {
+    if (_geometry->obb.rayIntersectOBB(_geometry->mesh, origin, direction,
+        tri, intersection_point, distance)) {
 
         if ((distance > min_proximity) && (distance < max_proximity)) {
             return true;
@@ -626,8 +649,8 @@ bool Smith2018ContactMesh::rayIntersectMesh(
 
     //Shoot the ray in the opposite direction
     if (min_proximity < 0.0) {        
-        if (_obb.rayIntersectOBB(_mesh, origin, -direction, tri,
-            intersection_point, distance)) {
+        if (_geometry->obb.rayIntersectOBB(_geometry->mesh, origin,
+            -direction, tri, intersection_point, distance)) {
 
             distance = -distance;
             if ((distance > min_proximity) && (distance < max_proximity)) {
@@ -178,23 +178,23 @@ public:
     };
 
     const SimTK::PolygonalMesh& getPolygonalMesh() const {
-        return _mesh;
+        return _geometry->mesh;
     }
 
     int getNumFaces() const {
-        return _mesh.getNumFaces();
+        return _geometry->mesh.getNumFaces();
     }
 
     int getNumVertices() const {
-        return _mesh.getNumVertices();
+        return _geometry->mesh.getNumVertices();
     }
 
     const std::set<int>& getNeighborTris(int tri) const {
-        return _tri_neighbors[tri];
+        return _geometry->tri_neighbors[tri];
     }
 
     const std::vector<std::vector<int>>& getRegionalTriangleIndices() const {
-        return _regional_tri_ind;
+        return _geometry->regional_tri_ind;
     }
 
     const double& getTriangleThickness(int i) const {
@@ -210,31 +210,31 @@ public:
     }
 
     const SimTK::Vector& getTriangleAreas() const {
-        return _tri_area;
+        return _geometry->tri_area;
     }
 
     const SimTK::Vector_<SimTK::Vec3>& getTriangleCenters() const {
-        return _tri_center;
+        return _geometry->tri_center;
     }
 
     const SimTK::Vector_<SimTK::UnitVec3>& getTriangleNormals() const {
-        return _tri_normal;
+        return _geometry->tri_normal;
     }
 
     const SimTK::Matrix_<SimTK::Vec3>& getFaceVertexLocations() const {
-        return _face_vertex_locations;
+        return _geometry->face_vertex_locations;
     }
 
     const SimTK::Vector_<SimTK::Vec3>& getVertexLocations() const {
-        return _vertex_locations;
+        return _geometry->vertex_locations;
     }
 
     const OBBTreeNode& getOBBTreeNode() const {
-        return _obb;
+        return _geometry->obb;
     }
 
     int getOBBNumTriangles() const {
-        return _obb._numTriangles;
+        return _geometry->obb._numTriangles;
     }
     
     bool rayIntersectMesh(
@@ -276,20 +276,13 @@ private:
     void computeVariableThickness();
 
     // Member Variables
-    SimTK::PolygonalMesh _mesh;
-    SimTK::PolygonalMesh _mesh_back;
-    SimTK::Vector_<SimTK::Vec3> _tri_center;
-    SimTK::Vector_<SimTK::UnitVec3> _tri_normal;
-    SimTK::Vector _tri_area;
-    std::vector<std::vector<int>> _regional_tri_ind;
-    std::vector<int> _regional_n_tri;
-    std::vector<std::set<int>> _tri_neighbors;
-    SimTK::Vector_<SimTK::Vec3> _vertex_locations;
-    SimTK::Matrix_<SimTK::Vec3> _face_vertex_locations;
     SimTK::Vector _tri_thickness;
     SimTK::Vector _tri_elastic_modulus;
     SimTK::Vector _tri_poissons_ratio;
-    bool _mesh_is_cached;
+
+    // mesh_back_file, min_thickness and max_thickness of the variable
+    // thickness in _tri_thickness, empty if the thickness is uniform
+    std::string _variable_thickness_key;
 
 
     // We cache the DecorativeMeshFile if we successfully
@@ -338,8 +331,29 @@ public:
 
     };// END of class OBBTreeNode
 
-    OBBTreeNode _obb;
-    OBBTreeNode _back_obb;
+//=========================================================================
+//                            MESH GEOMETRY
+//=========================================================================
+
+private:
+    // The geometry computed from mesh_file and scale_factors is not changed
+    // after initializeMesh(), so copies of this component (e.g. the models
+    // of ForsimTool ensemble variants) share it instead of duplicating it.
+    struct MeshGeometry {
+        std::string mesh_file;
+        SimTK::Vec3 scale_factors;
+        SimTK::PolygonalMesh mesh;
+        SimTK::Vector_<SimTK::Vec3> tri_center;
+        SimTK::Vector_<SimTK::UnitVec3> tri_normal;
+        SimTK::Vector tri_area;
+        std::vector<std::vector<int>> regional_tri_ind;
+        std::vector<std::set<int>> tri_neighbors;
+        SimTK::Vector_<SimTK::Vec3> vertex_locations;
+        SimTK::Matrix_<SimTK::Vec3> face_vertex_locations;
+        OBBTreeNode obb;
+    };
+
+    std::shared_ptr<const MeshGeometry> _geometry;
 
     //=========================================================================
 };  // END of class ContactGeometry
@@ -0,0 +1,198 @@
+/* -------------------------------------------------------------------------- *
+ *                            VTKHDFWriter.cpp                                *
+ * -------------------------------------------------------------------------- *
+ * Author(s): Colin Smith                                                     *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may    *
+ * not use this file except in compliance with the License. You may obtain a  *
+ * copy of the License at http://www.apache.org/licenses/LICENSE-2.0.         *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,         *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ * -------------------------------------------------------------------------- */
+
+#include "VTKHDFWriter.h"
+
+using namespace OpenSim;
+
+namespace {
+    //Points and data arrays are appended in large chunks
+    const int vtkhdf_chunk_size = 16384;
+
+    const H5::PredType& id_type = H5::PredType::NATIVE_LLONG;
+    const H5::PredType& float_type = H5::PredType::NATIVE_FLOAT;
+}
+
+//=============================================================================
+// CONSTRUCTORS
+//=============================================================================
+
+VTKHDFWriter::VTKHDFWriter() : VTPStreamWriter()
+{
+    _is_open = false;
+    _shared_topology = true;
+    _n_steps = 0;
+    _n_parts = 0;
+}
+
+//=============================================================================
+// METHODS
+//=============================================================================
+
+void VTKHDFWriter::setCompressionLevel(int compression_level)
+{
+    _compression_level = std::max(0, std::min(compression_level, 9));
+    _h5.setCompressionLevel(_compression_level);
+    _h5.setShuffle(_compression_level > 0);
+}
+
+void VTKHDFWriter::open(const std::string& file_name)
+{
+    close();
+
+    _h5.open(file_name);
+    _is_open = true;
+
+    _h5.createGroup("/VTKHDF");
+    _h5.writeIntArrayAttribute("/VTKHDF", "Version", { 2, 0 });
+    _h5.writeStringAttribute("/VTKHDF", "Type", "PolyData");
+
+    _h5.createGroup("/VTKHDF/PointData");
+    _h5.createGroup("/VTKHDF/CellData");
+    _h5.createGroup("/VTKHDF/Steps");
+
+    _n_steps = 0;
+    _n_parts = 0;
+    _n_points_total = 0;
+    _n_cells_total = 0;
+
+    for (int t = 0; t < 4; ++t) {
+        _topology_cells_total[t] = 0;
+        _topology_ids_total[t] = 0;
+        _part_cell_offsets[t] = 0;
+        _part_id_offsets[t] = 0;
+    }
+}
+
+void VTKHDFWriter::close()
+{
+    if (!_is_open) return;
+
+    _h5.writeIntArrayAttribute("/VTKHDF/Steps", "NSteps", { _n_steps });
+    _h5.close();
+    _is_open = false;
+}
+
+void VTKHDFWriter::appendFrame(double time)
+{
+    OPENSIM_THROW_IF(!_is_open, Exception,
+        "VTKHDFWriter: open() must be called before appendFrame().")
+
+    if (_n_steps == 0) {
+        _shared_topology = (_n_lines == 0);
+        _n_shared_points = _n_points;
+        _n_shared_polys = _n_polys;
+    }
+    else if (_shared_topology) {
+        OPENSIM_THROW_IF(_n_lines > 0 || _n_points != _n_shared_points ||
+            _n_polys != _n_shared_polys, Exception,
+            "VTKHDFWriter: the number of points or polygons changed at "
+            "time " + std::to_string(time) + ", the topology of the first "
+            "frame is shared by all frames.")
+    }
+
+    if (_n_steps == 0 || !_shared_topology) {
+        appendPart();
+    }
+
+    //Geometry and data of this step
+    _h5.appendDataSetRows(_points, _n_points, 3, float_type,
+        "/VTKHDF/Points", float_type, vtkhdf_chunk_size);
+
+    for (const DataArray& array : _point_data) {
+        int n_cols = (array.n_components == 1) ? 0 : array.n_components;
+
+        _h5.appendDataSetRows(array.data, _n_points, n_cols, float_type,
+            "/VTKHDF/PointData/" + array.name, float_type, vtkhdf_chunk_size);
+        _h5.appendDataSetRows(&_n_points_total, 1, 0, id_type,
+            "/VTKHDF/Steps/PointDataOffsets/" + array.name, id_type);
+    }
+
+    int n_cells = _n_lines + _n_polys;
+    for (const DataArray& array : _cell_data) {
+        int n_cols = (array.n_components == 1) ? 0 : array.n_components;
+
+        _h5.appendDataSetRows(array.data, n_cells, n_cols, float_type,
+            "/VTKHDF/CellData/" + array.name, float_type, vtkhdf_chunk_size);
+        _h5.appendDataSetRows(&_n_cells_total, 1, 0, id_type,
+            "/VTKHDF/Steps/CellDataOffsets/" + array.name, id_type);
+    }
+
+    //Steps
+    long long part_offset = _n_parts - 1;
+    long long n_parts = 1;
+
+    _h5.appendDataSetRows(&time, 1, 0, H5::PredType::NATIVE_DOUBLE,
+        "/VTKHDF/Steps/Values", H5::PredType::NATIVE_DOUBLE);
+    _h5.appendDataSetRows(&part_offset, 1, 0, id_type,
+        "/VTKHDF/Steps/PartOffsets", id_type);
+    _h5.appendDataSetRows(&n_parts, 1, 0, id_type,
+        "/VTKHDF/Steps/NumberOfParts", id_type);
+    _h5.appendDataSetRows(&_n_points_total, 1, 0, id_type,
+        "/VTKHDF/Steps/PointOffsets", id_type);
+    _h5.appendDataSetRows(_part_cell_offsets, 1, 4, id_type,
+        "/VTKHDF/Steps/CellOffsets", id_type);
+    _h5.appendDataSetRows(_part_id_offsets, 1, 4, id_type,
+        "/VTKHDF/Steps/ConnectivityIdOffsets", id_type);
+
+    _n_points_total += _n_points;
+    _n_cells_total += n_cells;
+    _n_steps++;
+}
+
+void VTKHDFWriter::appendPart()
+{
+    long long n_points = _n_points;
+    _h5.appendDataSetRows(&n_points, 1, 0, id_type,
+        "/VTKHDF/NumberOfPoints", id_type);
+
+    appendTopology("Vertices", 0, nullptr, nullptr, 0);
+    appendTopology("Lines", 1, _line_connectivity, _line_offsets, _n_lines);
+    appendTopology("Polygons", 2, _poly_connectivity, _poly_offsets, _n_polys);
+    appendTopology("Strips", 3, nullptr, nullptr, 0);
+
+    _n_parts++;
+}
+
+void VTKHDFWriter::appendTopology(const std::string& group, int topology,
+    const int32_t* connectivity, const int32_t* offsets, int n_cells)
+{
+    std::string path = "/VTKHDF/" + group + "/";
+
+    long long n_cells_ll = n_cells;
+    long long n_ids = (n_cells > 0) ? offsets[n_cells - 1] : 0;
+
+    //VTKHDF offsets start with 0, so each part has n_cells + 1 offsets
+    std::vector<long long> part_offsets(n_cells + 1, 0);
+    for (int i = 0; i < n_cells; ++i) {
+        part_offsets[i + 1] = offsets[i];
+    }
+
+    _h5.appendDataSetRows(&n_cells_ll, 1, 0, id_type,
+        path + "NumberOfCells", id_type);
+    _h5.appendDataSetRows(&n_ids, 1, 0, id_type,
+        path + "NumberOfConnectivityIds", id_type);
+    _h5.appendDataSetRows(part_offsets.data(), part_offsets.size(), 0,
+        id_type, path + "Offsets", id_type, vtkhdf_chunk_size);
+    _h5.appendDataSetRows(connectivity, n_ids, 0, H5::PredType::NATIVE_INT32,
+        path + "Connectivity", id_type, vtkhdf_chunk_size);
+
+    _part_cell_offsets[topology] = _topology_cells_total[topology];
+    _part_id_offsets[topology] = _topology_ids_total[topology];
+
+    _topology_cells_total[topology] += n_cells;
+    _topology_ids_total[topology] += n_ids;
+}
@@ -0,0 +1,95 @@
+#ifndef OPENSIM_VTKHDF_WRITER_H_
+#define OPENSIM_VTKHDF_WRITER_H_
+/* -------------------------------------------------------------------------- *
+ *                             VTKHDFWriter.h                                 *
+ * -------------------------------------------------------------------------- *
+ * Author(s): Colin Smith                                                     *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may    *
+ * not use this file except in compliance with the License. You may obtain a  *
+ * copy of the License at http://www.apache.org/licenses/LICENSE-2.0.         *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,         *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ * -------------------------------------------------------------------------- */
+
+#include "VTPStreamWriter.h"
+#include "H5FileAdapter.h"
+
+namespace OpenSim {
+
+//=============================================================================
+//                               VTKHDFWriter
+//=============================================================================
+/**
+Writes a time series of PolyData to a single .vtkhdf file (VTKHDF 2.0
+transient PolyData, read by ParaView 5.12+) instead of one .vtp file per
+frame. The points, cells and data arrays of each frame are set with the
+VTPStreamWriter methods, then appendFrame() appends them to the file.
+
+If the first frame has no lines (e.g. a mesh), the polygons are assumed to
+be the same for every frame: the topology is only written once and every
+step refers to it, so only the points and data arrays are appended for
+each frame. Otherwise (e.g. a ligament path whose number of points
+changes) the topology is appended with each frame.
+
+The datasets are chunked and gzip compressed with setCompressionLevel(),
+which does not require the plugin to be built with zlib.
+
+@author Colin Smith
+*/
+
+class OSIMPLUGIN_API VTKHDFWriter : public VTPStreamWriter {
+
+public:
+//=============================================================================
+// METHODS
+//=============================================================================
+    VTKHDFWriter();
+
+    void setCompressionLevel(int compression_level) override;
+
+    /** Create the .vtkhdf file, file_name includes the path and extension.*/
+    void open(const std::string& file_name);
+
+    /** Append the points, cells and data arrays that are currently set as
+    the next time step. */
+    void appendFrame(double time);
+
+    /** Write the number of steps and close the file. */
+    void close();
+
+private:
+    void appendPart();
+    void appendTopology(const std::string& group, int topology,
+        const int32_t* connectivity, const int32_t* offsets, int n_cells);
+
+//=============================================================================
+// DATA
+//=============================================================================
+    H5FileAdapter _h5;
+    bool _is_open;
+    bool _shared_topology;
+    int _n_steps;
+    int _n_parts;
+    int _n_shared_points;
+    int _n_shared_polys;
+
+    long long _n_points_total;
+    long long _n_cells_total;
+
+    //Vertices, Lines, Polygons, Strips
+    long long _topology_cells_total[4];
+    long long _topology_ids_total[4];
+    long long _part_cell_offsets[4];
+    long long _part_id_offsets[4];
+
+//=============================================================================
+};  // END of class VTKHDFWriter
+
+} // end of namespace OpenSim
+
+#endif // OPENSIM_VTKHDF_WRITER_H_
@@ -0,0 +1,309 @@
+/* -------------------------------------------------------------------------- *
+ *                           VTPStreamWriter.cpp                              *
+ * -------------------------------------------------------------------------- *
+ * Author(s): Colin Smith                                                     *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may    *
+ * not use this file except in compliance with the License. You may obtain a  *
+ * copy of the License at http://www.apache.org/licenses/LICENSE-2.0.         *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,         *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ * -------------------------------------------------------------------------- */
+
+#include "VTPStreamWriter.h"
+#include <OpenSim/Common/Exception.h>
+#include <algorithm>
+#include <iostream>
+
+#ifdef JAM_WITH_ZLIB
+#include <zlib.h>
+#endif
+
+using namespace OpenSim;
+
+namespace {
+    //Uncompressed size of each zlib block, same as VTK
+    const uint64_t compression_block_size = 32768;
+
+    bool isLittleEndian() {
+        int num = 1;
+        return *(char*)&num == 1;
+    }
+}
+
+//=============================================================================
+// CONSTRUCTORS
+//=============================================================================
+
+VTPStreamWriter::VTPStreamWriter()
+{
+    _compression_level = 0;
+    _file_buffer.resize(1 << 20);
+    clear();
+}
+
+//=============================================================================
+// METHODS
+//=============================================================================
+
+void VTPStreamWriter::setCompressionLevel(int compression_level)
+{
+#ifndef JAM_WITH_ZLIB
+    if (compression_level > 0) {
+        std::cout << "WARNING: VTPStreamWriter was built without zlib, "
+            "the .vtp files are not compressed." << std::endl;
+        compression_level = 0;
+    }
+#endif
+    _compression_level = std::max(0, std::min(compression_level, 9));
+}
+
+void VTPStreamWriter::clear()
+{
+    _n_points = 0;
+    _n_polys = 0;
+    _n_lines = 0;
+    _n_poly_indices = 0;
+    _n_line_indices = 0;
+
+    _points = nullptr;
+    _poly_connectivity = nullptr;
+    _poly_offsets = nullptr;
+    _line_connectivity = nullptr;
+    _line_offsets = nullptr;
+
+    _point_data.clear();
+    _cell_data.clear();
+}
+
+void VTPStreamWriter::setPoints(const float* points, int n_points)
+{
+    _points = points;
+    _n_points = n_points;
+}
+
+void VTPStreamWriter::setPolygons(const int32_t* connectivity,
+    const int32_t* offsets, int n_polys)
+{
+    _poly_connectivity = connectivity;
+    _poly_offsets = offsets;
+    _n_polys = n_polys;
+    _n_poly_indices = (n_polys > 0) ? offsets[n_polys - 1] : 0;
+}
+
+void VTPStreamWriter::setLines(const int32_t* connectivity,
+    const int32_t* offsets, int n_lines)
+{
+    _line_connectivity = connectivity;
+    _line_offsets = offsets;
+    _n_lines = n_lines;
+    _n_line_indices = (n_lines > 0) ? offsets[n_lines - 1] : 0;
+}
+
+void VTPStreamWriter::addPointData(const std::string& name,
+    const float* data, int n_components)
+{
+    _point_data.push_back(makeArray(name, "Float32", n_components, data,
+        sizeof(float) * (uint64_t)_n_points * n_components));
+}
+
+void VTPStreamWriter::addCellData(const std::string& name,
+    const float* data, int n_components)
+{
+    _cell_data.push_back(makeArray(name, "Float32", n_components, data,
+        sizeof(float) * (uint64_t)(_n_polys + _n_lines) * n_components));
+}
+
+VTPStreamWriter::DataArray VTPStreamWriter::makeArray(
+    const std::string& name, const std::string& type, int n_components,
+    const void* data, uint64_t n_bytes) const
+{
+    DataArray array;
+    array.name = name;
+    array.type = type;
+    array.n_components = n_components;
+    array.data = data;
+    array.n_bytes = n_bytes;
+    return array;
+}
+
+void VTPStreamWriter::writeDataArrayTag(std::ostream& out,
+    const DataArray& array, uint64_t offset) const
+{
+    out << "<DataArray type=\"" << array.type << "\" Name=\"" << array.name
+        << "\" NumberOfComponents=\"" << array.n_components
+        << "\" format=\"appended\" offset=\"" << offset << "\"/>\n";
+}
+
+void VTPStreamWriter::compressArray(const DataArray& array,
+    std::vector<unsigned char>& compressed) const
+{
+#ifdef JAM_WITH_ZLIB
+    uint64_t n_blocks = (array.n_bytes + compression_block_size - 1) /
+        compression_block_size;
+
+    //Header: n_blocks, block size, last block size, compressed block sizes
+    std::vector<uint64_t> header(3 + n_blocks);
+    header[0] = n_blocks;
+    header[1] = compression_block_size;
+    header[2] = array.n_bytes % compression_block_size;
+
+    std::vector<unsigned char> blocks;
+    const unsigned char* src = static_cast<const unsigned char*>(array.data);
+
+    for (uint64_t b = 0; b < n_blocks; ++b) {
+        uLong src_size = (uLong)std::min(compression_block_size,
+            array.n_bytes - b * compression_block_size);
+        uLongf dest_size = compressBound(src_size);
+
+        size_t start = blocks.size();
+        blocks.resize(start + dest_size);
+
+        int status = compress2(&blocks[start], &dest_size,
+            src + b * compression_block_size, src_size, _compression_level);
+
+        OPENSIM_THROW_IF(status != Z_OK, Exception,
+            "VTPStreamWriter: zlib failed to compress " + array.name + ".")
+
+        blocks.resize(start + dest_size);
+        header[3 + b] = dest_size;
+    }
+
+    const unsigned char* header_bytes =
+        reinterpret_cast<const unsigned char*>(header.data());
+
+    compressed.assign(header_bytes,
+        header_bytes + header.size() * sizeof(uint64_t));
+    compressed.insert(compressed.end(), blocks.begin(), blocks.end());
+#else
+    //Never called, setCompressionLevel() keeps the level at 0 without zlib
+    (void)array;
+    (void)compressed;
+#endif
+}
+
+void VTPStreamWriter::write(const std::string& file_name)
+{
+    std::vector<DataArray> points, lines, polys;
+
+    points.push_back(makeArray("Points", "Float32", 3, _points,
+        sizeof(float) * 3 * (uint64_t)_n_points));
+
+    if (_n_lines > 0) {
+        lines.push_back(makeArray("connectivity", "Int32", 1,
+            _line_connectivity, sizeof(int32_t) * (uint64_t)_n_line_indices));
+        lines.push_back(makeArray("offsets", "Int32", 1,
+            _line_offsets, sizeof(int32_t) * (uint64_t)_n_lines));
+    }
+    if (_n_polys > 0) {
+        polys.push_back(makeArray("connectivity", "Int32", 1,
+            _poly_connectivity, sizeof(int32_t) * (uint64_t)_n_poly_indices));
+        polys.push_back(makeArray("offsets", "Int32", 1,
+            _poly_offsets, sizeof(int32_t) * (uint64_t)_n_polys));
+    }
+
+    //Appended data order
+    std::vector<const DataArray*> arrays;
+    for (const DataArray& array : _point_data) arrays.push_back(&array);
+    for (const DataArray& array : _cell_data) arrays.push_back(&array);
+    for (const DataArray& array : points) arrays.push_back(&array);
+    for (const DataArray& array : lines) arrays.push_back(&array);
+    for (const DataArray& array : polys) arrays.push_back(&array);
+
+    //Compressed arrays must be buffered to know their offsets
+    bool compress = (_compression_level > 0);
+    std::vector<std::vector<unsigned char>> compressed(
+        compress ? arrays.size() : 0);
+
+    std::vector<uint64_t> offsets;
+    uint64_t offset = 0;
+    for (size_t i = 0; i < arrays.size(); ++i) {
+        offsets.push_back(offset);
+
+        if (compress) {
+            compressArray(*arrays[i], compressed[i]);
+            offset += compressed[i].size();
+        }
+        else {
+            offset += sizeof(uint64_t) + arrays[i]->n_bytes;
+        }
+    }
+
+    std::ofstream out;
+    out.rdbuf()->pubsetbuf(_file_buffer.data(), _file_buffer.size());
+    out.open(file_name, std::ios::out | std::ios::binary);
+
+    OPENSIM_THROW_IF(!out.is_open(), Exception,
+        "VTPStreamWriter: could not open " + file_name + ".")
+
+    //Header
+    out << "<?xml version=\"1.0\"?>\n";
+    out << "<VTKFile type=\"PolyData\" version=\"1.0\" byte_order=\""
+        << (isLittleEndian() ? "LittleEndian" : "BigEndian")
+        << "\" header_type=\"UInt64\"";
+    if (compress) {
+        out << " compressor=\"vtkZLibDataCompressor\"";
+    }
+    out << ">\n<PolyData>\n";
+
+    out << "<Piece NumberOfPoints=\"" << _n_points
+        << "\" NumberOfVerts=\"0\" NumberOfLines=\"" << _n_lines
+        << "\" NumberOfStrips=\"0\" NumberOfPolys=\"" << _n_polys << "\">\n";
+
+    int i = 0;
+    out << "<PointData>\n";
+    for (const DataArray& array : _point_data) {
+        writeDataArrayTag(out, array, offsets[i++]);
+    }
+    out << "</PointData>\n";
+
+    out << "<CellData>\n";
+    for (const DataArray& array : _cell_data) {
+        writeDataArrayTag(out, array, offsets[i++]);
+    }
+    out << "</CellData>\n";
+
+    out << "<Points>\n";
+    writeDataArrayTag(out, points[0], offsets[i++]);
+    out << "</Points>\n";
+
+    if (!lines.empty()) {
+        out << "<Lines>\n";
+        writeDataArrayTag(out, lines[0], offsets[i++]);
+        writeDataArrayTag(out, lines[1], offsets[i++]);
+        out << "</Lines>\n";
+    }
+
+    if (!polys.empty()) {
+        out << "<Polys>\n";
+        writeDataArrayTag(out, polys[0], offsets[i++]);
+        writeDataArrayTag(out, polys[1], offsets[i++]);
+        out << "</Polys>\n";
+    }
+
+    out << "</Piece>\n</PolyData>\n";
+
+    //Appended Data
+    out << "<AppendedData encoding=\"raw\">\n_";
+    for (size_t a = 0; a < arrays.size(); ++a) {
+        if (compress) {
+            out.write(reinterpret_cast<const char*>(compressed[a].data()),
+                compressed[a].size());
+        }
+        else {
+            out.write(reinterpret_cast<const char*>(&arrays[a]->n_bytes),
+                sizeof(uint64_t));
+            if (arrays[a]->n_bytes > 0) {
+                out.write(static_cast<const char*>(arrays[a]->data),
+                    arrays[a]->n_bytes);
+            }
+        }
+    }
+    out << "\n</AppendedData>\n</VTKFile>\n";
+
+    out.close();
+}
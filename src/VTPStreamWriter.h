@@ -0,0 +1,136 @@
+#ifndef OPENSIM_VTP_STREAM_WRITER_H_
+#define OPENSIM_VTP_STREAM_WRITER_H_
+/* -------------------------------------------------------------------------- *
+ *                            VTPStreamWriter.h                               *
+ * -------------------------------------------------------------------------- *
+ * Author(s): Colin Smith                                                     *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may    *
+ * not use this file except in compliance with the License. You may obtain a  *
+ * copy of the License at http://www.apache.org/licenses/LICENSE-2.0.         *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,         *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ * -------------------------------------------------------------------------- */
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "osimPluginDLL.h"
+
+namespace OpenSim {
+
+//=============================================================================
+//                             VTPStreamWriter
+//=============================================================================
+/**
+Writes .vtp (VTK PolyData) files using the VTK "appended raw" encoding.
+Unlike VTPFileAdapter, no XML document is built and the data is not base64
+encoded: the XML header is written directly to a buffered file, followed
+by the raw bytes of each array.
+
+The arrays are passed by pointer and are not copied, so they must stay
+valid until write() is called. A single writer can be reused for a series
+of files (e.g. one per frame) by calling clear() and setting the pointers
+of the next frame.
+
+If the plugin is built with zlib (JAM_WITH_ZLIB) and the compression level
+is greater than 0, each array is compressed in blocks
+(vtkZLibDataCompressor). In that case the compressed data is buffered
+before it is written.
+
+@author Colin Smith
+*/
+
+class OSIMPLUGIN_API VTPStreamWriter {
+
+public:
+//=============================================================================
+// METHODS
+//=============================================================================
+    VTPStreamWriter();
+    virtual ~VTPStreamWriter() = default;
+
+    /** zlib compression level (0-9, 0 is no compression) of the appended
+    data. Ignored with a warning if the plugin was built without zlib. */
+    virtual void setCompressionLevel(int compression_level);
+
+    /** Remove all points, cells and data arrays. */
+    void clear();
+
+    /** points: n_points x 3 coordinates. */
+    void setPoints(const float* points, int n_points);
+
+    /** connectivity: the point indices of all polygons, offsets: the end
+    of each polygon in connectivity (n_polys values). */
+    void setPolygons(const int32_t* connectivity, const int32_t* offsets,
+        int n_polys);
+
+    /** Same as setPolygons() for poly lines. */
+    void setLines(const int32_t* connectivity, const int32_t* offsets,
+        int n_lines);
+
+    /** data: n_points x n_components values. The name cannot include
+    spaces. */
+    void addPointData(const std::string& name, const float* data,
+        int n_components = 1);
+
+    /** data: n_cells x n_components values. */
+    void addCellData(const std::string& name, const float* data,
+        int n_components = 1);
+
+    /** Write the .vtp file, file_name includes the path and extension. */
+    void write(const std::string& file_name);
+
+protected:
+    struct DataArray {
+        std::string name;
+        std::string type;
+        int n_components;
+        const void* data;
+        uint64_t n_bytes;
+    };
+
+    DataArray makeArray(const std::string& name, const std::string& type,
+        int n_components, const void* data, uint64_t n_bytes) const;
+
+private:
+    void writeDataArrayTag(std::ostream& out, const DataArray& array,
+        uint64_t offset) const;
+    void compressArray(const DataArray& array,
+        std::vector<unsigned char>& compressed) const;
+
+//=============================================================================
+// DATA
+//=============================================================================
+protected:
+    int _compression_level;
+
+    int _n_points;
+    int _n_polys;
+    int _n_lines;
+    int _n_poly_indices;
+    int _n_line_indices;
+
+    const float* _points;
+    const int32_t* _poly_connectivity;
+    const int32_t* _poly_offsets;
+    const int32_t* _line_connectivity;
+    const int32_t* _line_offsets;
+
+    std::vector<DataArray> _point_data;
+    std::vector<DataArray> _cell_data;
+
+private:
+    std::vector<char> _file_buffer;
+
+//=============================================================================
+};  // END of class VTPStreamWriter
+
+} // end of namespace OpenSim
+
+#endif // OPENSIM_VTP_STREAM_WRITER_H_
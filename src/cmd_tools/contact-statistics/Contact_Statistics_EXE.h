@@ -0,0 +1,26 @@
+#ifndef OPENSIM_CONTACT_STATISTICS_EXE_H_
+#define OPENSIM_CONTACT_STATISTICS_EXE_H_
+
+/* -------------------------------------------------------------------------- *
+ *                         Contact_Statistics_EXE.h                           *
+ * -------------------------------------------------------------------------- *
+ * Author(s): Colin Smith                                                     *
+ *                                                                            *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may    *
+ * not use this file except in compliance with the License. You may obtain a  *
+ * copy of the License at http://www.apache.org/licenses/LICENSE-2.0.         *
+ *                                                                            *
+ * Unless required by applicable law or agreed to in writing, software        *
+ * distributed under the License is distributed on an "AS IS" BASIS,          *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   *
+ * See the License for the specific language governing permissions and        *
+ * limitations under the License.                                             *
+ * -------------------------------------------------------------------------- */
+
+
+#include <OpenSim/OpenSim.h>
+
+namespace OpenSim {
+
+}
+#endif // OPENSIM_CONTACT_STATISTICS_EXE_H_